@@ -0,0 +1,112 @@
+// Copyright Wild Montage, LLC. All Rights Reserved.
+
+//
+// Standalone search microbenchmark, the same one mm.Benchmark runs in the editor:
+//   MMCoreBenchmark Poses=1000,10000,100000 Bones=3 Points=5 Queries=500 States=50 Warmup=1 Out=results.json
+// Results are printed, and written as JSON when Out= is given.
+//
+
+#include "Core/MMCoreBenchmark.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <string>
+
+namespace
+{
+	void ParseArg(const std::string& arg, MMCore::BenchmarkParams& params, std::string& outPath)
+	{
+		const size_t equals = arg.find('=');
+
+		if (equals == std::string::npos)
+			return;
+
+		const std::string key = arg.substr(0, equals);
+		const char* value = arg.c_str() + equals + 1;
+
+		if (key == "Poses")
+		{
+			params.PoseCounts.clear();
+
+			for (const char* it = value; *it; )
+			{
+				char* end;
+				const long count = std::strtol(it, &end, 10);
+
+				if (end != it)
+					params.PoseCounts.push_back((int32_t)count);
+
+				it = (end != it) ? end : it + 1;
+			}
+		}
+		else if (key == "Bones") params.NumBones = std::atoi(value);
+		else if (key == "Points") params.NumTrajectoryPoints = std::atoi(value);
+		else if (key == "Queries") params.NumQueries = std::atoi(value);
+		else if (key == "States") params.NumStates = std::atoi(value);
+		else if (key == "Warmup") params.WarmupPasses = std::atoi(value);
+		else if (key == "Out") outPath = value;
+	}
+
+	std::string GetBuild()
+	{
+#if defined(__clang__)
+		return std::string("clang ") + __clang_version__;
+#elif defined(__GNUC__)
+		return std::string("gcc ") + __VERSION__;
+#elif defined(_MSC_VER)
+		return "msvc " + std::to_string(_MSC_VER);
+#else
+		return "unknown";
+#endif
+	}
+
+	std::string GetDate()
+	{
+		char buffer[32];
+		const std::time_t now = std::time(nullptr);
+		std::strftime(buffer, sizeof(buffer), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+		return buffer;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	MMCore::BenchmarkParams params;
+	std::string outPath;
+
+	for (int i = 1; i < argc; ++i)
+		ParseArg(argv[i], params, outPath);
+
+	const std::vector<MMCore::DatabaseBenchmark> results = MMCore::RunBenchmark(params);
+
+	for (const MMCore::DatabaseBenchmark& db : results)
+	{
+		std::printf("%d poses (%d dims, %.1f MB): index build %.2f ms, query build %.3f us, normalization %.2f ms\n",
+			db.NumPoses, db.SearchDims, db.Megabytes, db.IndexBuildMs, db.QueryBuildUs, db.NormalizationMs);
+
+		for (const MMCore::BackendBenchmark& backend : db.Backends)
+		{
+			std::printf("  %-10s %9.2f us/query (x%.2f), scanned %.0f, pruned %.0f, agreement %.1f%%\n",
+				MMCore::GetSearchBackendName(backend.Backend), backend.UsPerQuery, backend.Speedup,
+				backend.PosesScannedPerQuery, backend.PosesPrunedPerQuery, 100.0 * backend.Agreement);
+		}
+	}
+
+	if (!outPath.empty())
+	{
+		std::ofstream file(outPath);
+		file << MMCore::BenchmarkToJson(params, results, GetBuild(), GetDate());
+
+		if (!file)
+		{
+			std::fprintf(stderr, "Couldn't write %s\n", outPath.c_str());
+			return 1;
+		}
+
+		std::printf("Results written to %s\n", outPath.c_str());
+	}
+
+	return 0;
+}
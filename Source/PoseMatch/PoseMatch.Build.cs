@@ -48,6 +48,8 @@ public class PoseMatch : ModuleRules
 				"Slate",
 				"SlateCore",
 				"UMG",
+				"Json",
+				"RenderCore",
 				// ... add private dependencies that you statically link with here ...	
 			}
 			);
@@ -6,6 +6,9 @@
 
 //nclude "Animation/BoneControllers/AnimNode_TwoBoneIK.h"
 #include "DrawDebugHelpers.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/App.h"
+#include "Misc/ScopeExit.h"
 
 #include "GameFramework/Character.h"
 #include "GameFramework/CharacterMovementComponent.h"
@@ -13,21 +16,30 @@
 #include "MotionMatcher_Component.h"
 #include "MotionMatcherInterface.h"
 
+#include "MotionMatchingCapture.h"
+#include "MotionMatchingPoseCache.h"
+#include "MotionMatchingStats.h"
 #include "RootMotionSource_Custom.h"
 #include "TwoBoneIK.h"
 
-#include "Spring/Spring.h"
-
 #if WITH_EDITOR
 #include "Debug/DebugWidget.h"
 #endif
 
-// Live recording rate for past trajectory.
-#define RECORD_SAMPLE_RATE 0.03f
+// Per-frame diagnostic logging. Compiled out by default; when enabled, only nodes in debug mode emit anything.
+#define MM_VERBOSE_LOGGING 0
+
+#if MM_VERBOSE_LOGGING
+#define MM_LOG(Format, ...) if (HasFeature(EMMatcherFeatures::Logging)) { UE_LOG(LogTemp, Warning, Format, ##__VA_ARGS__); }
+#else
+#define MM_LOG(Format, ...)
+#endif
 
-// Performance profiling. Enter in console "stat motionmatching" to display perf dat. "stat none" to disable.
-DECLARE_STATS_GROUP(TEXT("MotionMatching"), STATGROUP_MotionMatching, STATCAT_Advanced);
-DECLARE_CYCLE_STAT(TEXT("Index Search"), STAT_MMIndexSearch, STATGROUP_MotionMatching);
+static TAutoConsoleVariable<int32> CVarBlendStackMaxLayers(
+	TEXT("mm.BlendStack.MaxLayers"),
+	0,
+	TEXT("Most clips any motion matcher node's blend stack evaluates at once. 0 leaves it to each node's BlendStackLayers."),
+	ECVF_Scalability);
 
 FAnimNode_MotionMatcher::FAnimNode_MotionMatcher()
 {
@@ -38,14 +50,11 @@ void FAnimNode_MotionMatcher::Initialize_AnyThread(const FAnimationInitializeCon
 	FAnimNode_Base::Initialize_AnyThread(Context);
 	GetEvaluateGraphExposedInputs().Execute(Context);
 
-	FPoseMatchModule* module = &FPoseMatchModule::Get();
-
-	if (module)
-	{
-		UE_LOG(LogTemp, Warning, TEXT("Singleton located, global float: %f"), module->GetFloat());
-	}
+	// Bone dependent features are added in CacheBones_AnyThread().
+	Features = bDebugMode ? EMMatcherFeatures::Logging : EMMatcherFeatures::None;
 
 	bHasValidMotionData = false;
+	database.Reset();
 
 	if (!MotionDataAsset) {
 #if WITH_EDITOR
@@ -75,6 +84,11 @@ void FAnimNode_MotionMatcher::Initialize_AnyThread(const FAnimationInitializeCon
 	else if (MotionDataAsset->PoseMatchingBones.Num() == 0) {
 #if WITH_EDITOR
 		if (GEngine) GEngine->AddOnScreenDebugMessage(-1, 15.0f, FColor::Yellow, TEXT("Motion Matcher data asset has no pose matching bones listed."));
+#endif
+	}
+	else if (!(database = MotionDataAsset->GetDatabase()) || !database->HasPoses()) {
+#if WITH_EDITOR
+		if (GEngine) GEngine->AddOnScreenDebugMessage(-1, 15.0f, FColor::Yellow, TEXT("Motion Matcher data asset has no cached poses. Use the \"Rebuild Motion Cache\" action from the content browser's context-menu."));
 #endif
 	}
 	else {
@@ -88,6 +102,8 @@ void FAnimNode_MotionMatcher::Initialize_AnyThread(const FAnimationInitializeCon
 
 	if (!bHasValidMotionData) return;
 
+	cold = MakeShared<FMMatcherColdState>();
+
 	if (UAnimInstance* AnimInstance = Cast<UAnimInstance>(Context.AnimInstanceProxy->GetAnimInstanceObject()))
 	{
 		owningActor = AnimInstance->GetOwningActor();
@@ -95,9 +111,9 @@ void FAnimNode_MotionMatcher::Initialize_AnyThread(const FAnimationInitializeCon
 #if WITH_EDITOR
 		FStringClassReference MyWidgetClassRef("WidgetBlueprint'/PoseMatch/debugHUD.debugHUD_C'");
 		if (UClass* MyWidgetClass = MyWidgetClassRef.TryLoadClass<UDebugWidget>())
-			debugWidget = CreateWidget<UDebugWidget>(owningActor->GetGameInstance(), MyWidgetClassRef.ResolveClass());
+			cold->debugWidget = CreateWidget<UDebugWidget>(owningActor->GetGameInstance(), MyWidgetClassRef.ResolveClass());
 
-		if(debugWidget)
+		if (UDebugWidget* debugWidget = cold->debugWidget)
 		{
 			debugWidget->BindProps(&currentPose, MotionDataAsset);
 			debugWidget->animBones.AddDefaulted(MotionDataAsset->PoseMatchingBones.Num());
@@ -117,24 +133,17 @@ void FAnimNode_MotionMatcher::Initialize_AnyThread(const FAnimationInitializeCon
 
 		FTransform actorT = owningActor->GetTransform();
 		FTransform componentToWorldT = AnimInstance->GetOwningComponent()->GetComponentTransform();
-		csToWs = componentToWorldT;
-
-		localMeshCompPos = actorT.InverseTransformPosition(componentToWorldT.GetLocation());
-		localMeshCompRot = actorT.InverseTransformRotation(componentToWorldT.GetRotation()).Rotator().Euler();
-
-		componentDeltaTransform = componentToWorldT;
+		hot.localMeshCompPos = actorT.InverseTransformPosition(componentToWorldT.GetLocation());
+		localMeshCompYaw = actorT.InverseTransformRotation(componentToWorldT.GetRotation()).Rotator().Yaw;
 
 		inertializationNodes.Empty();
+		inertialization.Reset();
+		blendStack.Reset();
 
 		//
 		// Pose matching stuff
 		//
 
-		PoseMatchingBones.Empty(MotionDataAsset->PoseMatchingBones.Num());
-
-		for (FBoneReference boneRef : MotionDataAsset->PoseMatchingBones)
-			PoseMatchingBones.Add(boneRef);
-
 		CenterOfMassBone = MotionDataAsset->CenterOfMassBone;
 
 		footLockReceivers.Empty(2);
@@ -145,39 +154,38 @@ void FAnimNode_MotionMatcher::Initialize_AnyThread(const FAnimationInitializeCon
 		footLockFeet.Add(MotionDataAsset->LeftFoot);
 		footLockFeet.Add(MotionDataAsset->RightFoot);
 
-		// Trajectory stuff
+		footLock.Reset();
+		footLockComponent = Cast<UMotionMatcherComponent>(owningActor->GetComponentByClass(UMotionMatcherComponent::StaticClass()));
 
-		// Reserve some space for the desired trajectory.
-		desiredTrajectory.Empty();
-		desiredTrajectory.AddDefaulted(MotionDataAsset->TrajectoryTimings.Num());
+		// Optional IK curves. Resolve the names once so evaluation doesn't have to search the skeleton.
+		leftIKCurveUID = SmartName::MaxUID;
+		rightIKCurveUID = SmartName::MaxUID;
 
-		firstFutureTrajectoryTiming = 0;
-		for (int32 i = 0; i != MotionDataAsset->TrajectoryTimings.Num(); ++i)
+		if (const USkeleton* skeleton = Context.AnimInstanceProxy->GetSkeleton())
 		{
-			if (MotionDataAsset->TrajectoryTimings[i] < 0.f) continue;
+			if (LeftIKAlphaCurveName != NAME_None)
+				leftIKCurveUID = skeleton->GetUIDByName(USkeleton::AnimCurveMappingName, LeftIKAlphaCurveName);
 
-			firstFutureTrajectoryTiming = i;
-			break;
+			if (RightIKAlphaCurveName != NAME_None)
+				rightIKCurveUID = skeleton->GetUIDByName(USkeleton::AnimCurveMappingName, RightIKAlphaCurveName);
 		}
 
-		lastTrajectoryTime = MotionDataAsset->TrajectoryTimings[MotionDataAsset->TrajectoryTimings.Num() - 1];
-
-		//
-		// Past trajectory recording
-		//
+		if (leftIKCurveUID != SmartName::MaxUID || rightIKCurveUID != SmartName::MaxUID)
+			Features |= EMMatcherFeatures::IKCurves;
 
-		// The first element. We always assume these timings are sorted.
-		const float& firstTiming = MotionDataAsset->TrajectoryTimings[0];
+		// Trajectory stuff
 
-		if (firstTiming < 0.f)
-		{
-			maxHistoryLength = FMath::Abs(firstTiming);
+		// Reserve some space for the desired trajectory.
+		desiredTrajectory.Empty();
+		desiredTrajectory.AddDefaulted(database->TrajectoryTimings.Num());
 
-			int32 historyCount = FMath::CeilToInt(maxHistoryLength / RECORD_SAMPLE_RATE);
+		bSnapToNearestSample = database->SamplingRate <= SnapToNearestSampleRate;
+		sampleRow.SetNumUninitialized(database->Layout.Stride);
+		searchQuery.SetNumUninitialized(database->Layout.SearchDims);
 
-			pastHistory.Empty();
-			pastHistory.AddDefaulted(historyCount + 1);
-		}
+		// Past trajectory recording
+		pastHistory.Empty();
+		pastHistory.AddDefaulted(database->HistoryCount);
 
 		//
 		// Custom Root Motion
@@ -187,14 +195,9 @@ void FAnimNode_MotionMatcher::Initialize_AnyThread(const FAnimationInitializeCon
 
 		if (moveComp)
 		{
-			TSharedPtr<FRootMotionSource_Custom> customRootMotion = MakeShared<FRootMotionSource_Custom>();
-			customRootMotion->InstanceName = "MM_ROOT_WARPING";
-			customRootMotion->AccumulateMode = ERootMotionAccumulateMode::Override;
-			customRootMotion->Priority = 500;
-			customRootMotion->bInLocalSpace = false;
-			customRootMotion->Settings.SetFlag(ERootMotionSourceSettingsFlags::IgnoreZAccumulate);
-			RootMotionSourceID = moveComp->ApplyRootMotionSource(customRootMotion);
-			UE_LOG(LogTemp, Warning, TEXT("FOUND MOVECOMP"));
+			RootMotionSourceID = FMotionMatchingRootMotion::AddSource(*moveComp);
+
+			Features |= EMMatcherFeatures::RootMotion;
 		}
 	}
 }
@@ -207,271 +210,293 @@ void FAnimNode_MotionMatcher::CacheBones_AnyThread(const FAnimationCacheBonesCon
 
 	FBoneContainer& BoneContainer = Context.AnimInstanceProxy->GetRequiredBones();
 
-	for (FBoneReference& boneRef : PoseMatchingBones)
-	{
-		boneRef.Initialize(BoneContainer);
-		//if (boneRef.IsValidToEvaluate()){}
-	}
-
 	for (FBoneReference& boneRef : footLockReceivers)
 		boneRef.Initialize(BoneContainer);
 
 	for (FBoneReference& boneRef : footLockFeet) {
 		boneRef.Initialize(BoneContainer);
-		UE_LOG(LogTemp, Warning, TEXT("footLockFeet INITIALIZED is valid?: %d"), boneRef.IsValidToEvaluate());
+		MM_LOG(TEXT("footLockFeet INITIALIZED is valid?: %d"), boneRef.IsValidToEvaluate());
 	}
 
 	CenterOfMassBone.Initialize(BoneContainer);
 
-	//MotionDataAsset->LeftFoot
-	//BasePose.CacheBones(Context);
-}
+	// Required bones (LOD) changed so the bone dependent features may have too.
+	Features &= ~(EMMatcherFeatures::FootLock | EMMatcherFeatures::FootLockReceivers | EMMatcherFeatures::CenterOfMass);
 
-float InterpFacing(float desired, float dt)
-{
-	float newSpeed = (desired < 0.0f) ? -180.f : 180.f;
-	const float AngleTolerance = 0.1f;
+	auto allValid = [&BoneContainer](const TArray<FBoneReference>& bones) {
+		for (const FBoneReference& boneRef : bones)
+		{
+			if (!boneRef.IsValidToEvaluate(BoneContainer)) return false;
+		}
+		return bones.Num() != 0;
+	};
 
-	if (FMath::IsNearlyEqual(desired, 0.0f, AngleTolerance))
-	{
-		newSpeed = 0.0f;
-	}
+	const bool bFeetMatched = database.IsValid() && database->FootBoneIndices[0] != INDEX_NONE && database->FootBoneIndices[1] != INDEX_NONE;
+
+	if (allValid(footLockFeet) && bFeetMatched)
+		Features |= EMMatcherFeatures::FootLock;
 
-	float inputDerived = desired * 2.0f;
-	newSpeed = FMath::Lerp(newSpeed, inputDerived, 0.9f);
+	if (allValid(footLockFeet) && allValid(footLockReceivers))
+		Features |= EMMatcherFeatures::FootLockReceivers;
 
-	return newSpeed;
+	if (CenterOfMassBone.IsValidToEvaluate(BoneContainer))
+		Features |= EMMatcherFeatures::CenterOfMass;
+
+	//MotionDataAsset->LeftFoot
+	//BasePose.CacheBones(Context);
 }
 
-void FAnimNode_MotionMatcher::Update_AnyThread(const FAnimationUpdateContext& Context)
+void FAnimNode_MotionMatcher::Simulate(float deltaTime, float actorYaw, UAnimInstance* AnimInstance)
 {
-	DECLARE_SCOPE_HIERARCHICAL_COUNTER_ANIMNODE(Update_AnyThread)
-	GetEvaluateGraphExposedInputs().Execute(Context); // This lets us use the connected inputs.
+	hot.timeSinceLastMatch += deltaTime;
+	hot.timeSinceLastSave += deltaTime;
+	hot.timeSinceLastBlend += deltaTime;
 
-	if (!owningActor || !bHasValidMotionData) return;
+	// Smooth the input
+	hot.desiredVecA = FMath::VInterpTo(hot.desiredVecA, Input.DesiredVector * (SpeedMultiplier * 120), deltaTime, 12.f);
 
-	//
-	// Forward declarations and variable updating
-	//
+	float stoppingBias = FVector::DistSquared2D(FVector::ZeroVector, hot.desiredVecA);
 
-	if (bFirstUpdate)
-	{
-		bFirstUpdate = false;
+	// Change interpolation speed to tweak instability sensitivity.
+	hot.inputSteady = FMath::VInterpTo(hot.inputSteady, Input.DesiredVector, deltaTime, 0.4f);
 
-		// This object let's us communicate with the outside world!
+	hot.steadyBias = FMotionDatabase::GetSteadyBias(Input.DesiredVector, hot.inputSteady, Input.DesiredFacing);
 
-		if (MotionMatcherInterface)
-			MotionMatcherInterface->PairAnimNode(this);
+	// Update our blends that are supposedly active in our inert nodes array. May not be accurate.
 
-		// We support multiple inertialization nodes to support a high number of concurrent transitions.
-		// Too bad GetAncestor() only returns 1 node so we're gonna have to go through the node stack here.
+	// Playback moves with the simulation, see Update_AnyThread(). Older clips of the blend stack keep playing while they fade out.
+	hot.currentPlayData.SimulatedPlayTime = database->AdvanceTime(hot.currentPlayData.MatchedStateIndex, hot.currentPlayData.SimulatedPlayTime, deltaTime * hot.currentTimeScaleWarp);
 
-		using FKey = FObjectKey;
-		using FNodeStack = TArray<FAnimNode_Base*, TInlineAllocator<4>>;
-		const FNodeStack* Stack = Context.GetSharedContext()->AncestorTracker.Map.Find(FKey(FAnimNode_Inertialization::StaticStruct()));
+	for (FMMatcherBlendLayer& layer : blendStack)
+	{
+		layer.Time = database->AdvanceTime(layer.StateIndex, layer.Time, deltaTime);
+		layer.Age += deltaTime;
+	}
 
-		if (Stack)
+	// A layer that has fully faded in hides everything below it.
+	if (hot.timeSinceLastBlend >= hot.currentPlayData.BlendTime)
+	{
+		blendStack.Reset();
+	}
+	else
+	{
+		for (int32 i = blendStack.Num() - 1; i > 0; --i)
 		{
-			inertializationNodes.AddDefaulted(Stack->Num());
-
-			for (int32 i = 0; i != inertializationNodes.Num(); ++i)
+			if (blendStack[i].Age >= blendStack[i].BlendTime)
 			{
-				if ((*Stack).IsValidIndex(i))
-					inertializationNodes[i].Node = static_cast<FAnimNode_Inertialization*>((*Stack)[i]);
+				blendStack.RemoveAt(0, i, false);
+				break;
 			}
 		}
-
-		// Setup our pose watcher if it exists.
-		poseWatcher = Context.GetAncestor<FAnimNode_PoseWatcher>();
-
-		if (poseWatcher)
-			poseWatcher->SetupBones(MotionDataAsset->PoseMatchingBones);
 	}
 
-	float deltaTime = Context.GetDeltaTime();
-	timeSinceLastMatch += deltaTime;
-	timeSinceLastSave += deltaTime;
-	timeSinceLastBlend += deltaTime;
-	bAnimChanged = false;
+	for (auto& node : inertializationNodes)
+	{
+		for (int32 i = 0; i != node.ActiveBlends.Num(); ++i)
+			node.ActiveBlends[i] -= deltaTime;
 
-	FTransform actorT = owningActor->GetActorTransform();
+		node.ActiveBlends.RemoveAll([](float Val) {
+			return !(Val >= 0.f);
+		});
+	}
 
-	FRotator actorRotDelta = actorT.GetRotation().Rotator() - lastRotation;
-	actorRotDelta.Normalize();
+	//
+	// Build the Desired Trajectory
+	//
 
-	lastPosition = actorT.GetLocation();//owningActor->GetActorLocation();
-	lastRotation = actorT.GetRotation().Rotator();
+	{
+		MM_SCOPE_CYCLE_COUNTER(STAT_MMTrajectory);
 
-	float actorYaw = lastRotation.Yaw + (localMeshCompRot.Z);
+		FVector currentVelocity[32];
 
-	currentRootVelocity = owningActor->GetVelocity();
-	turnSpeed = actorRotDelta.Yaw / deltaTime;
+		for (int32 i = database->FirstFutureTrajectoryTiming - database->FirstFutureTrajectoryTiming, y = 0; i != database->TrajectoryTimings.Num(); ++i, ++y)
+		{
+			if (!database->TrajectoryTimings.IsValidIndex(i)) continue;
+			currentVelocity[y] = hot.currentRootVelocity * database->TrajectoryTimings[i];
+		}
 
-	// Smooth the input
-	desiredVecA = FMath::VInterpTo(desiredVecA, Input.DesiredVector * (SpeedMultiplier * 120), Context.GetDeltaTime(), 12.f);
+		float currentYaw = 0.0f;
 
-	float stoppingBias = FVector::DistSquared2D(FVector::ZeroVector, desiredVecA);
-	avgInputDir = UKismetMathLibrary::DynamicWeightedMovingAverage_FVector(Input.DesiredVector * (SpeedMultiplier * 120), avgInputDir, 1.02f, 0.0f, 0.08f);
+		// The path to follow, if any, sampled at every future point at once.
+		const bool bPathInput = path.IsValid();
+		TArray<FVector, TInlineAllocator<16>> pathPositions;
+		TArray<float, TInlineAllocator<16>> pathFacings;
 
-	// Change interpolation speed to tweak instability sensitivity.
-	inputSteady = FMath::VInterpTo(inputSteady, Input.DesiredVector, Context.GetDeltaTime(), 0.4f);
+		if (bPathInput)
+		{
+			pathPositions.SetNumUninitialized(database->TrajectoryTimings.Num());
+			pathFacings.SetNumUninitialized(database->TrajectoryTimings.Num());
+			path.Sample(database->TrajectoryTimings.GetData(), database->TrajectoryTimings.Num(), MMCore::TrajectoryInput(), pathPositions.GetData(), pathFacings.GetData());
+		}
 
-	float inputSteadiness = FVector::DistSquared(Input.DesiredVector, inputSteady);
-	float facingSteadiness = FMath::Abs(Input.DesiredFacing) * 0.02f;
-	steadyBias = 1.0f - FMath::Clamp(inputSteadiness + facingSteadiness, 0.f, 1.0f);
+		// Optional spring prediction of every future point at once.
+		const bool bSpringPrediction = !bPathInput && TrajectoryHalfLife > 0.f;
+		TArray<FVector, TInlineAllocator<16>> springPositions;
+		TArray<float, TInlineAllocator<16>> springFacings;
 
-	// Update our blends that are supposedly active in our inert nodes array. May not be accurate.
+		if (bSpringPrediction)
+		{
+			if (trajectoryPredictor.GetHalfLife() != TrajectoryHalfLife || trajectoryPredictor.GetNumTimings() != database->TrajectoryTimings.Num())
+				trajectoryPredictor.Init(database->TrajectoryTimings.GetData(), database->TrajectoryTimings.Num(), TrajectoryHalfLife, TrajectoryHalfLife);
 
-	for (auto& inertialization : inertializationNodes)
-	{
-		for (int32 i = 0; i != inertialization.ActiveBlends.Num(); ++i)
-			inertialization.ActiveBlends[i] -= deltaTime;
+			const FVector velocity = hot.currentRootVelocity.RotateAngleAxis(-1 * actorYaw, FVector::UpVector);
 
-		inertialization.ActiveBlends.RemoveAll([](float Val) {
-			return !(Val >= 0.f);
-		});
-	}
+			MMCore::TrajectoryInput trajectoryInput;
+			FMemory::Memcpy(trajectoryInput.Velocity, &velocity.X, sizeof(trajectoryInput.Velocity));
+			FMemory::Memcpy(trajectoryInput.DesiredVelocity, &hot.desiredVecA.X, sizeof(trajectoryInput.DesiredVelocity));
+			trajectoryInput.TurnSpeed = hot.turnSpeed;
+			trajectoryInput.DesiredFacing = Input.DesiredFacing;
 
-	//
-	// Build the Desired Trajectory
-	//
+			springPositions.SetNumUninitialized(database->TrajectoryTimings.Num());
+			springFacings.SetNumUninitialized(database->TrajectoryTimings.Num());
+			trajectoryPredictor.Predict(trajectoryInput, &springPositions.GetData()->X, springFacings.GetData());
+		}
 
-	FVector currentVelocity[32];
+		for (int32 i = 0; i != database->TrajectoryTimings.Num(); ++i)
+		{
+			const float& timing = database->TrajectoryTimings[i];
+			desiredTrajectory[i].Position = FVector::ZeroVector;
 
-	for (int32 i = firstFutureTrajectoryTiming - firstFutureTrajectoryTiming, y = 0; i != MotionDataAsset->TrajectoryTimings.Num(); ++i, ++y)
-	{
-		if (!MotionDataAsset->TrajectoryTimings.IsValidIndex(i)) continue;
-		currentVelocity[y] = currentRootVelocity * MotionDataAsset->TrajectoryTimings[i];
-	}
+			if (timing < 0.f) // Add past trajectory to the desired trajectory.
+			{
+				float rewindTime = FMath::Abs(timing);
+				int32 historyIndex = FMath::FloorToInt(rewindTime / MOTION_MATCHING_RECORD_RATE);
 
-	float currentYaw = 0.0f;
+				desiredTrajectory[i].Position = FVector::ZeroVector;
 
-	for (int32 i = 0; i != MotionDataAsset->TrajectoryTimings.Num(); ++i)
-	{
-		const float& timing = MotionDataAsset->TrajectoryTimings[i];
-		desiredTrajectory[i].Position = FVector::ZeroVector;
+				if (pastHistory.IsValidIndex(historyIndex)) {
+					FPastSnapshot& snap = pastHistory[historyIndex];
 
-		if (timing < 0.f) // Add past trajectory to the desired trajectory.
-		{
-			float rewindTime = FMath::Abs(timing);
-			int32 historyIndex = FMath::FloorToInt(rewindTime / RECORD_SAMPLE_RATE);
+					if (snap.Position != FVector::ZeroVector) // Most likely a default snapshot.
+					{
+						FVector position = snap.Position + ((snap.Velocity) * (snap.TimeSince) - snap.Velocity * rewindTime)
+							- hot.lastPosition;
+						position = position.RotateAngleAxis(90 - owningActor->GetActorRotation().Yaw, FVector::UpVector);
 
-			desiredTrajectory[i].Position = FVector::ZeroVector;
+						FRotator rotDelta = snap.Rotation - hot.lastRotation;
+						rotDelta.Normalize();
 
-			if (pastHistory.IsValidIndex(historyIndex)) {
-				FPastSnapshot& snap = pastHistory[historyIndex];
+						desiredTrajectory[i].Position = position;
+						desiredTrajectory[i].Facing = rotDelta.Yaw;
+					}
+				}
 
-				if (snap.Position != FVector::ZeroVector) // Most likely a default snapshot.
+				if (i == database->FirstFutureTrajectoryTiming - 1) // last historical point
 				{
-					FVector position = snap.Position + ((snap.Velocity) * (snap.TimeSince) - snap.Velocity * rewindTime)
-						- lastPosition;
-					position = position.RotateAngleAxis(90 - owningActor->GetActorRotation().Yaw, FVector::UpVector);
-
-					FRotator rotDelta = snap.Rotation - lastRotation;
-					rotDelta.Normalize();
-
-					desiredTrajectory[i].Position = position;
-					desiredTrajectory[i].Facing = rotDelta.Yaw;
+					currentYaw = -1.f * desiredTrajectory[i].Facing / database->TrajectoryTimings[i];
 				}
 			}
-
-			if (i == firstFutureTrajectoryTiming - 1) // last historical point
+			else if (bPathInput)
 			{
-				currentYaw = -1.f * desiredTrajectory[i].Facing / MotionDataAsset->TrajectoryTimings[i];
+				desiredTrajectory[i].Position = pathPositions[i];
+				desiredTrajectory[i].Facing = pathFacings[i];
 			}
-		}
-		else // Future desired trajectory. I've tried using springs but nothing looked as good as simply blending with velocity.
-		{
-			const float& timingDelta = MotionDataAsset->TrajectoryTimings[i]; // e.g., -0.2, 0.5, 1.8, etc.
-			const float& timingDeltaAlpha = MotionDataAsset->TrajectoryTimings[i] / lastTrajectoryTime;
+			else if (bSpringPrediction)
+			{
+				desiredTrajectory[i].Position = springPositions[i];
+				desiredTrajectory[i].Facing = springFacings[i];
+			}
+			else // Future desired trajectory. I've tried using springs but nothing looked as good as simply blending with velocity.
+			{
+				const float& timingDelta = database->TrajectoryTimings[i]; // e.g., -0.2, 0.5, 1.8, etc.
+				const float& timingDeltaAlpha = database->TrajectoryTimings[i] / database->LastTrajectoryTime;
 
-			currentVelocity[i] = currentVelocity[i].RotateAngleAxis(-1 * actorYaw, FVector::UpVector);
+				currentVelocity[i] = currentVelocity[i].RotateAngleAxis(-1 * actorYaw, FVector::UpVector);
 
-			desiredTrajectory[i].Position = FMath::Lerp(currentVelocity[i], desiredVecA * timingDelta, timingDelta / lastTrajectoryTime);
-			desiredTrajectory[i].Facing = FMath::Clamp(FMath::FInterpTo(turnSpeed * timingDelta, Input.DesiredFacing * timingDelta, timingDelta / lastTrajectoryTime, 3.f), -90.f, 90.f);//InterpFacing(Input.DesiredFacing, timingDelta)* timingDelta;
+				desiredTrajectory[i].Position = FMath::Lerp(currentVelocity[i], hot.desiredVecA * timingDelta, timingDelta / database->LastTrajectoryTime);
+				desiredTrajectory[i].Facing = FMath::Clamp(FMath::FInterpTo(hot.turnSpeed * timingDelta, Input.DesiredFacing * timingDelta, timingDelta / database->LastTrajectoryTime, 3.f), -90.f, 90.f);//InterpFacing(Input.DesiredFacing, timingDelta)* timingDelta;
 
 
-			if (i == MotionDataAsset->TrajectoryTimings.Num() - 1)
-			{
-				desiredTrajectory[i].Facing = Input.DesiredFacing;
-			}
+				if (i == database->TrajectoryTimings.Num() - 1)
+				{
+					desiredTrajectory[i].Facing = Input.DesiredFacing;
+				}
 
-			//desiredTrajectory[i].Facing = UKismetMathLibrary::FInterpEaseInOut(currentYaw, Input.DesiredFacing, timingDeltaAlpha, 2.f);
+				//desiredTrajectory[i].Facing = UKismetMathLibrary::FInterpEaseInOut(currentYaw, Input.DesiredFacing, timingDeltaAlpha, 2.f);
 
 //			UE_LOG(LogTemp, Warning, TEXT("speed: %s"), *f(desiredTrajectory[i].Facing));
 
 
-			//desiredTrajectory[i].Facing = 45.f * timingDelta;
+				//desiredTrajectory[i].Facing = 45.f * timingDelta;
 
-			//desiredTrajectory[i].Facing = UKismetMathLibrary::FloatSpringInterp(turnSpeed * timingDelta, Input.DesiredFacing, fakeState, 25.0f, 1.0f, timingDelta / lastTrajectoryTime, 1.0f);
-			//desiredTrajectory[i].Facing = FMath::Lerp(turnSpeed * timingDelta, Input.DesiredFacing * timingDelta, timingDelta / lastTrajectoryTime);
-			//desiredTrajectory[i].Facing = FMath::FInterpTo(turnSpeed * timingDelta, Input.DesiredFacing, timingDelta / lastTrajectoryTime, 12.f);
-			//desiredTrajectory[i].Facing = FMath::FInterpConstantTo(turnSpeed * timingDelta, Input.DesiredFacing, timingDelta / lastTrajectoryTime, 2200.f);
-			//UE_LOG(LogTemp, Warning, TEXT("Time: %f, Facing: %f"), turnSpeed * timingDelta, Input.DesiredFacing);
+				//desiredTrajectory[i].Facing = UKismetMathLibrary::FloatSpringInterp(turnSpeed * timingDelta, Input.DesiredFacing, fakeState, 25.0f, 1.0f, timingDelta / lastTrajectoryTime, 1.0f);
+				//desiredTrajectory[i].Facing = FMath::Lerp(turnSpeed * timingDelta, Input.DesiredFacing * timingDelta, timingDelta / lastTrajectoryTime);
+				//desiredTrajectory[i].Facing = FMath::FInterpTo(turnSpeed * timingDelta, Input.DesiredFacing, timingDelta / lastTrajectoryTime, 12.f);
+				//desiredTrajectory[i].Facing = FMath::FInterpConstantTo(turnSpeed * timingDelta, Input.DesiredFacing, timingDelta / lastTrajectoryTime, 2200.f);
+				//UE_LOG(LogTemp, Warning, TEXT("Time: %f, Facing: %f"), turnSpeed * timingDelta, Input.DesiredFacing);
 
-			//CubicInterp::
-			//FMath::FInterpConstantTo();
+				//CubicInterp::
+				//FMath::FInterpConstantTo();
+			}
 		}
 	}
 
-	yawStep = InterpFacing(Input.DesiredFacing, deltaTime) * deltaTime;
-
 	// Past trajectory history
 
-	if (timeSinceLastSave > RECORD_SAMPLE_RATE && firstFutureTrajectoryTiming != 0)
 	{
-		timeSinceLastSave = 0.f;
-
-		FPastSnapshot snapshot;
-		snapshot.Position = owningActor->GetActorLocation();
-		snapshot.Rotation = owningActor->GetActorRotation();
-		snapshot.Velocity = owningActor->GetVelocity();
-		// snapshot.Facing ???
-		snapshot.Facing = turnSpeed;
-		snapshot.TimeSince = 0.f;
-
-		pastHistory.Pop();
-		pastHistory.Insert(snapshot, 0);
-	}
+		MM_SCOPE_CYCLE_COUNTER(STAT_MMPastHistory);
 
-	for (auto& record : pastHistory)
-		record.TimeSince += deltaTime;
+		if (hot.timeSinceLastSave > MOTION_MATCHING_RECORD_RATE && database->FirstFutureTrajectoryTiming != 0)
+		{
+			hot.timeSinceLastSave = 0.f;
+
+			FPastSnapshot snapshot;
+			snapshot.Position = owningActor->GetActorLocation();
+			snapshot.Rotation = owningActor->GetActorRotation();
+			snapshot.Velocity = owningActor->GetVelocity();
+			// snapshot.Facing ???
+			snapshot.Facing = hot.turnSpeed;
+			snapshot.TimeSince = 0.f;
+
+			pastHistory.Pop();
+			pastHistory.Insert(snapshot, 0);
+		}
 
-	//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		for (auto& record : pastHistory)
+			record.TimeSince += deltaTime;
+	}
+
+	// Find out our current motion.
+	EvaluatePoseSample(hot.currentPlayData.MatchedStateIndex, hot.currentPlayData.SimulatedPlayTime, currentPose);
 
-	if (UAnimInstance* AnimInstance = Cast<UAnimInstance>(Context.AnimInstanceProxy->GetAnimInstanceObject()))
 	{
-		// Find out our current motion.
-		EvaluatePoseSample(currentPlayData.MatchedStateIndex, currentPlayData.CurrentPlayTime, currentPose);
+		MM_SCOPE_CYCLE_COUNTER(STAT_MMNormalization);
 
 		// Pose sample pre-process includes normalization so we need to normalize and apply weights to our new trajectory.
 		MotionDataAsset->NormalizeTrajectory(desiredTrajectory);
 
 		// use real velocity?
-		currentPose.RootVelocity = currentRootVelocity;
+		currentPose.RootVelocity = hot.currentRootVelocity;
 		currentPose.RootVelocity = currentPose.RootVelocity.RotateAngleAxis(-1 * actorYaw, FVector::UpVector);
 		MotionDataAsset->NormalizeFeature(currentPose.RootVelocity, MotionDataAsset->NormalData_RootVelocity);
 		currentPose.RootVelocity *= MotionDataAsset->RootVelocityWeight;
+	}
 
-		//
-		// Update foot IK locking from current pose
-		//
+	//
+	// Update foot IK locking from current pose
+	//
 
-		UpdateFootLock(deltaTime, AnimInstance);
+	UpdateFootLock(deltaTime, AnimInstance);
 
-		if (timeSinceLastMatch > MOTION_MATCHING_INTERVAL)
-		{
-			MatchNow();
-		}
+	if (ShouldSearch())
+	{
+		MatchNow();
+	}
+	else
+	{
+		INC_DWORD_STAT(STAT_MMSearchesSkipped);
+	}
 
 
-		////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 
-		//
-		// Candiate Warping to match even better the desired pose/trajectory.
-		//
+	//
+	// Candiate Warping to match even better the desired pose/trajectory.
+	//
 
+	{
+		MM_SCOPE_CYCLE_COUNTER(STAT_MMRootMotionWarping);
 
 		TArray<FTrajectoryPoint> rawCurrentTraj = currentPose.Trajectory;
 		TArray<FTrajectoryPoint> rawDesiredTraj = desiredTrajectory;
@@ -489,17 +514,17 @@ void FAnimNode_MotionMatcher::Update_AnyThread(const FAnimationUpdateContext& Co
 		// Only time warp if there's input. Otherwise stay at 1.0 to quickly finish the stop animation.
 		if (Input.DesiredVector.SizeSquared() > 0.1f)
 		{
-			currentTimeScaleWarp = FMath::Clamp(desiredSpeed / futureSpeed, 0.8f, 1.2f); // clamp to 20% diff. 
+			hot.currentTimeScaleWarp = FMath::Clamp(desiredSpeed / futureSpeed, 0.8f, 1.2f); // clamp to 20% diff. 
 		}
 		else {
-			currentTimeScaleWarp = 1.0f;
+			hot.currentTimeScaleWarp = 1.0f;
 		}
 
 
 
 		// Trajectory warp
 
-		if (moveComp)
+		if (moveComp && HasFeature(EMMatcherFeatures::RootMotion))
 		{
 			TSharedPtr<FRootMotionSource> RMS = moveComp->GetRootMotionSourceByID(RootMotionSourceID);
 			if (RMS.IsValid() && RMS->GetScriptStruct() == FRootMotionSource_Custom::StaticStruct())
@@ -507,22 +532,14 @@ void FAnimNode_MotionMatcher::Update_AnyThread(const FAnimationUpdateContext& Co
 				FRootMotionSource_Custom* customRootMotion = static_cast<FRootMotionSource_Custom*>(RMS.Get());
 				if (customRootMotion)
 				{
-					FTransform rootT;
-
-					FQuat rootMotionQuat = rootMotion.GetRotation();
-
-					FVector inputPos = (lastInputVec * 1).RotateAngleAxis(localMeshCompRot.Z, FVector::UpVector);
-					FVector rootPos = (rootMotion.GetLocation() * 120).RotateAngleAxis(actorYaw, FVector::UpVector);
-
-
 					FVector DesiredDirection = FVector::ZeroVector;
 					const float FacingAngle = FMath::DegreesToRadians(lastDesiredPoint.Facing);
 					DesiredDirection = FVector(FMath::Sin(FacingAngle), 0.0f, FMath::Cos(FacingAngle)).GetSafeNormal() * -1.0f;
 
 					//DesiredDirection.HeadingAngle()
 
-					FVector vecA = rawCurrentTraj[firstFutureTrajectoryTiming].Position;
-					FVector vecB = rawDesiredTraj[firstFutureTrajectoryTiming].Position;
+					FVector vecA = rawCurrentTraj[database->FirstFutureTrajectoryTiming].Position;
+					FVector vecB = rawDesiredTraj[database->FirstFutureTrajectoryTiming].Position;
 
 					//float sizeA = FMath::Clamp(vecA.Size() * 0.016f, 0.f, 1.0f);
 					// The angle for rotation error warping (or steering) doesn't matter if we're moving too slow.
@@ -547,65 +564,195 @@ void FAnimNode_MotionMatcher::Update_AnyThread(const FAnimationUpdateContext& Co
 					// (Idle^Walk, StrafeRight^StrafeLeft, Forward^Backward, etc.)
 					if (dot > KINDA_SMALL_NUMBER)
 					{
-						rootRotWarp = FMath::FInterpTo(rootRotWarp, angle, deltaTime, 3.0f);
+						hot.rootRotWarp = FMath::FInterpTo(hot.rootRotWarp, angle, deltaTime, 3.0f);
 						//rootRotWarp = angle * sizeB;
 					}
 					/*else
 					{
-						rootRotWarp = 0.f; // new stuff
+						hot.rootRotWarp = 0.f; // new stuff
 					}*/
 
 					// If we just switched animations, reset the rotation to prevent a jump.
-					if (bAnimChanged)
-						rootRotWarp = 0.f;
+					if (hot.bAnimChanged)
+						hot.rootRotWarp = 0.f;
+
+					// Character movement
+					hot.rootMotionSpring.Update(Input.DesiredVector, Input.DesiredFacing, actorYaw, deltaTime);
+
+					// Apply the root motion
+					customRootMotion->RootMotion = hot.rootMotionSpring.GetTransform();
+				}
+			}
+		} // if moveComp
+	}
+}
+
+void FAnimNode_MotionMatcher::Update_AnyThread(const FAnimationUpdateContext& Context)
+{
+	DECLARE_SCOPE_HIERARCHICAL_COUNTER_ANIMNODE(Update_AnyThread)
+	MM_SCOPE_CYCLE_COUNTER(STAT_MMUpdate);
 
-					// Character movement 
+	const uint64 updateStart = FPlatformTime::Cycles64();
+	ON_SCOPE_EXIT { if (budget) budget->ReportUpdate(FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - updateStart) * 1000.0); };
 
-					const float halfLife = 0.4f; // 0.2f;
+	GetEvaluateGraphExposedInputs().Execute(Context); // This lets us use the connected inputs.
 
-					FVector correctedInput = (120.0f * Input.DesiredVector).RotateAngleAxis(actorYaw, FVector::UpVector);
+	if (!owningActor || !bHasValidMotionData) return;
 
-					traj_xv_goal = correctedInput.X;
-					traj_yv_goal = correctedInput.Y;
+	//
+	// Forward declarations and variable updating
+	//
 
-					spring_character_update(trajx, trajxv, trajxa, traj_xv_goal, halfLife, deltaTime);
-					spring_character_update(trajy, trajyv, trajya, traj_yv_goal, halfLife, deltaTime);
+	if (bFirstUpdate)
+	{
+		bFirstUpdate = false;
 
-					//FQuat inputQuat = FQuat::MakeFromEuler(FVector(0.f, 0.f, lastDesiredPoint.Facing) * deltaTime);
-					const float& facing = rawDesiredTraj[firstFutureTrajectoryTiming].Facing;
+		// This object let's us communicate with the outside world!
 
-					//float pointTurnSpeed = yawStep;//facing / firstFutureTrajectoryTiming;
+		if (MotionMatcherInterface)
+			MotionMatcherInterface->PairAnimNode(this);
 
-					FQuat inputQuat = FQuat::MakeFromEuler(FVector(0.f, 0.f, yawStep));
-					//					UE_LOG(LogTemp, Warning, TEXT("pointTurnSpeed %f"), pointTurnSpeed);
-										//FQuat inputQuat = FQuat::MakeFromEuler(FVector(0.f, 0.f, 0.f * deltaTime));
+		// We support multiple inertialization nodes to support a high number of concurrent transitions.
+		// Too bad GetAncestor() only returns 1 node so we're gonna have to go through the node stack here.
 
-					rootT.SetRotation(
-						//rootMotionQuat
-						//FQuat::FastLerp(rootMotionQuat, inputQuat, 0.5f)
-						inputQuat
-					);
-					rootT.SetLocation(FVector(trajxv, trajyv, 0.f));
-					
+		using FKey = FObjectKey;
+		using FNodeStack = TArray<FAnimNode_Base*, TInlineAllocator<4>>;
+		const FNodeStack* Stack = Context.GetSharedContext()->AncestorTracker.Map.Find(FKey(FAnimNode_Inertialization::StaticStruct()));
 
-					// Apply the root motion
-					customRootMotion->RootMotion = rootT;
-				}
+		if (Stack)
+		{
+			inertializationNodes.AddDefaulted(Stack->Num());
+
+			for (int32 i = 0; i != inertializationNodes.Num(); ++i)
+			{
+				if ((*Stack).IsValidIndex(i))
+					inertializationNodes[i].Node = static_cast<FAnimNode_Inertialization*>((*Stack)[i]);
 			}
-		} // if moveComp
+		}
+
+		// Setup our pose watcher if it exists.
+		poseWatcher = Context.GetAncestor<FAnimNode_PoseWatcher>();
+
+		UWorld* world = owningActor->GetWorld();
+		budget = world ? world->GetSubsystem<UMotionMatchingBudgetSubsystem>() : nullptr;
+		groundProbe = (world && bProbeGround) ? world->GetSubsystem<UMotionMatchingGroundProbeSubsystem>() : nullptr;
+
+		if (poseWatcher)
+			poseWatcher->SetupBones(MotionDataAsset->PoseMatchingBones);
+	}
+
+	// Frame time, split into whole steps in fixed step mode. See FixedTimeStep.
+	const float frameDeltaTime = Context.GetDeltaTime();
+	const float fixedTimeStep = FMotionMatchingFixedStep::GetTimeStep(FixedTimeStep);
+
+	float deltaTime;
+	const int32 numSteps = hot.fixedStep.Advance(frameDeltaTime, fixedTimeStep, MaxFixedSteps, deltaTime);
+
+	hot.bAnimChanged = false;
+	hot.bSearched = false;
+
+	FTransform actorT = owningActor->GetActorTransform();
+
+	hot.lastPosition = actorT.GetLocation();//owningActor->GetActorLocation();
+	hot.lastRotation = actorT.GetRotation().Rotator();
+
+	float actorYaw = hot.lastRotation.Yaw + (localMeshCompYaw);
+
+	hot.currentRootVelocity = owningActor->GetVelocity();
+
+	// Over the simulated time since the last step, so it only changes on steps too.
+	if (numSteps != 0 && deltaTime > 0.f)
+	{
+		hot.turnSpeed = FRotator::NormalizeAxis(hot.lastRotation.Yaw - hot.lastStepYaw) / (numSteps * deltaTime);
+		hot.lastStepYaw = hot.lastRotation.Yaw;
+	}
+
+	// Following a path: it replaces Input.DesiredVector and DesiredFacing (see FMMatcherInput::PathPoints), so root motion
+	// follows it as well.
+	if (Input.PathPoints.Num() != 0 && database->TrajectoryTimings.IsValidIndex(database->FirstFutureTrajectoryTiming))
+	{
+		const float maxSpeed = SpeedMultiplier * 120;
+		const FVector velocity = hot.currentRootVelocity.RotateAngleAxis(-1 * actorYaw, FVector::UpVector);
+
+		MMCore::TrajectoryInput trajectoryInput;
+		FMemory::Memcpy(trajectoryInput.Velocity, &velocity.X, sizeof(trajectoryInput.Velocity));
+		trajectoryInput.TurnSpeed = hot.turnSpeed;
+
+		path.Set(Input.PathPoints, (Input.PathSpeed > 0.f) ? Input.PathSpeed : maxSpeed, hot.lastPosition, actorYaw);
+		path.GetInput(database->TrajectoryTimings[database->FirstFutureTrajectoryTiming], database->LastTrajectoryTime, maxSpeed, trajectoryInput, Input.DesiredVector, Input.DesiredFacing);
+	}
+	else
+	{
+		path.Reset();
+	}
+
+	if (UAnimInstance* AnimInstance = Cast<UAnimInstance>(Context.AnimInstanceProxy->GetAnimInstanceObject()))
+	{
+		if (budget)
+		{
+			budget->ReportActive();
+
+			// Throttling depends on measured cost, which would make fixed step searches irreproducible.
+			if (fixedTimeStep <= 0.f)
+				hot.budgetDecision = budget->GetDecision(hot.lastPosition);
+		}
+
+		for (int32 step = 0; step != numSteps; ++step)
+			Simulate(deltaTime, actorYaw, AnimInstance);
+
+		ProbeGround();
 
 		// It's time to play the animation
-		FMMatcherState& State = MotionDataAsset->States[currentPlayData.MatchedStateIndex];
+		FMMatcherState& State = MotionDataAsset->States[hot.currentPlayData.MatchedStateIndex];
 		UAnimSequence* anim = State.Animation;
 
 		FAnimInstanceProxy* AnimProxy = Context.AnimInstanceProxy;
 		FAnimGroupInstance* SyncGroup;
 		FAnimTickRecord& TickRecord = AnimProxy->CreateUninitializedTickRecord(SyncGroup, NAME_None);
 
-		AnimProxy->MakeSequenceTickRecord(TickRecord, anim, State.bLoop, currentTimeScaleWarp, 1.0f, currentPlayData.CurrentPlayTime, currentPlayData.MarkerTickRecord);
+		// Show the last step plus the time not simulated yet, so a frame without a step doesn't freeze the pose while searches
+		// only ever see whole steps. The tick record plays from what was shown last to there, so notifies still fire.
+		const float renderTime = database->AdvanceTime(hot.currentPlayData.MatchedStateIndex, hot.currentPlayData.SimulatedPlayTime, hot.fixedStep.Accumulator * hot.currentTimeScaleWarp);
+		const float playLength = database->States[hot.currentPlayData.MatchedStateIndex].PlayLength;
+		float playedTime = renderTime - hot.currentPlayData.CurrentPlayTime;
+
+		if (State.bLoop && playedTime < -0.5f * playLength)
+			playedTime += playLength;
+
+		if (hot.bAnimChanged || playedTime < 0.f || frameDeltaTime <= 0.f)
+		{
+			hot.currentPlayData.CurrentPlayTime = renderTime;
+			playedTime = 0.f;
+		}
+
+		const float playRate = (frameDeltaTime > 0.f) ? playedTime / frameDeltaTime : 0.f;
+		AnimProxy->MakeSequenceTickRecord(TickRecord, anim, State.bLoop, playRate, 1.0f, hot.currentPlayData.CurrentPlayTime, hot.currentPlayData.MarkerTickRecord);
+
+		if (MotionMatcherInterface)
+		{
+			// Transition rate over roughly the last second.
+			const float rateAlpha = 1.f - FMath::Exp(-frameDeltaTime);
+			hot.transitionsPerSecond = FMath::Lerp(hot.transitionsPerSecond, (hot.bAnimChanged && frameDeltaTime > 0.f) ? 1.f / frameDeltaTime : 0.f, rateAlpha);
+
+			// The cold copy only changes when we search, the rest is per update.
+			FMotionMatcherTelemetry telemetry = cold->telemetry;
+			telemetry.bSearchSkipped = !hot.bSearched;
+			telemetry.TransitionsPerSecond = hot.transitionsPerSecond;
+			telemetry.ActiveBlends = 0;
+
+			for (const auto& node : inertializationNodes)
+				telemetry.ActiveBlends += node.ActiveBlends.Num();
+
+			if (inertialization.IsBlending())
+				telemetry.ActiveBlends++;
+
+			telemetry.ActiveBlends += blendStack.Num();
+
+			MotionMatcherInterface->PublishTelemetry(telemetry);
+		}
 
 #if WITH_EDITOR
-		if (bDebugMode) DrawDebug(Context); else if (debugWidget && debugWidget->bShow) debugWidget->bShow = 0;
+		if (bDebugMode) DrawDebug(Context); else if (cold->debugWidget && cold->debugWidget->bShow) cold->debugWidget->bShow = 0;
 #endif
 	}
 }
@@ -613,11 +760,10 @@ void FAnimNode_MotionMatcher::Update_AnyThread(const FAnimationUpdateContext& Co
 void FAnimNode_MotionMatcher::Evaluate_AnyThread(FPoseContext& Output)
 {
 	DECLARE_SCOPE_HIERARCHICAL_COUNTER_ANIMNODE(Evaluate_AnyThread)
+	MM_SCOPE_CYCLE_COUNTER(STAT_MMEvaluate);
 
-	// Calc root vel?
-	FVector newPose = Output.Pose.GetBones()[0].GetLocation();
-	rootBoneVel = newPose - rootBonePos;
-	rootBonePos = newPose;
+	const uint64 evaluateStart = FPlatformTime::Cycles64();
+	ON_SCOPE_EXIT { if (budget) budget->ReportUpdate(FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - evaluateStart) * 1000.0); };
 
 	if (!bHasValidMotionData)
 	{
@@ -627,18 +773,25 @@ void FAnimNode_MotionMatcher::Evaluate_AnyThread(FPoseContext& Output)
 
 	FAnimInstanceProxy* AnimProxy = Output.AnimInstanceProxy;
 
-	UAnimSequence* anim = MotionDataAsset->States[currentPlayData.MatchedStateIndex].Animation;
+	UAnimSequence* anim = MotionDataAsset->States[hot.currentPlayData.MatchedStateIndex].Animation;
 
 	// Single animation, no blending needed.
 	FAnimationPoseData AnimationPoseData(Output);
 
-	anim->GetAnimationPose(AnimationPoseData, FAnimExtractContext(currentPlayData.CurrentPlayTime, true));//Output.AnimInstanceProxy->ShouldExtractRootMotion()
-	rootMotion = anim->ExtractRootMotion(currentPlayData.CurrentPlayTime, AnimProxy->GetDeltaSeconds() * currentTimeScaleWarp, true);
+	if (UsesBlendStack() && blendStack.Num() != 0)
+		EvaluateBlendStack(Output);
+	else if (bUseSharedPoseCache)
+		FMotionMatchingPoseCache::Get().GetAnimationPose(anim, hot.currentPlayData.CurrentPlayTime, true, AnimationPoseData);
+	else
+		anim->GetAnimationPose(AnimationPoseData, FAnimExtractContext(hot.currentPlayData.CurrentPlayTime, true));//Output.AnimInstanceProxy->ShouldExtractRootMotion()
+
+	if (bBuiltInInertialization && !UsesBlendStack())
+		inertialization.Apply(Output, anim, hot.currentPlayData.CurrentPlayTime, AnimProxy->GetDeltaSeconds() * hot.currentTimeScaleWarp);
 
 	// Candidate warping of root
 
 	// Build our desired rotation
-	const FRotator DeltaRotation(rootRotWarp, 0.f, 0.f);
+	const FRotator DeltaRotation(hot.rootRotWarp, 0.f, 0.f);
 	const FQuat DeltaQuat(DeltaRotation);
 	const FQuat MeshToComponentQuat(FRotator::ZeroRotator);
 
@@ -651,7 +804,23 @@ void FAnimNode_MotionMatcher::Evaluate_AnyThread(FPoseContext& Output)
 	Output.Pose[RootBoneIndex].NormalizeRotation();
 
 
-	Output.Pose.GetBoneContainer();
+	// Optional IK stuff
+
+	if (HasFeature(EMMatcherFeatures::IKCurves))
+	{
+		if (leftIKCurveUID != SmartName::MaxUID)
+			Output.Curve.Set(leftIKCurveUID, hot.ik_left_alpha);
+
+		if (rightIKCurveUID != SmartName::MaxUID)
+			Output.Curve.Set(rightIKCurveUID, hot.ik_right_alpha);
+	}
+
+	// Everything below needs component space transforms. Skip building them if nothing uses them.
+	const bool bSmoothFootLock = HasFeature(EMMatcherFeatures::FootLock) && (MotionMatcherInterface || footLockComponent);
+
+	if (!bSmoothFootLock && !HasFeature(EMMatcherFeatures::CenterOfMass | EMMatcherFeatures::FootLockReceivers))
+		return;
+
 	const FBoneContainer& BoneContainer = AnimationPoseData.GetPose().GetBoneContainer();
 	
 	// Save new pose?
@@ -659,29 +828,26 @@ void FAnimNode_MotionMatcher::Evaluate_AnyThread(FPoseContext& Output)
 	//CSPose.InitPose(AnimationPoseData.GetPose());
 	CSPose.InitPose(Output.Pose);
 
-	if (CenterOfMassBone.IsValidToEvaluate(BoneContainer))
+	// The feet the next update smooths foot locks with. Validity is guaranteed by EMMatcherFeatures::FootLock.
+	if (bSmoothFootLock)
+	{
+		for (int32 foot = 0; foot != 2; ++foot)
+			footLock.SetFootTransform(foot, CSPose.GetComponentSpaceTransform(footLockFeet[foot].CachedCompactPoseIndex));
+	}
+
+	if (HasFeature(EMMatcherFeatures::CenterOfMass))
 	{
-		float actorYaw = owningActor->GetActorRotation().Yaw + (localMeshCompRot.Z);
+		float actorYaw = owningActor->GetActorRotation().Yaw + (localMeshCompYaw);
 
 		auto boneT = CSPose.GetComponentSpaceTransform(CenterOfMassBone.GetCompactPoseIndex(BoneContainer));
 		FVector bonePos = boneT.GetLocation();
 
-		centerOfMass = FVector2D(lastPosition.X, lastPosition.Y) + FVector2D(bonePos.X, bonePos.Y).GetRotated(actorYaw);
+		cold->centerOfMass = FVector2D(hot.lastPosition.X, hot.lastPosition.Y) + FVector2D(bonePos.X, bonePos.Y).GetRotated(actorYaw);
 	}
 
-	// Optional IK stuff
-
-	auto leftCurveUID = Output.AnimInstanceProxy->GetSkeleton()->GetUIDByName(USkeleton::AnimCurveMappingName, LeftIKAlphaCurveName);
-	auto rightCurveUID = Output.AnimInstanceProxy->GetSkeleton()->GetUIDByName(USkeleton::AnimCurveMappingName, RightIKAlphaCurveName);
-
-	if(leftCurveUID)
-		Output.Curve.Set(leftCurveUID, ik_left_alpha);
-
-	if (rightCurveUID)
-		Output.Curve.Set(rightCurveUID, ik_right_alpha);
-
+	if (!HasFeature(EMMatcherFeatures::FootLockReceivers))
+		return;
 
-	
 	FTransform ComponentTransform = Output.AnimInstanceProxy->GetComponentTransform();
 	
 	//ComponentTransform.SetRotation();csToWs.GetRotation()
@@ -689,10 +855,9 @@ void FAnimNode_MotionMatcher::Evaluate_AnyThread(FPoseContext& Output)
 	//Output.CustomAttributes.
 	for (int32 footIndex = 0; footIndex != 2; ++footIndex)
 	{
-		FBoneReference& footBone = footLockFeet[footIndex];
 		FBoneReference& vBone = footLockReceivers[footIndex];
 
-		if (footBone.IsValidToEvaluate() && vBone.IsValidToEvaluate())
+		// Validity is guaranteed by EMMatcherFeatures::FootLockReceivers.
 		{
 			FTransform NewBoneTM = CSPose.GetComponentSpaceTransform(vBone.CachedCompactPoseIndex);
 			//FCompactPoseBoneIndex vBoneIndex = vBone.GetCompactPoseIndex(BoneContainer);
@@ -704,7 +869,7 @@ void FAnimNode_MotionMatcher::Evaluate_AnyThread(FPoseContext& Output)
 
 			//NewBoneTM.SetLocation(Output.Pose[vBone.CachedCompactPoseIndex].GetLocation());
 			//UE_LOG(LogTemp, Warning, TEXT("NewBoneTM: %f, %f, %f"), NewBoneTM.GetScale3D().X, NewBoneTM.GetScale3D().Y, NewBoneTM.GetScale3D().Z);
-			UE_LOG(LogTemp, Warning, TEXT("NewBoneTM: %f, %f, %f"), NewBoneTM.GetLocation().X, NewBoneTM.GetLocation().Y, NewBoneTM.GetLocation().Z);
+			MM_LOG(TEXT("NewBoneTM: %f, %f, %f"), NewBoneTM.GetLocation().X, NewBoneTM.GetLocation().Y, NewBoneTM.GetLocation().Z);
 			
 			
 
@@ -726,125 +891,279 @@ void FAnimNode_MotionMatcher::GatherDebugData(FNodeDebugData& DebugData)
 	DECLARE_SCOPE_HIERARCHICAL_COUNTER_ANIMNODE(GatherDebugData);
 
 	FString DebugLine = DebugData.GetNodeName(this);
+	DebugLine += FString::Printf(TEXT("(Memory: %.1f KB)"), GetInstanceMemoryFootprint() / 1024.f);
 	DebugData.AddDebugItem(DebugLine);
 
-	UE_LOG(LogTemp, Warning, TEXT("DEBUG"));
-
 	//BasePose.GatherDebugData(DebugData);
 }
 
 const int32& FAnimNode_MotionMatcher::GetStateIndex()
 {
-	return currentPlayData.MatchedStateIndex;
+	return hot.currentPlayData.MatchedStateIndex;
 }
 
-void FAnimNode_MotionMatcher::MatchNow()
+SIZE_T FAnimNode_MotionMatcher::GetInstanceMemoryFootprint() const
 {
-	SCOPE_CYCLE_COUNTER(STAT_MMIndexSearch);
-	timeSinceLastMatch = 0.f;
+	SIZE_T bytes = sizeof(*this);
+
+	if (cold.IsValid())
+		bytes += sizeof(FMMatcherColdState);
 
-	float bestCost = MAX_FLT;
-	int32 bestStateIndex = 0;
-	int32 bestPoseIndex = 0;
-	float bestPoseTime = 0.f;
+	bytes += sampleRow.GetAllocatedSize();
+	bytes += searchQuery.GetAllocatedSize();
+	bytes += desiredTrajectory.GetAllocatedSize();
+	bytes += pastHistory.GetAllocatedSize();
+	bytes += inertializationNodes.GetAllocatedSize();
+	bytes += inertialization.GetAllocatedSize();
+	bytes += blendStack.GetAllocatedSize();
+	bytes += footLockReceivers.GetAllocatedSize();
+	bytes += footLockFeet.GetAllocatedSize();
 
-	bool bFindLoop = false;
+	bytes += currentPose.BoneData.GetAllocatedSize();
+	bytes += currentPose.Trajectory.GetAllocatedSize();
 
-	FMMatcherState& currentState = MotionDataAsset->States[currentPlayData.MatchedStateIndex];
-	if (currentState.Animation)
+	return bytes;
+}
+
+bool FAnimNode_MotionMatcher::ShouldSearch()
+{
+	// How far the playing animation's future is from the desired one. Both are normalized by now.
+	float divergence = 0.f;
+
+	if (TrajectoryChangeThreshold > 0.f)
 	{
-		float timeLeft = currentState.Animation->GetPlayLength() - currentPlayData.CurrentPlayTime;
+		const int32 first = database->FirstFutureTrajectoryTiming;
+		const int32 numPoints = FMath::Min(currentPose.Trajectory.Num(), desiredTrajectory.Num());
+
+		for (int32 i = first; i < numPoints; ++i)
+		{
+			divergence += FVector::DistSquared(currentPose.Trajectory[i].Position, desiredTrajectory[i].Position);
+			divergence += FMath::Square(currentPose.Trajectory[i].Facing - desiredTrajectory[i].Facing);
+		}
 
-		// If the anim clip is ending and it is not a loop (transition), don't even consider it for the next match. Only search for loops in this case.
-		if (timeLeft < MOTION_MATCHING_BLEND_TIME && !currentState.bLoop)
-			bFindLoop = true;
+		if (numPoints > first)
+			divergence /= numPoints - first;
 	}
 
+	// A transition running out needs a loop to go to (see MatchNow()) no matter how well it's doing.
+	const bool bEnding = database->IsEnding(hot.currentPlayData.MatchedStateIndex, hot.currentPlayData.SimulatedPlayTime);
+
+	return hot.searchSchedule.ShouldSearch(hot.timeSinceLastMatch, hot.budgetDecision.IntervalScale, TrajectoryChangeThreshold, MaxSearchInterval, divergence, bEnding);
+}
+
+void FAnimNode_MotionMatcher::MatchNow()
+{
+	MM_SCOPE_CYCLE_COUNTER(STAT_MMMatch);
+	hot.timeSinceLastMatch = 0.f;
+
+	FMMatcherState& currentState = MotionDataAsset->States[hot.currentPlayData.MatchedStateIndex];
+
 	//
 	// Pose search
 	//
 
-	for (int32 stateIndex = 0; stateIndex < MotionDataAsset->States.Num(); stateIndex++)
+	// The current pose and desired trajectory are already normalized, so they only need to be laid out like a row.
+	const FMMatcherFeatureLayout& L = database->Layout;
+	float* query = searchQuery.GetData();
+
+	auto writeVec = [](float* dst, const FVector& v) { dst[0] = v.X; dst[1] = v.Y; dst[2] = v.Z; };
+
+	writeVec(query + L.RootVelocity, currentPose.RootVelocity);
+
+	for (int32 i = 0; i != L.NumBones; ++i)
 	{
-		FMMatcherState& state = MotionDataAsset->States[stateIndex];
+		writeVec(query + L.Bones + i * 6, currentPose.BoneData[i].Position);
+		writeVec(query + L.Bones + i * 6 + 3, currentPose.BoneData[i].Velocity);
+	}
 
-		if (bFindLoop && !state.bLoop)
-			continue; // early exit
+	for (int32 i = 0; i != L.NumTrajectoryPoints; ++i)
+	{
+		writeVec(query + L.TrajectoryPosition + i * 3, desiredTrajectory[i].Position);
+		query[L.TrajectoryFacing + i] = desiredTrajectory[i].Facing;
+	}
 
-		for (int32 poseIndex = 0; poseIndex < state.CachedPoses.Num(); poseIndex++)
-		{
-			const FMMatcherPoseSample& candidatePose = state.CachedPoses[poseIndex];
+	const FMotionSearchParams searchParams = database->MakeSearchParams(hot.currentPlayData.MatchedStateIndex, hot.currentPlayData.SimulatedPlayTime,
+		hot.steadyBias, hot.budgetDecision.bLoopsOnly, hot.budgetDecision.SearchTolerance);
 
-			float cost = PoseDistSquared(currentPose, candidatePose);
+	MMCore::SearchStats searchStats;
+	const uint64 searchStart = FPlatformTime::Cycles64();
 
-			if (cost < bestCost)
+	const FMotionSearchResult best = database->Search(query, searchParams, &searchStats);
+
+	const float searchMicroseconds = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - searchStart) * 1000.0;
+
+	if (FMotionCaptureWriter::IsCapturing())
+		FMotionCaptureWriter::Record(*database, query, searchParams, best, searchMicroseconds);
+
+	if (budget)
+		budget->ReportSearch(searchMicroseconds);
+
+	// Telemetry. Averages are exponential over roughly the last 16 searches.
+	FMotionMatcherTelemetry& telemetry = cold->telemetry;
+	const float averageAlpha = (telemetry.TotalSearches == 0) ? 1.f : 1.f / 16.f;
+
+	hot.bSearched = true;
+	telemetry.TotalSearches++;
+	telemetry.LastSearchMicroseconds = searchMicroseconds;
+	telemetry.CandidatesVisited = (int32)searchStats.PosesScanned;
+	telemetry.CandidatesPruned = (int32)searchStats.PosesPruned;
+	telemetry.BestCost = best.IsValid() ? best.Cost : 0.f;
+	telemetry.SecondBestCost = (best.SecondCost < MAX_FLT) ? best.SecondCost : telemetry.BestCost;
+	telemetry.AverageSearchMicroseconds = FMath::Lerp(telemetry.AverageSearchMicroseconds, searchMicroseconds, averageAlpha);
+	telemetry.AverageCandidatesVisited = FMath::Lerp(telemetry.AverageCandidatesVisited, (float)searchStats.PosesScanned, averageAlpha);
+	telemetry.AverageBestCost = FMath::Lerp(telemetry.AverageBestCost, telemetry.BestCost, averageAlpha);
+
+	if (database->ShouldTransition(best, hot.currentPlayData.MatchedStateIndex, hot.currentPlayData.SimulatedPlayTime, hot.currentPlayData.MatchedPoseIndex, hot.timeSinceLastBlend))
+	{
+		const int32 bestStateIndex = best.StateIndex;
+		const int32 bestPoseIndex = best.PoseIndex;
+
+		// The blend stack and built in blending always have room. Otherwise we need a free blend of an inertialization node above us.
+		const bool bBlendInNode = UsesBlendStack() || bBuiltInInertialization;
+		FInertBlendStates* blendNode = nullptr;
+
+		if (!bBlendInNode)
+		{
+			for (auto& node : inertializationNodes)
 			{
-				bestCost = cost;
-				bestStateIndex = stateIndex;
-				bestPoseIndex = poseIndex;
-				bestPoseTime = state.CachedPoses[poseIndex].Time;
+				if (node.ActiveBlends.Num() < 2)
+				{
+					blendNode = &node;
+					break;
+				}
 			}
 		}
+
+		if (bBlendInNode || blendNode)
+		{
+			if (UsesBlendStack())
+			{
+				// What's playing becomes the top of the older layers. Drop the oldest if that's one too many.
+				if (blendStack.Num() >= FMath::Min(BlendStackLayers, MaxBlendStackLayers) - 1)
+					blendStack.RemoveAt(0, 1, false);
+
+				FMMatcherBlendLayer& layer = blendStack.AddDefaulted_GetRef();
+				layer.StateIndex = hot.currentPlayData.MatchedStateIndex;
+				layer.Time = hot.currentPlayData.SimulatedPlayTime;
+				layer.Age = hot.timeSinceLastBlend;
+				layer.BlendTime = hot.currentPlayData.BlendTime;
+			}
+
+			// custom blend time
+			if (currentState.CustomBlendTimes.Contains(bestStateIndex))
+				hot.currentPlayData.BlendTime = currentState.CustomBlendTimes[bestStateIndex];
+			else
+				hot.currentPlayData.BlendTime = MotionDataAsset->BlendTime;
+
+			if (blendNode)
+				blendNode->ActiveBlends.Push(hot.currentPlayData.BlendTime);
+			else if (!UsesBlendStack())
+				inertialization.Request(currentState.Animation, hot.currentPlayData.CurrentPlayTime, hot.currentPlayData.BlendTime);
+
+			//UE_LOG(LogTemp, Warning, TEXT("SWITCH! Old Anim: %d, New Anim: %d. Time since last switch: %f, requested blend time: %f"), hot.currentPlayData.MatchedPoseIndex, bestPoseIndex, hot.timeSinceLastBlend, hot.currentPlayData.BlendTime);
+			hot.timeSinceLastBlend = 0.0f;
+
+
+			// Switch animation
+			hot.currentPlayData.MatchedStateIndex = bestStateIndex;
+			hot.currentPlayData.MatchedPoseIndex = bestPoseIndex;
+			hot.currentPlayData.SimulatedPlayTime = MotionDataAsset->States[hot.currentPlayData.MatchedStateIndex].CachedPoses[hot.currentPlayData.MatchedPoseIndex].Time;
+			hot.lastBestCost = best.Cost;
+
+			if (blendNode)
+				blendNode->Node->RequestInertialization(hot.currentPlayData.BlendTime);
+
+			hot.bAnimChanged = true;
+			cold->telemetry.TotalTransitions++;
+
+			INC_DWORD_STAT(STAT_MMTransitions);
+			INC_FLOAT_STAT_BY(STAT_MMTransitionsPerSecond, 1.f / FMath::Max((float)FApp::GetDeltaTime(), KINDA_SMALL_NUMBER));
+		}
 	}
+}
+
+void FAnimNode_MotionMatcher::EvaluateBlendStack(FPoseContext& Output)
+{
+	// Layers are dropped oldest first: one per LOD level, and whatever is over the global cap.
+	int32 maxLayers = FMath::Min(BlendStackLayers, MaxBlendStackLayers) - Output.AnimInstanceProxy->GetLODLevel();
 
-	// If the current and matched animation are the same and it is a looping anim, then don't jump anywhere.
-	bool bLooping = bestStateIndex == currentPlayData.MatchedStateIndex &&
-		MotionDataAsset->States[currentPlayData.MatchedStateIndex].bLoop;
+	if (CVarBlendStackMaxLayers.GetValueOnAnyThread() > 0)
+		maxLayers = FMath::Min(maxLayers, CVarBlendStackMaxLayers.GetValueOnAnyThread());
 
-	bool bWinnerAtSameLocation = bestStateIndex == currentPlayData.MatchedStateIndex &&
-		FMath::Abs(currentPlayData.CurrentPlayTime - bestPoseTime) < 1.0f || currentPlayData.MatchedPoseIndex == bestPoseIndex;
-	//FMath::Abs(lastBestCost - bestCost) < 10.f;
-//bool bWinnerAtSameLocation = bestStateIndex == currentPlayData.MatchedStateIndex;
+	maxLayers = FMath::Max(maxLayers, 1);
 
-	int32 totalBlends = 0;
+	// The older layers we can afford, then the current clip on top.
+	const int32 firstLayer = FMath::Max(blendStack.Num() - (maxLayers - 1), 0);
+	const int32 numLayers = blendStack.Num() - firstLayer + 1;
 
-	for (auto& node : inertializationNodes)
+	// Layers only move on steps. Like the current clip, they're shown ahead by the time not simulated yet.
+	const float leftoverTime = hot.fixedStep.Accumulator;
+
+	TArray<float, TInlineAllocator<MaxBlendStackLayers>> weights;
+	weights.SetNumUninitialized(numLayers);
+
+	// Each layer fades in over the ones below it. The bottom one is whatever's left.
+	for (int32 i = 0; i != numLayers; ++i)
 	{
-		totalBlends += node.ActiveBlends.Num();
+		const bool bCurrent = i == numLayers - 1;
+		const float age = (bCurrent ? hot.timeSinceLastBlend : blendStack[firstLayer + i].Age) + leftoverTime;
+		const float blendTime = bCurrent ? hot.currentPlayData.BlendTime : blendStack[firstLayer + i].BlendTime;
+		const float alpha = (i == 0 || blendTime <= 0.f) ? 1.f : FMath::Clamp(age / blendTime, 0.f, 1.f);
+
+		for (int32 j = 0; j != i; ++j)
+			weights[j] *= 1.f - alpha;
+
+		weights[i] = alpha;
 	}
 
+	TArray<FCompactPose, TInlineAllocator<MaxBlendStackLayers>> poses;
+	TArray<FBlendedCurve, TInlineAllocator<MaxBlendStackLayers>> curves;
+	TArray<FStackCustomAttributes, TInlineAllocator<MaxBlendStackLayers>> attributes;
+	TArray<float, TInlineAllocator<MaxBlendStackLayers>> poseWeights;
 
-	if (!bWinnerAtSameLocation && !bLooping && timeSinceLastBlend > 0.1f)
+	for (int32 i = 0; i != numLayers; ++i)
 	{
-		for (auto& node : inertializationNodes)
-		{
-			if (node.ActiveBlends.Num() < 2)
-			{
-				// custom blend time
-				if (currentState.CustomBlendTimes.Contains(bestStateIndex))
-					currentPlayData.BlendTime = currentState.CustomBlendTimes[bestStateIndex];
-				else
-					currentPlayData.BlendTime = MotionDataAsset->BlendTime;
-
-				node.ActiveBlends.Push(currentPlayData.BlendTime);
+		// Not worth decompressing.
+		if (weights[i] < ZERO_ANIMWEIGHT_THRESH) continue;
 
-				//UE_LOG(LogTemp, Warning, TEXT("SWITCH! Old Anim: %d, New Anim: %d. Time since last switch: %f, pending blends: %d, requested blend time: %f"), currentPlayData.MatchedPoseIndex, bestPoseIndex, timeSinceLastBlend, totalBlends, currentPlayData.BlendTime);
-				timeSinceLastBlend = 0.0f;
+		const bool bCurrent = i == numLayers - 1;
+		const int32 stateIndex = bCurrent ? hot.currentPlayData.MatchedStateIndex : blendStack[firstLayer + i].StateIndex;
+		const float time = bCurrent ? hot.currentPlayData.CurrentPlayTime : database->AdvanceTime(stateIndex, blendStack[firstLayer + i].Time, leftoverTime);
 
+		FCompactPose& pose = poses.AddDefaulted_GetRef();
+		FBlendedCurve& curve = curves.AddDefaulted_GetRef();
+		FStackCustomAttributes& attribute = attributes.AddDefaulted_GetRef();
+		poseWeights.Add(weights[i]);
 
-				// Switch animation
-				currentPlayData.MatchedStateIndex = bestStateIndex;
-				currentPlayData.MatchedPoseIndex = bestPoseIndex;
-				currentPlayData.CurrentPlayTime = MotionDataAsset->States[currentPlayData.MatchedStateIndex].CachedPoses[currentPlayData.MatchedPoseIndex].Time;
-				lastBestCost = bestCost;
+		pose.SetBoneContainer(&Output.Pose.GetBoneContainer());
+		curve.InitFrom(Output.Curve);
 
-				node.Node->RequestInertialization(currentPlayData.BlendTime);
+		// Every layer extracts root motion so its root bone is reset: blending animated roots would move the mesh.
+		FAnimationPoseData layerData(pose, curve, attribute);
+		const UAnimSequence* animation = MotionDataAsset->States[stateIndex].Animation;
 
-				bAnimChanged = true;
-				break;
-			}
-		}
+		if (bUseSharedPoseCache)
+			FMotionMatchingPoseCache::Get().GetAnimationPose(animation, time, true, layerData);
+		else
+			animation->GetAnimationPose(layerData, FAnimExtractContext(time, true));
 	}
+
+	FAnimationPoseData outputData(Output);
+	FAnimationRuntime::BlendPosesTogether(poses, curves, attributes, poseWeights, outputData);
 }
 
 void FAnimNode_MotionMatcher::EvaluatePoseSample(int32 stateIndex, float time, FMMatcherPoseSample& outPoseSample)
 {
-	const TArray<FMMatcherPoseSample>& poseLibrary = MotionDataAsset->States[stateIndex].CachedPoses;
+	MM_SCOPE_CYCLE_COUNTER(STAT_MMEvaluatePoseSample);
+
+	const FMMatcherState& state = MotionDataAsset->States[stateIndex];
+	const TArray<FMMatcherPoseSample>& poseLibrary = state.CachedPoses;
+	const FMMatcherFeatureLayout& L = database->Layout;
 
 	if (poseLibrary.Num() == 0) return;
 
 	// This gives us the pose sample index with floating point accuracy. Round to find nearest sample.
-	float poseIndexValue = (time / MotionDataAsset->MotionCacheSamplingRate);
+	float poseIndexValue = (time / database->SamplingRate);
 
 	// These rounded indices should be valid as long as they're in range of the array.
 	int32 earliestPoseIndex = FMath::FloorToInt(poseIndexValue);
@@ -853,39 +1172,59 @@ void FAnimNode_MotionMatcher::EvaluatePoseSample(int32 stateIndex, float time, F
 
 	if (!poseLibrary.IsValidIndex(earliestPoseIndex) || !poseLibrary.IsValidIndex(latestPoseIndex))
 	{
-		// early exit if no poses to blend from/to (out-of-range).
-		outPoseSample = poseLibrary[poseLibrary.Num() - 1];
-		return;
+		// No poses to blend from/to (out-of-range), hold the last one.
+		earliestPoseIndex = latestPoseIndex = poseLibrary.Num() - 1;
+		tweenAlpha = 0.f;
+		time = poseLibrary[earliestPoseIndex].Time;
+	}
+	else if (bSnapToNearestSample)
+	{
+		earliestPoseIndex = latestPoseIndex = FMath::RoundToInt(poseIndexValue);
+		tweenAlpha = 0.f;
 	}
 
-	const FMMatcherPoseSample& currentSample = poseLibrary[earliestPoseIndex];
-	const FMMatcherPoseSample& nextSample = poseLibrary[latestPoseIndex];
-	const FMMatcherPoseSample& closestSample = poseLibrary[FMath::RoundToInt(poseIndexValue)];
+	const int32 closestPoseIndex = (tweenAlpha < 0.5f) ? earliestPoseIndex : latestPoseIndex;
+	const FMMatcherPoseSample& closestSample = poseLibrary[closestPoseIndex];
+	hot.poseFootContacts = database->GetFootContacts(stateIndex, closestPoseIndex);
 
 	//
-	// Interpolation
+	// Interpolation. Every feature lives in one contiguous row so this is a straight lerp over floats.
 	//
 
-	outPoseSample.Id = poseLibrary[FMath::RoundToInt(poseIndexValue)].Id; // Assume the closest Id.
+	const float* currentRow = database->GetRow(stateIndex, earliestPoseIndex);
+	const float* nextRow = database->GetRow(stateIndex, latestPoseIndex);
+	float* row = sampleRow.GetData();
+
+	if (tweenAlpha == 0.f)
+	{
+		FMemory::Memcpy(row, currentRow, L.Stride * sizeof(float));
+	}
+	else
+	{
+		for (int32 i = 0; i != L.Stride; ++i)
+			row[i] = currentRow[i] + (nextRow[i] - currentRow[i]) * tweenAlpha;
+	}
+
+	auto readVec = [row](int32 offset) { return FVector(row[offset], row[offset + 1], row[offset + 2]); };
+
+	outPoseSample.Id = closestSample.Id; // Assume the closest Id.
 	outPoseSample.StateId = closestSample.StateId;
 	outPoseSample.Time = time;
 	outPoseSample.bLFootLock = closestSample.bLFootLock;
 	outPoseSample.bRFootLock = closestSample.bRFootLock;
-	outPoseSample.FootLocks = closestSample.FootLocks;
-	outPoseSample.RootVelocity = FMath::Lerp(currentSample.RootVelocity, nextSample.RootVelocity, tweenAlpha);
-	outPoseSample.FacingAxis = FMath::Lerp(currentSample.FacingAxis, nextSample.FacingAxis, tweenAlpha);
+	outPoseSample.RootVelocity = readVec(L.RootVelocity);
+	outPoseSample.FacingAxis = readVec(L.FacingAxis);
 
 	// While we could do fancy quaternion interpolation to prevent rotational glitches, here we save computation time by assuming that
 	// the rotational speed will never be too fast and go into negative. E.g., flipping from 179* to -179*
-	outPoseSample.RootRotationSpeed = FMath::Lerp(currentSample.RootRotationSpeed, nextSample.RootRotationSpeed, tweenAlpha);
+	outPoseSample.RootRotationSpeed = row[L.RootRotationSpeed];
 
 	// Pose Matching Bones.
-	outPoseSample.BoneData.Empty();
-	outPoseSample.BoneData.AddDefaulted(currentSample.BoneData.Num());
+	outPoseSample.BoneData.SetNum(L.NumBones, false);
 
 	if (poseWatcher) // Use live bone data instead of offline data.
 	{
-		TArray<FMMatcherBoneData> boneData = poseWatcher->GetBoneData();
+		TArray<FMMatcherBoneData>& boneData = poseWatcher->GetBoneData();
 
 		for (int32 i = 0; i != outPoseSample.BoneData.Num(); ++i)
 		{
@@ -899,37 +1238,35 @@ void FAnimNode_MotionMatcher::EvaluatePoseSample(int32 stateIndex, float time, F
 			}
 		}
 	}
-	else // Use offline data (skips with no blending).
+	else // Use offline data.
 	{
-		for (int32 i = 0; i != currentSample.BoneData.Num(); ++i)
+		for (int32 i = 0; i != L.NumBones; ++i)
 		{
 			FMMatcherBoneData& outBone = outPoseSample.BoneData[i];
-			const FMMatcherBoneData& currentBone = currentSample.BoneData[i];
-			const FMMatcherBoneData& nextBone = nextSample.BoneData[i];
 
-			outBone.Position = FMath::Lerp(currentBone.Position, nextBone.Position, tweenAlpha);
-			outBone.Velocity = FMath::Lerp(currentBone.Velocity, nextBone.Velocity, tweenAlpha);
+			outBone.Position = readVec(L.Bones + i * 6);
+			outBone.Velocity = readVec(L.Bones + i * 6 + 3);
 		}
 	}
 
 	// Trajectory
-	outPoseSample.Trajectory.Empty();
-	outPoseSample.Trajectory.AddDefaulted(currentSample.Trajectory.Num());
+	outPoseSample.Trajectory.SetNum(L.NumTrajectoryPoints, false);
 
-	for (int32 i = 0; i != currentSample.Trajectory.Num(); ++i)
+	for (int32 i = 0; i != L.NumTrajectoryPoints; ++i)
 	{
 		FTrajectoryPoint& outPoint = outPoseSample.Trajectory[i];
-		const FTrajectoryPoint& currentPoint = currentSample.Trajectory[i];
-		const FTrajectoryPoint& nextPoint = nextSample.Trajectory[i];
-
-		outPoint.Position = FMath::Lerp(currentPoint.Position, nextPoint.Position, tweenAlpha);
 
-		FQuat currentQuat = FQuat(FVector::UpVector, FMath::DegreesToRadians(currentPoint.Facing));
-		FQuat nextQuat = FQuat(FVector::UpVector, FMath::DegreesToRadians(nextPoint.Facing));
+		outPoint.Position = readVec(L.TrajectoryPosition + i * 3);
+		outPoint.Facing = row[L.TrajectoryFacing + i];
 
-		FQuat lerpedQuat = FQuat::FastLerp(currentQuat, nextQuat, tweenAlpha);
+		// Lerped degrees would break when wrapping around +-180 so rebuild the facing from the lerped sin/cos pair instead.
+		if (tweenAlpha != 0.f)
+		{
+			const float* sinCos = row + L.TrajectoryFacingSinCos + i * 2;
 
-		outPoint.Facing = lerpedQuat.Rotator().Yaw;
+			outPoint.Facing = FMath::RadiansToDegrees(FMath::Atan2(sinCos[0], sinCos[1]));
+			MotionDataAsset->NormalizeFeature(outPoint.Facing, MotionDataAsset->NormalData_TrajectoryFacing[i]);
+		}
 	}
 }
 
@@ -937,7 +1274,7 @@ float FAnimNode_MotionMatcher::TrajDistSquared(const FTrajectory& goal, const FT
 {
 	float dist = 0.f;
 
-	for (int32 i = 0; i != MotionDataAsset->TrajectoryTimings.Num(); ++i)
+	for (int32 i = 0; i != database->TrajectoryTimings.Num(); ++i)
 	{
 		dist += ATTR_DIST_VEC(goal[i].Position, candidate[i].Position);
 		dist += ATTR_DIST(goal[i].Facing, candidate[i].Facing);
@@ -946,46 +1283,6 @@ float FAnimNode_MotionMatcher::TrajDistSquared(const FTrajectory& goal, const FT
 	return dist;
 }
 
-float FAnimNode_MotionMatcher::PoseDistSquared(const FMMatcherPoseSample& goal, const FMMatcherPoseSample& candidate)
-{
-	const FMMatcherState& state = MotionDataAsset->States[candidate.StateId];
-
-	float dist = 0.f;
-
-	// Add all features as dimensions
-	dist += ATTR_DIST_VEC(goal.RootVelocity, candidate.RootVelocity);
-
-	for (int32 i = 0; i != goal.BoneData.Num(); ++i)
-	{
-		dist += ATTR_DIST_VEC(goal.BoneData[i].Position, candidate.BoneData[i].Position);
-		dist += ATTR_DIST_VEC(goal.BoneData[i].Velocity, candidate.BoneData[i].Velocity);
-	}
-
-	for (int32 i = 0; i != MotionDataAsset->TrajectoryTimings.Num(); ++i)
-	{
-		dist += ATTR_DIST_VEC(desiredTrajectory[i].Position, candidate.Trajectory[i].Position);
-		dist += ATTR_DIST(desiredTrajectory[i].Facing, candidate.Trajectory[i].Facing);
-	}
-
-	// biases
-
-	if (goal.StateId == candidate.StateId)
-		dist *= (1.0f - ((goal.Id == candidate.Id) ? MotionDataAsset->NaturalBias : MotionDataAsset->NaturalBias * 0.5f));
-		
-	if (state.bLoop)
-		dist *= (1.0f - (MotionDataAsset->LoopBias * steadyBias));
-
-	/*if (currentPose.StateId == candidatePose.StateId)
-		dist -= (currentPose.Id == candidatePose.Id) ? MotionDataAsset->NaturalBias * 2.0f : MotionDataAsset->NaturalBias;
-
-	if (state.bLoop)
-		dist -= MotionDataAsset->LoopBias * steadyBias; // loop bias is multiplied by how steady our input is.*/
-
-	//dist += state.bStopping ? 0.0f : MotionDataAsset->StoppingBias;
-
-	return dist;
-}
-
 bool FAnimNode_MotionMatcher::IsPointInBalancingArea(FVector2D point)
 {
 	// The balancing area is an obround/capsule shape with the left/right foot vectors as endpoints.
@@ -995,8 +1292,8 @@ bool FAnimNode_MotionMatcher::IsPointInBalancingArea(FVector2D point)
 	// The radiuses of the left/right endpoints as well as the half-height of the rect.
 	const float radius = 12.f;
 
-	FVector& lFootPos = lockedfootPositions[0];
-	FVector& rFootPos = lockedfootPositions[1];
+	FVector& lFootPos = cold->lockedfootPositions[0];
+	FVector& rFootPos = cold->lockedfootPositions[1];
 
 	FVector2D leftFoot = FVector2D(lFootPos.X, lFootPos.Y);
 	FVector2D rightFoot = FVector2D(rFootPos.X, rFootPos.Y);
@@ -1065,42 +1362,63 @@ bool FAnimNode_MotionMatcher::IsPointInBalancingArea(FVector2D point)
 	return false;
 }
 
+void FAnimNode_MotionMatcher::ProbeGround()
+{
+	if (!groundProbe) return;
+
+	// Results trail the requests by a frame, so only take those probed at the current lock.
+	for (int32 foot = 0; foot != 2; ++foot)
+	{
+		if (!hot.footLocks[foot]) continue;
+
+		const FVector& lockedPos = cold->lockedfootPositions[foot];
+		FMotionMatchingGroundHit hit;
+
+		if (groundProbe->GetResult(this, foot, hit) && hit.bHit && hit.ProbeLocation.Equals(lockedPos))
+			footLock.SetTarget(foot, true, FVector(lockedPos.X, lockedPos.Y, hit.Location.Z + cold->lockedFootHeights[foot]), hit.Normal);
+
+		groundProbe->Request(this, foot, lockedPos, owningActor, GroundProbeChannel);
+	}
+}
+
 void FAnimNode_MotionMatcher::UpdateFootLock(float dt, UAnimInstance* animInst)
 {
-	timeSinceLock += dt;
+	MM_SCOPE_CYCLE_COUNTER(STAT_MMFootLock);
 
+	if (!HasFeature(EMMatcherFeatures::FootLock | EMMatcherFeatures::IKCurves))
+		return;
 
-	bool bLeftLocked = (bool)currentPose.FootLocks[0]; // Lock in the animation
-	bool bRightLocked = (bool)currentPose.FootLocks[1]; // Lock in the animation
+	bool bLeftLocked = (hot.poseFootContacts & 1) != 0; // Lock in the animation
+	bool bRightLocked = (hot.poseFootContacts & 2) != 0; // Lock in the animation
 
 	if (bLeftLocked)
-		ik_left_alpha = 1.0f;
+		hot.ik_left_alpha = 1.0f;
 	else
-		ik_left_alpha = 0.f;
+		hot.ik_left_alpha = 0.f;
 
 	if (bRightLocked)
-		ik_right_alpha = 1.0f;
+		hot.ik_right_alpha = 1.0f;
 	else
-		ik_right_alpha = 0.f;
+		hot.ik_right_alpha = 0.f;
 
-	if (!MotionMatcherInterface) return;
+	if ((!MotionMatcherInterface && !footLockComponent) || !HasFeature(EMMatcherFeatures::FootLock)) return;
 
 
-	float actorYaw = owningActor->GetActorRotation().Yaw + (localMeshCompRot.Z);
-	float speed = currentRootVelocity.SizeSquared2D() + FMath::Abs(turnSpeed);
+	float actorYaw = owningActor->GetActorRotation().Yaw + (localMeshCompYaw);
+	float speed = hot.currentRootVelocity.SizeSquared2D() + FMath::Abs(hot.turnSpeed);
 
 	if (speed < 0.1f)
 	{
-		timeStandingStill += dt;
+		cold->timeStandingStill += dt;
 	}
 	else
 	{
-		timeStandingStill = 0.f;
+		cold->timeStandingStill = 0.f;
 	}
 	
 	////////////////////////////////////////////////////////////////////////////////////////////////
 
-	if (MotionMatcherInterface && currentPose.Id != 0)
+	if (currentPose.Id != 0)
 	{
 		TArray<FMMatcherBoneData> animBoneData = currentPose.BoneData;
 		MotionDataAsset->UnnormalizeBoneData(animBoneData);
@@ -1110,40 +1428,42 @@ void FAnimNode_MotionMatcher::UpdateFootLock(float dt, UAnimInstance* animInst)
 
 		for (int32 foot = 0; foot != 2; ++foot)
 		{
-			FBoneReference& footBone = footLockFeet[foot];
-			bool bPoseLocked = (bool)currentPose.FootLocks[foot]; // Lock in the animation
-			bool& bLocked = footLocks[foot]; // is it currently locked?
+			bool bPoseLocked = (hot.poseFootContacts & (1 << foot)) != 0; // Lock in the animation
+			bool& bLocked = hot.footLocks[foot]; // is it currently locked?
 			bool bLockNow = bPoseLocked && !bLocked;
 			bool bUnlockNow = !bPoseLocked && bLocked;
 
 			if (bLockNow || bUnlockNow)
 			{
-				// Find the bone
+				const int32 boneIndex = database->FootBoneIndices[foot];
+				MM_LOG(TEXT("Pose: %d"), currentPose.Id);
 
-				for (int32 boneIndex = 0; boneIndex != PoseMatchingBones.Num(); ++boneIndex)
-				{
-					if (PoseMatchingBones[boneIndex].BoneName == footBone.BoneName)
-					{
-						UE_LOG(LogTemp, Warning, TEXT("Pose: %d"), currentPose.Id);
+				const FMMatcherBoneData& boneData = animBoneData[boneIndex];
+				FVector bonePos = hot.lastPosition + hot.localMeshCompPos + boneData.Position.RotateAngleAxis(actorYaw, FVector::UpVector);
+				MM_LOG(TEXT("New lock: %f, %f, %f"), bonePos.X, bonePos.Y, bonePos.Z);
 
+				bLocked = bPoseLocked;
+				cold->lockedfootPositions[foot] = bonePos;
+				cold->lockedFootHeights[foot] = boneData.Position.Z;
 
-						const FMMatcherBoneData& boneData = animBoneData[boneIndex];
-						FVector bonePos = lastPosition + localMeshCompPos + boneData.Position.RotateAngleAxis(actorYaw, FVector::UpVector);
-						FVector boneVel = lastPosition + localMeshCompPos + (boneData.Position + (boneData.Velocity / 4)).RotateAngleAxis(actorYaw, FVector::UpVector);
-						UE_LOG(LogTemp, Warning, TEXT("New lock: %f, %f, %f"), bonePos.X, bonePos.Y, bonePos.Z);
-
-						bLocked = bPoseLocked;
-						lockedfootPositions[foot] = bonePos;
-
-						MotionMatcherInterface->UpdateFootLock(foot, bLocked, lockedfootPositions[foot]);
-
-						break;
-					}
-				}
+				footLock.SetTarget(foot, bLocked, cold->lockedfootPositions[foot]);
 			}
 		}		
 	}
 
+	// Smooth here rather than on the game thread, which then only picks up the result.
+	// The mesh transform is derived from the actor's like everywhere else in here; no component queries.
+	const FTransform actorT = owningActor->GetTransform();
+	const FTransform componentT = FTransform(FRotator(0.f, localMeshCompYaw, 0.f), hot.localMeshCompPos) * actorT;
+
+	footLock.Update(dt, componentT, actorT);
+
+	if (MotionMatcherInterface)
+		MotionMatcherInterface->PublishFootLock(footLock.GetCurrent());
+
+	if (footLockComponent)
+		footLockComponent->PublishFootLock(footLock.GetCurrent());
+
 	////////////////////////////////////////////////////////////////////////////////////////////////
 
 	return;
@@ -1157,61 +1477,61 @@ void FAnimNode_MotionMatcher::UpdateFootLock(float dt, UAnimInstance* animInst)
 		foot = !foot;
 		FName footBoneName = (foot == MM_FOOT::LEFT) ? MotionDataAsset->LeftFoot.BoneName : MotionDataAsset->RightFoot.BoneName;
 
-		bool bOutOfBalance = !IsPointInBalancingArea(centerOfMass);
+		bool bOutOfBalance = !IsPointInBalancingArea(cold->centerOfMass);
 
-		for (int32 i = 0; i != PoseMatchingBones.Num(); ++i)
+		for (int32 i = 0; i != MotionDataAsset->PoseMatchingBones.Num(); ++i)
 		{
-			FBoneReference& boneRef = PoseMatchingBones[i];
+			FBoneReference& boneRef = MotionDataAsset->PoseMatchingBones[i];
 			FMMatcherBoneData& boneData = animBoneData[i];
 
 			if (boneRef.BoneName == footBoneName)
 			{
-				bool bPoseLocked = (bool)currentPose.FootLocks[foot]; // Lock in the animation
-				bool& bLocked = footLocks[foot]; // is it currently locked?
+				bool bPoseLocked = (hot.poseFootContacts & (1 << foot)) != 0; // Lock in the animation
+				bool& bLocked = hot.footLocks[foot]; // is it currently locked?
 				bool bSupposedToBeLocked = bPoseLocked && !bLocked;
 				bool bNotSupposedToBeLocked = !bPoseLocked && bLocked;
-				bool& bOtherFootLocked = footLocks[(foot == 0) ? 1 : 0];
+				bool& bOtherFootLocked = hot.footLocks[(foot == 0) ? 1 : 0];
 				bool otherFoot = !foot;
 
-				FVector leftFootPos = boneData.Position.RotateAngleAxis(actorYaw, FVector::UpVector) + lastPosition + localMeshCompPos;
+				FVector leftFootPos = boneData.Position.RotateAngleAxis(actorYaw, FVector::UpVector) + hot.lastPosition + hot.localMeshCompPos;
 				FTransform boneT = animInst->GetSkelMeshComponent()->GetSocketTransform(footBoneName, ERelativeTransformSpace::RTS_World);
 				FVector bonePos = boneT.GetLocation();
 
-				const FVector& currentLockedPos = lockedfootPositions[foot];
-				const FVector& currentLockedPosOther = lockedfootPositions[!foot];
+				const FVector& currentLockedPos = cold->lockedfootPositions[foot];
+				const FVector& currentLockedPosOther = cold->lockedfootPositions[!foot];
 
 				// distance between the foot in the animation vs the current foot. TODO: What about IK-modified foot? Our target should be adjusted here.
 				float dist = FVector::DistSquared(leftFootPos, boneT.GetLocation());
 
 				//bOutOfBalance = bOutOfBalance || (timeStandingStill > 2.f && dist > 10.f);
-				bOutOfBalance = bOutOfBalance || dist > 100.f || (dist > 10.f && timeStandingStill > 1.5f);
+				bOutOfBalance = bOutOfBalance || dist > 100.f || (dist > 10.f && cold->timeStandingStill > 1.5f);
 
 				// distance between the foot and the pelvis (Z axis ignored)
-				float distPelvis = FVector2D::DistSquared(centerOfMass, FVector2D(bonePos.X, bonePos.Y));
+				float distPelvis = FVector2D::DistSquared(cold->centerOfMass, FVector2D(bonePos.X, bonePos.Y));
 
 				// When to lock
-				if (bSupposedToBeLocked && !bAdjustingBalance)
+				if (bSupposedToBeLocked && !cold->bAdjustingBalance)
 				{
 					bLocked = true;
-					lockedfootPositions[foot] = bonePos;
+					cold->lockedfootPositions[foot] = bonePos;
 
-					MotionMatcherInterface->UpdateFootLock(foot, bLocked, lockedfootPositions[foot]);
+					footLock.SetTarget(foot, bLocked, cold->lockedfootPositions[foot]);
 				}
-				else if (bNotSupposedToBeLocked || bPoseLocked && ((bOutOfBalance) && bOtherFootLocked && !bAdjustingBalance || distPelvis > 1000.f)) // || bNotSupposedToBeLocked// (bOutOfBalance) && bOtherFootLocked && !bAdjustingBalance || distPelvis > 1000.f
+				else if (bNotSupposedToBeLocked || bPoseLocked && ((bOutOfBalance) && bOtherFootLocked && !cold->bAdjustingBalance || distPelvis > 1000.f)) // || bNotSupposedToBeLocked// (bOutOfBalance) && bOtherFootLocked && !bAdjustingBalance || distPelvis > 1000.f
 				{
 					bool bContinue = true;
 					//bAdjustingBalance = true;
 
 					if (bOutOfBalance && bPoseLocked)//??poe locked? why
 					{
-						bAdjustingBalance = true;
+						cold->bAdjustingBalance = true;
 
-						float footDistA = FVector2D::DistSquared(centerOfMass, FVector2D(currentLockedPos.X, currentLockedPos.Y));
-						float footDistB = FVector2D::DistSquared(centerOfMass, FVector2D(currentLockedPosOther.X, currentLockedPosOther.Y));
+						float footDistA = FVector2D::DistSquared(cold->centerOfMass, FVector2D(currentLockedPos.X, currentLockedPos.Y));
+						float footDistB = FVector2D::DistSquared(cold->centerOfMass, FVector2D(currentLockedPosOther.X, currentLockedPosOther.Y));
 
-						if (footDistB <= footDistA && !foot != lastUnlockedFoot || lastUnlockedFoot == (int)foot)
+						if (footDistB <= footDistA && !foot != cold->lastUnlockedFoot || cold->lastUnlockedFoot == (int)foot)
 						{
-							bAdjustingBalance = false;
+							cold->bAdjustingBalance = false;
 							bContinue = false;
 						}
 					}
@@ -1219,20 +1539,20 @@ void FAnimNode_MotionMatcher::UpdateFootLock(float dt, UAnimInstance* animInst)
 
 					if (bContinue)
 					{
-						footLocks[foot] = false;
-						MotionMatcherInterface->UpdateFootLock(foot, footLocks[foot], FVector::ZeroVector);
-						lastUnlockedFoot = foot;
+						hot.footLocks[foot] = false;
+						footLock.SetTarget(foot, hot.footLocks[foot], FVector::ZeroVector);
+						cold->lastUnlockedFoot = foot;
 					}
 				}
 				else if (dist < 5.f && bSupposedToBeLocked)
 				{
 					bLocked = true;
-					lockedfootPositions[foot] = bonePos;
+					cold->lockedfootPositions[foot] = bonePos;
 
-					MotionMatcherInterface->UpdateFootLock(foot, bLocked, lockedfootPositions[foot]);
+					footLock.SetTarget(foot, bLocked, cold->lockedfootPositions[foot]);
 
 					if (bOtherFootLocked)
-						bAdjustingBalance = false;
+						cold->bAdjustingBalance = false;
 				}
 
 				if (foot == MM_FOOT::LEFT)
@@ -1249,6 +1569,8 @@ void FAnimNode_MotionMatcher::UpdateFootLock(float dt, UAnimInstance* animInst)
 #if WITH_EDITOR
 void FAnimNode_MotionMatcher::DrawDebug(const FAnimationUpdateContext& context)
 {
+	UDebugWidget* debugWidget = cold->debugWidget;
+
 	// Note: we're not on the game thread here so we can only modify the widget but not call methods.
 	if (debugWidget && !debugWidget->bShow)
 		debugWidget->bShow = true;
@@ -1273,7 +1595,7 @@ void FAnimNode_MotionMatcher::DrawDebug(const FAnimationUpdateContext& context)
 
 	if (MotionMatcherInterface)
 	{
-		MotionMatcherInterface->DrawDebug();
+		MotionMatcherInterface->DrawDebug(footLock.GetCurrent());
 	}
 	
 	if (debugWidget)
@@ -1289,15 +1611,15 @@ void FAnimNode_MotionMatcher::DrawDebug(const FAnimationUpdateContext& context)
 		//UPDATE_DEBUG("FOO", 256.f)
 
 
-		debugWidget->stateIndex = currentPlayData.MatchedStateIndex;
-		auto& state = MotionDataAsset->States[currentPlayData.MatchedStateIndex];
+		debugWidget->stateIndex = hot.currentPlayData.MatchedStateIndex;
+		auto& state = MotionDataAsset->States[hot.currentPlayData.MatchedStateIndex];
 		UAnimSequence* anim = state.Animation;
 		anim->GetFName().ToString(debugWidget->animName);
 		MotionDataAsset->GetName(debugWidget->stateName);
 
 		debugWidget->animType = (EDebugAnimType)!state.bLoop;
 		debugWidget->animRoot = currentPose.RootVelocity;
-		debugWidget->animTime = currentPlayData.CurrentPlayTime;
+		debugWidget->animTime = hot.currentPlayData.CurrentPlayTime;
 
 		
 		UPDATE_DEBUG_VECTOR(inputDir, Input.DesiredVector);
@@ -1305,10 +1627,10 @@ void FAnimNode_MotionMatcher::DrawDebug(const FAnimationUpdateContext& context)
 
 		UPDATE_DEBUG_FLOAT(desiredFacing, Input.DesiredFacing);
 		UPDATE_DEBUG_FLOAT(naturalBias, MotionDataAsset->NaturalBias);
-		UPDATE_DEBUG_FLOAT(loopBias, 1.0f - (MotionDataAsset->LoopBias * steadyBias));
-		UPDATE_DEBUG_FLOAT(steadyBias, steadyBias);
-		UPDATE_DEBUG_FLOAT(rootRotWarp, rootRotWarp);
-		UPDATE_DEBUG_FLOAT(lastBestCost, lastBestCost);
+		UPDATE_DEBUG_FLOAT(loopBias, 1.0f - (MotionDataAsset->LoopBias * hot.steadyBias));
+		UPDATE_DEBUG_FLOAT(steadyBias, hot.steadyBias);
+		UPDATE_DEBUG_FLOAT(rootRotWarp, hot.rootRotWarp);
+		UPDATE_DEBUG_FLOAT(lastBestCost, hot.lastBestCost);
 
 		//UE_LOG(LogTemp, Warning, TEXT("vel: %f"), debugWidget->debugVectorProps.Find("rootVel")->Value.Size());
 		
@@ -1330,10 +1652,10 @@ void FAnimNode_MotionMatcher::DrawDebug(const FAnimationUpdateContext& context)
 		//context.AnimInstanceProxy->AnimDrawDebugSphere(lastPosition + avgInputDir.RotateAngleAxis(owningActor->GetActorRotation().Yaw + (localMeshCompRot.Z), FVector::UpVector), 100.f, 32, FColor::Blue);
 
 		// Draw root rotation warp
-		FVector posOffset = lastPosition - FVector(0.f, 0.f, -1 * localMeshCompPos.Z);
+		FVector posOffset = hot.lastPosition - FVector(0.f, 0.f, -1 * hot.localMeshCompPos.Z);
 		
-		FVector endFacingPoint = FVector(0.f, 100.f, 0.f).RotateAngleAxis(owningActor->GetActorRotation().Yaw + (localMeshCompRot.Z), FVector::UpVector) + posOffset;
-		FVector endFacingPointWarped = FVector(0.f, 100.f, 0.f).RotateAngleAxis(rootRotWarp, FVector::UpVector).RotateAngleAxis(owningActor->GetActorRotation().Yaw + (localMeshCompRot.Z), FVector::UpVector) + posOffset;
+		FVector endFacingPoint = FVector(0.f, 100.f, 0.f).RotateAngleAxis(owningActor->GetActorRotation().Yaw + (localMeshCompYaw), FVector::UpVector) + posOffset;
+		FVector endFacingPointWarped = FVector(0.f, 100.f, 0.f).RotateAngleAxis(hot.rootRotWarp, FVector::UpVector).RotateAngleAxis(owningActor->GetActorRotation().Yaw + (localMeshCompYaw), FVector::UpVector) + posOffset;
 
 		context.AnimInstanceProxy->AnimDrawDebugDirectionalArrow(posOffset + FVector(0.f, 0.f, 100.f), endFacingPoint + FVector(0.f, 0.f, 100.f), 256.f, FColor::Orange, false, -1.0f, 1.0f);
 		context.AnimInstanceProxy->AnimDrawDebugDirectionalArrow(posOffset + FVector(0.f, 0.f, 100.f), endFacingPointWarped + FVector(0.f, 0.f, 100.f), 256.f, FColor::Blue, false, -1.0f, 1.0f);
@@ -1355,13 +1677,13 @@ void FAnimNode_MotionMatcher::DrawDebug(const FAnimationUpdateContext& context)
 		context.AnimInstanceProxy->AnimDrawDebugOnScreenMessage(FString::Printf(TEXT("%s @ %s"), *anim->GetFName().ToString(), *mmDataName), FColor(200, 200, 200), FVector2D(1.0f));
 
 		context.AnimInstanceProxy->AnimDrawDebugOnScreenMessage(FString::Printf(TEXT("State Index:")), FColor::White, FVector2D(0.9f));
-		context.AnimInstanceProxy->AnimDrawDebugOnScreenMessage(FString::Printf(TEXT("%d"), currentPlayData.MatchedStateIndex), FColor::Green, FVector2D(1.0f));
+		context.AnimInstanceProxy->AnimDrawDebugOnScreenMessage(FString::Printf(TEXT("%d"), hot.currentPlayData.MatchedStateIndex), FColor::Green, FVector2D(1.0f));
 
 		context.AnimInstanceProxy->AnimDrawDebugOnScreenMessage(FString::Printf(TEXT("State Play Time:")), FColor::White, FVector2D(0.9f));
-		context.AnimInstanceProxy->AnimDrawDebugOnScreenMessage(FString::Printf(TEXT("%f"), currentPlayData.CurrentPlayTime), FColor::Blue, FVector2D(1.0f));
+		context.AnimInstanceProxy->AnimDrawDebugOnScreenMessage(FString::Printf(TEXT("%f"), hot.currentPlayData.CurrentPlayTime), FColor::Blue, FVector2D(1.0f));
 
 		context.AnimInstanceProxy->AnimDrawDebugOnScreenMessage(FString::Printf(TEXT("Time Warp:")), FColor::White, FVector2D(0.9f));
-		context.AnimInstanceProxy->AnimDrawDebugOnScreenMessage(FString::Printf(TEXT("%f"), currentTimeScaleWarp), FColor::Blue, FVector2D(1.0f));
+		context.AnimInstanceProxy->AnimDrawDebugOnScreenMessage(FString::Printf(TEXT("%f"), hot.currentTimeScaleWarp), FColor::Blue, FVector2D(1.0f));
 
 		/*context.AnimInstanceProxy->AnimDrawDebugOnScreenMessage(
 			FString::Printf(TEXT("Actual Root Velocity:")), FColor::White, FVector2D(0.9f)
@@ -1406,11 +1728,11 @@ void FAnimNode_MotionMatcher::DrawDebug(const FAnimationUpdateContext& context)
 			FString::Printf(TEXT("Anim Trajectory:")), FColor::White, FVector2D(0.9f)
 		);
 
-		for (int32 i = 0; i != MotionDataAsset->TrajectoryTimings.Num(); ++i)
+		for (int32 i = 0; i != database->TrajectoryTimings.Num(); ++i)
 		{
 			context.AnimInstanceProxy->AnimDrawDebugOnScreenMessage(
 				FString::Printf(TEXT("\r(%s )   %s     %s     %s     |     %s"),
-					*f(MotionDataAsset->TrajectoryTimings[i]),
+					*f(database->TrajectoryTimings[i]),
 					*f(currentPose.Trajectory[i].Position.X), *f(currentPose.Trajectory[i].Position.Y), *f(currentPose.Trajectory[i].Position.Z), *f(currentPose.Trajectory[i].Facing)
 				), FColor::Cyan, FVector2D(1.0f)
 			);
@@ -1420,11 +1742,11 @@ void FAnimNode_MotionMatcher::DrawDebug(const FAnimationUpdateContext& context)
 			FString::Printf(TEXT("Desired Trajectory:")), FColor::White, FVector2D(0.9f)
 		);
 
-		for (int32 i = 0; i != MotionDataAsset->TrajectoryTimings.Num(); ++i)
+		for (int32 i = 0; i != database->TrajectoryTimings.Num(); ++i)
 		{
 			context.AnimInstanceProxy->AnimDrawDebugOnScreenMessage(
 				FString::Printf(TEXT("\r(%s )   %s     %s     %s     |     %s"),
-					*f(MotionDataAsset->TrajectoryTimings[i]),
+					*f(database->TrajectoryTimings[i]),
 					*f(desiredTrajectory[i].Position.X), *f(desiredTrajectory[i].Position.Y), *f(desiredTrajectory[i].Position.Z), *f(desiredTrajectory[i].Facing)
 				), FColor::Cyan, FVector2D(1.0f)
 			);
@@ -1434,22 +1756,22 @@ void FAnimNode_MotionMatcher::DrawDebug(const FAnimationUpdateContext& context)
 		context.AnimInstanceProxy->AnimDrawDebugOnScreenMessage(FString::Printf(TEXT("%f"), Input.DesiredFacing), FColor::Blue, FVector2D(1.0f));
 
 		context.AnimInstanceProxy->AnimDrawDebugOnScreenMessage(FString::Printf(TEXT("Loop Bias:")), FColor::White, FVector2D(0.9f));
-		context.AnimInstanceProxy->AnimDrawDebugOnScreenMessage(FString::Printf(TEXT("%f"), 1.0f - (MotionDataAsset->LoopBias * steadyBias)), FColor::Blue, FVector2D(1.0f));
+		context.AnimInstanceProxy->AnimDrawDebugOnScreenMessage(FString::Printf(TEXT("%f"), 1.0f - (MotionDataAsset->LoopBias * hot.steadyBias)), FColor::Blue, FVector2D(1.0f));
 
 		context.AnimInstanceProxy->AnimDrawDebugOnScreenMessage(FString::Printf(TEXT("Cost:")), FColor::White, FVector2D(0.9f));
-		context.AnimInstanceProxy->AnimDrawDebugOnScreenMessage(FString::Printf(TEXT("%f"), lastBestCost), FColor::Blue, FVector2D(1.0f));
+		context.AnimInstanceProxy->AnimDrawDebugOnScreenMessage(FString::Printf(TEXT("%f"), hot.lastBestCost), FColor::Blue, FVector2D(1.0f));
 	
 
 		context.AnimInstanceProxy->AnimDrawDebugOnScreenMessage(FString::Printf(TEXT("Root Rotation Warp:")), FColor::White, FVector2D(0.9f));
-		context.AnimInstanceProxy->AnimDrawDebugOnScreenMessage(FString::Printf(TEXT("%f"), rootRotWarp), FColor::Blue, FVector2D(1.0f));
+		context.AnimInstanceProxy->AnimDrawDebugOnScreenMessage(FString::Printf(TEXT("%f"), hot.rootRotWarp), FColor::Blue, FVector2D(1.0f));
 		*/
 	}
 }
 
 void FAnimNode_MotionMatcher::DrawTrajectory(const FAnimationUpdateContext& context, const TArray<FTrajectoryPoint>& trajectory, FColor color)
 {
-	float actorYaw = owningActor->GetActorRotation().Yaw + (localMeshCompRot.Z); // TODO: This 90* offset shouldn't be hardcoded.
-	FVector posOffset = lastPosition - FVector(0.f, 0.f, -1 * localMeshCompPos.Z);
+	float actorYaw = owningActor->GetActorRotation().Yaw + (localMeshCompYaw); // TODO: This 90* offset shouldn't be hardcoded.
+	FVector posOffset = hot.lastPosition - FVector(0.f, 0.f, -1 * hot.localMeshCompPos.Z);
 
 	for (int32 i = 0; i != trajectory.Num(); ++i)
 	{
@@ -1474,14 +1796,14 @@ void FAnimNode_MotionMatcher::DrawTrajectory(const FAnimationUpdateContext& cont
 
 void FAnimNode_MotionMatcher::DrawBoneData(const FAnimationUpdateContext& context, const TArray<FMMatcherBoneData>& bones, FColor color)
 {
-	float actorYaw = owningActor->GetActorRotation().Yaw + (localMeshCompRot.Z);
+	float actorYaw = owningActor->GetActorRotation().Yaw + (localMeshCompYaw);
 
 	for (int32 i = 0; i != bones.Num(); ++i)
 	{
 		const FMMatcherBoneData& bone = bones[i];
 
-		FVector bonePos = lastPosition + localMeshCompPos + bone.Position.RotateAngleAxis(actorYaw, FVector::UpVector);
-		FVector boneVel = lastPosition + localMeshCompPos + (bone.Position + (bone.Velocity / 4)).RotateAngleAxis(actorYaw, FVector::UpVector);
+		FVector bonePos = hot.lastPosition + hot.localMeshCompPos + bone.Position.RotateAngleAxis(actorYaw, FVector::UpVector);
+		FVector boneVel = hot.lastPosition + hot.localMeshCompPos + (bone.Position + (bone.Velocity / 4)).RotateAngleAxis(actorYaw, FVector::UpVector);
 		//FVector boneVel = lastPosition + localMeshCompPos + (bone.Position + (FVector::ZeroVector / 4)).RotateAngleAxis(actorYaw, FVector::UpVector);
 
 		// Crashes
@@ -1497,17 +1819,17 @@ void FAnimNode_MotionMatcher::DrawBoneData(const FAnimationUpdateContext& contex
 
 void FAnimNode_MotionMatcher::DrawFootIKThreshold(const FAnimationUpdateContext& context)
 {
-	bReverse = (lerpAlpha >= 1.0f || lerpAlpha <= 0.0f) ? !bReverse : bReverse;
-	lerpAlpha = FMath::Clamp(lerpAlpha + ((bReverse) ? -0.5f * context.GetDeltaTime() : 0.5f * context.GetDeltaTime()), 0.0f, 1.0f);
+	cold->bReverse = (cold->lerpAlpha >= 1.0f || cold->lerpAlpha <= 0.0f) ? !cold->bReverse : cold->bReverse;
+	cold->lerpAlpha = FMath::Clamp(cold->lerpAlpha + ((cold->bReverse) ? -0.5f * context.GetDeltaTime() : 0.5f * context.GetDeltaTime()), 0.0f, 1.0f);
 
 	FColor shade;
 
-	if (IsPointInBalancingArea(FVector2D(centerOfMass.X, centerOfMass.Y)))
+	if (IsPointInBalancingArea(FVector2D(cold->centerOfMass.X, cold->centerOfMass.Y)))
 		shade = FColor::Green;
 	else
 		shade = FColor::Red;
 
-	context.AnimInstanceProxy->AnimDrawDebugSphere(FVector(centerOfMass.X, centerOfMass.Y, 0.f), 14.f, 4, shade, false, -1.f, 1.0f);
+	context.AnimInstanceProxy->AnimDrawDebugSphere(FVector(cold->centerOfMass.X, cold->centerOfMass.Y, 0.f), 14.f, 4, shade, false, -1.f, 1.0f);
 	//context.AnimInstanceProxy->AnimDrawDebugSphere(FVector(0.f, 0.f, 0.f), 14.f, 4, FColor::Red, false, -1.f, 1.0f);
 
 	const float spacing = 2.f;
@@ -1519,7 +1841,7 @@ void FAnimNode_MotionMatcher::DrawFootIKThreshold(const FAnimationUpdateContext&
 
 	int32 totalDots = vLines * hLines;
 
-	FVector actorPosOffset = lastPosition;//.RotateAngleAxis(owningActor->GetActorRotation().Yaw + (localMeshCompRot.Z), FVector::UpVector);
+	FVector actorPosOffset = hot.lastPosition;//.RotateAngleAxis(owningActor->GetActorRotation().Yaw + (localMeshCompYaw), FVector::UpVector);
 
 	float initialOffsetX = actorPosOffset.X - width / 2;
 	float initialOffsetY = actorPosOffset.Y - width / 2;
@@ -0,0 +1,291 @@
+// Copyright Wild Montage, LLC. All Rights Reserved.
+
+#include "Core/MMCoreBenchmark.h"
+#include "Core/MMCoreNormalization.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <random>
+
+namespace MMCore
+{
+	namespace
+	{
+		using Clock = std::chrono::steady_clock;
+
+		double GetMicroseconds(Clock::time_point start)
+		{
+			return std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+		}
+
+		struct SyntheticDatabase
+		{
+			FeatureLayout Layout;
+			std::vector<float> Rows;
+			std::vector<StateRange> States;
+			std::vector<FeatureNormal> TrajectoryPositionNormals;
+			std::vector<FeatureNormal> TrajectoryFacingNormals;
+			FeatureNormal RootVelocityNormal;
+
+			DatabaseView GetView() const
+			{
+				DatabaseView view;
+				view.Layout = &Layout;
+				view.Rows = Rows.data();
+				view.States = States.data();
+				view.NumStates = (int32_t)States.size();
+				view.Biases.NaturalBias = 0.5f;
+				view.Biases.LoopBias = 0.3f;
+				return view;
+			}
+		};
+
+		// Rows follow smooth random walks so neighboring poses look alike, like real animation does.
+		void Generate(SyntheticDatabase& db, int32_t numPoses, int32_t numStates, int32_t numBones, int32_t numPoints, std::mt19937& random)
+		{
+			std::uniform_real_distribution<float> start(-1.f, 1.f);
+			std::uniform_real_distribution<float> step(-0.05f, 0.05f);
+
+			db.Layout.Init(numBones, numPoints);
+			db.States.resize(numStates);
+			db.Rows.resize(size_t(numPoses) * db.Layout.Stride);
+
+			for (int32_t i = 0; i != numStates; ++i)
+			{
+				db.States[i].FirstRow = (int32_t)((int64_t)numPoses * i / numStates);
+				db.States[i].NumPoses = (int32_t)((int64_t)numPoses * (i + 1) / numStates) - db.States[i].FirstRow;
+				db.States[i].bLoop = (i % 3) == 0;
+				db.States[i].PlayLength = db.States[i].NumPoses * 0.03f;
+			}
+
+			std::vector<float> walk(db.Layout.Stride);
+
+			for (const StateRange& state : db.States)
+			{
+				for (float& value : walk)
+					value = start(random);
+
+				for (int32_t pose = 0; pose != state.NumPoses; ++pose)
+				{
+					float* row = db.Rows.data() + size_t(state.FirstRow + pose) * db.Layout.Stride;
+
+					for (int32_t d = 0; d != db.Layout.Stride; ++d)
+					{
+						walk[d] += step(random);
+						row[d] = walk[d];
+					}
+				}
+			}
+
+			FeatureNormal identity;
+			identity.Scale = 1.f;
+
+			db.RootVelocityNormal = identity;
+			db.TrajectoryPositionNormals.assign(numPoints, identity);
+			db.TrajectoryFacingNormals.assign(numPoints, identity);
+		}
+
+		// Stands in for EvaluatePoseSample() + NormalizeTrajectory(): lerp two rows, then build a normalized query from them.
+		void BuildSampleQuery(const SyntheticDatabase& db, const float* rowA, const float* rowB, float alpha, std::vector<float>& scratchRow, float* outQuery)
+		{
+			const FeatureLayout& L = db.Layout;
+
+			for (int32_t d = 0; d != L.Stride; ++d)
+				scratchRow[d] = rowA[d] + (rowB[d] - rowA[d]) * alpha;
+
+			BuildQuery(L, db.RootVelocityNormal, db.TrajectoryPositionNormals.data(), db.TrajectoryFacingNormals.data(), scratchRow.data(),
+				scratchRow.data() + L.RootVelocity, scratchRow.data() + L.TrajectoryPosition, scratchRow.data() + L.TrajectoryFacing, outQuery);
+		}
+
+		DatabaseBenchmark RunDatabase(const BenchmarkParams& params, int32_t numPoses)
+		{
+			const int32_t numQueries = params.NumQueries;
+
+			std::mt19937 random(numPoses);
+			SyntheticDatabase db;
+			Generate(db, numPoses, std::min(params.NumStates, numPoses), params.NumBones, params.NumTrajectoryPoints, random);
+
+			const DatabaseView view = db.GetView();
+			const int32_t dims = db.Layout.SearchDims;
+
+			DatabaseBenchmark result;
+			result.NumPoses = numPoses;
+			result.SearchDims = dims;
+			result.Megabytes = db.Rows.size() * sizeof(float) / (1024.0 * 1024.0);
+
+			// Index build
+			Clock::time_point start = Clock::now();
+			SearchIndex index;
+			index.Build(view);
+			result.IndexBuildMs = GetMicroseconds(start) / 1000.0;
+
+			// Queries near random database poses, like a character would produce.
+			std::vector<float> queries(size_t(numQueries) * dims);
+			std::vector<SearchParams> searchParams(numQueries);
+			std::vector<float> scratchRow(db.Layout.Stride);
+			std::uniform_real_distribution<float> unit(0.f, 1.f);
+
+			start = Clock::now();
+
+			for (int32_t q = 0; q != numQueries; ++q)
+			{
+				const int32_t state = std::uniform_int_distribution<int32_t>(0, (int32_t)db.States.size() - 1)(random);
+				const int32_t pose = std::uniform_int_distribution<int32_t>(0, std::max(db.States[state].NumPoses - 2, 0))(random);
+				const float* rowA = view.GetRow(state, pose);
+				const float* rowB = view.GetRow(state, std::min(pose + 1, db.States[state].NumPoses - 1));
+
+				BuildSampleQuery(db, rowA, rowB, unit(random), scratchRow, queries.data() + size_t(q) * dims);
+
+				searchParams[q].CurrentState = state;
+				searchParams[q].CurrentPose = pose;
+				searchParams[q].SteadyBias = unit(random);
+				searchParams[q].bLoopsOnly = (q % 10) == 0;
+			}
+
+			result.QueryBuildUs = GetMicroseconds(start) / numQueries;
+
+			std::uniform_real_distribution<float> noise(-0.2f, 0.2f);
+
+			for (float& value : queries)
+				value += noise(random);
+
+			// Search backends. Each one gets warm-up passes first, so the first one timed doesn't pay for cold caches
+			// and skew the BruteForce baseline.
+			std::vector<SearchResult> reference(numQueries);
+			std::vector<SearchResult> results(numQueries);
+			double baselineUs = 0.0;
+
+			for (int32_t backendIndex = 0; backendIndex != (int32_t)SearchBackend::Count; ++backendIndex)
+			{
+				const SearchBackend backend = (SearchBackend)backendIndex;
+
+				for (int32_t pass = 0; pass != params.WarmupPasses; ++pass)
+				{
+					for (int32_t q = 0; q != numQueries; ++q)
+						results[q] = Search(backend, view, &index, queries.data() + size_t(q) * dims, searchParams[q]);
+				}
+
+				SearchStats stats;
+				start = Clock::now();
+
+				for (int32_t q = 0; q != numQueries; ++q)
+					results[q] = Search(backend, view, &index, queries.data() + size_t(q) * dims, searchParams[q], &stats);
+
+				const double us = GetMicroseconds(start) / numQueries;
+
+				if (backend == SearchBackend::BruteForce)
+				{
+					reference = results;
+					baselineUs = us;
+				}
+
+				int32_t agreements = 0;
+
+				for (int32_t q = 0; q != numQueries; ++q)
+					agreements += (results[q].StateIndex == reference[q].StateIndex && results[q].PoseIndex == reference[q].PoseIndex) ? 1 : 0;
+
+				BackendBenchmark backendResult;
+				backendResult.Backend = backend;
+				backendResult.UsPerQuery = us;
+				backendResult.Speedup = (us > 0.0) ? baselineUs / us : 0.0;
+				backendResult.PosesScannedPerQuery = double(stats.PosesScanned) / numQueries;
+				backendResult.PosesPrunedPerQuery = double(stats.PosesPruned) / numQueries;
+				backendResult.Agreement = double(agreements) / numQueries;
+				result.Backends.push_back(backendResult);
+			}
+
+			// Normalization of every search feature.
+			start = Clock::now();
+
+			for (int32_t column = 0; column < dims; column += 3)
+			{
+				const int32_t width = std::min(3, dims - column);
+				const FeatureStats featureStats = ComputeFeatureStats(db.Rows.data(), numPoses, db.Layout.Stride, column, width);
+				NormalizeColumns(db.Rows.data(), numPoses, db.Layout.Stride, column, width, MakeFeatureNormal(featureStats.Mean, featureStats.StandardDeviation, 1.f));
+			}
+
+			result.NormalizationMs = GetMicroseconds(start) / 1000.0;
+			return result;
+		}
+
+		void AppendJson(std::string& json, const char* format, ...)
+		{
+			char buffer[256];
+			va_list args;
+			va_start(args, format);
+			vsnprintf(buffer, sizeof(buffer), format, args);
+			va_end(args);
+			json += buffer;
+		}
+
+		// Only what the tags need: quotes and backslashes.
+		std::string EscapeJson(const std::string& value)
+		{
+			std::string escaped;
+
+			for (char c : value)
+			{
+				if (c == '"' || c == '\\')
+					escaped += '\\';
+
+				escaped += c;
+			}
+
+			return escaped;
+		}
+	}
+
+	std::vector<DatabaseBenchmark> RunBenchmark(const BenchmarkParams& params)
+	{
+		BenchmarkParams clamped = params;
+		clamped.NumBones = std::max(params.NumBones, 0);
+		clamped.NumTrajectoryPoints = std::max(params.NumTrajectoryPoints, 1);
+		clamped.NumQueries = std::max(params.NumQueries, 1);
+		clamped.NumStates = std::max(params.NumStates, 1);
+		clamped.WarmupPasses = std::max(params.WarmupPasses, 0);
+
+		std::vector<DatabaseBenchmark> results;
+
+		for (int32_t numPoses : clamped.PoseCounts)
+			results.push_back(RunDatabase(clamped, std::max(numPoses, clamped.NumStates)));
+
+		return results;
+	}
+
+	std::string BenchmarkToJson(const BenchmarkParams& params, const std::vector<DatabaseBenchmark>& results, const std::string& build, const std::string& date)
+	{
+		std::string json = "{\n";
+		json += "\t\"build\": \"" + EscapeJson(build) + "\",\n";
+		json += "\t\"date\": \"" + EscapeJson(date) + "\",\n";
+		json += "\t\"baseline\": \"BruteForce\",\n";
+		AppendJson(json, "\t\"bones\": %d,\n\t\"trajectoryPoints\": %d,\n\t\"queries\": %d,\n\t\"warmupPasses\": %d,\n",
+			params.NumBones, params.NumTrajectoryPoints, params.NumQueries, params.WarmupPasses);
+		json += "\t\"databases\": [";
+
+		for (size_t i = 0; i != results.size(); ++i)
+		{
+			const DatabaseBenchmark& db = results[i];
+
+			AppendJson(json, "%s\n\t\t{\n\t\t\t\"poses\": %d,\n\t\t\t\"searchDims\": %d,\n\t\t\t\"megabytes\": %.3f,\n\t\t\t\"indexBuildMs\": %.3f,\n\t\t\t\"queryBuildUs\": %.3f,\n",
+				(i != 0) ? "," : "", db.NumPoses, db.SearchDims, db.Megabytes, db.IndexBuildMs, db.QueryBuildUs);
+			json += "\t\t\t\"search\": [";
+
+			for (size_t b = 0; b != db.Backends.size(); ++b)
+			{
+				const BackendBenchmark& backend = db.Backends[b];
+
+				AppendJson(json, "%s\n\t\t\t\t{ \"backend\": \"%s\", \"usPerQuery\": %.3f, \"speedup\": %.3f, ", (b != 0) ? "," : "",
+					GetSearchBackendName(backend.Backend), backend.UsPerQuery, backend.Speedup);
+				AppendJson(json, "\"posesScannedPerQuery\": %.1f, \"posesPrunedPerQuery\": %.1f, \"agreement\": %.4f }",
+					backend.PosesScannedPerQuery, backend.PosesPrunedPerQuery, backend.Agreement);
+			}
+
+			AppendJson(json, "\n\t\t\t],\n\t\t\t\"normalizationMs\": %.3f\n\t\t}", db.NormalizationMs);
+		}
+
+		json += "\n\t]\n}\n";
+		return json;
+	}
+}
@@ -0,0 +1,63 @@
+// Copyright Wild Montage, LLC. All Rights Reserved.
+
+#include "Core/MMCoreContacts.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace MMCore
+{
+	void DetectContacts(const float* positions, int32_t numKeys, float keyInterval, const ContactParams& params, uint8_t* outContacts)
+	{
+		if (numKeys <= 0) return;
+
+		if (numKeys == 1 || keyInterval <= 0.f)
+		{
+			std::fill(outContacts, outContacts + numKeys, (uint8_t)1);
+			return;
+		}
+
+		float minHeight = positions[2];
+
+		for (int32_t i = 1; i != numKeys; ++i)
+			minHeight = std::min(minHeight, positions[i * 3 + 2]);
+
+		// Squared speeds towards the next key (the last key reuses the previous one) and heights above the lowest point.
+		std::vector<float> speedsSq(numKeys);
+		std::vector<float> heights(numKeys);
+		const float invIntervalSq = 1.f / (keyInterval * keyInterval);
+
+		for (int32_t i = 0; i != numKeys - 1; ++i)
+		{
+			const float dx = positions[i * 3 + 3] - positions[i * 3];
+			const float dy = positions[i * 3 + 4] - positions[i * 3 + 1];
+			const float dz = positions[i * 3 + 5] - positions[i * 3 + 2];
+
+			speedsSq[i] = (dx * dx + dy * dy + dz * dz) * invIntervalSq;
+			heights[i] = positions[i * 3 + 2] - minHeight;
+		}
+
+		speedsSq[numKeys - 1] = speedsSq[numKeys - 2];
+		heights[numKeys - 1] = positions[(numKeys - 1) * 3 + 2] - minHeight;
+
+		const float enterSq = params.EnterSpeed * params.EnterSpeed;
+		const float exitSpeed = std::max(params.ExitSpeed, params.EnterSpeed);
+		const float exitSq = exitSpeed * exitSpeed;
+		const float maxHeight = (params.MaxHeight > 0.f) ? params.MaxHeight : INFINITY;
+
+		bool bContact = false;
+
+		for (int32_t i = 0; i != numKeys; ++i)
+		{
+			if (heights[i] > maxHeight)
+				bContact = false;
+			else if (bContact)
+				bContact = speedsSq[i] <= exitSq;
+			else
+				bContact = speedsSq[i] <= enterSq;
+
+			outContacts[i] = bContact ? 1 : 0;
+		}
+	}
+}
@@ -0,0 +1,85 @@
+// Copyright Wild Montage, LLC. All Rights Reserved.
+
+#include "Core/MMCoreNormalization.h"
+
+#include <cmath>
+#include <cstring>
+
+namespace MMCore
+{
+	FeatureStats ComputeFeatureStats(const float* rows, int32_t numRows, int32_t stride, int32_t column, int32_t width)
+	{
+		FeatureStats stats;
+		stats.Count = double(numRows) * width;
+
+		if (stats.Count == 0.0) return stats;
+
+		double sum = 0.0;
+
+		for (int32_t row = 0; row != numRows; ++row)
+		{
+			const float* values = rows + row * stride + column;
+
+			for (int32_t i = 0; i != width; ++i)
+				sum += values[i];
+		}
+
+		stats.Mean = sum / stats.Count;
+
+		double sqrDeviations = 0.0;
+
+		for (int32_t row = 0; row != numRows; ++row)
+		{
+			const float* values = rows + row * stride + column;
+
+			for (int32_t i = 0; i != width; ++i)
+				sqrDeviations += (values[i] - stats.Mean) * (values[i] - stats.Mean);
+		}
+
+		stats.Variance = sqrDeviations / stats.Count;
+		stats.StandardDeviation = (stats.Variance != 0.0) ? std::sqrt(stats.Variance) : 1.0;
+
+		return stats;
+	}
+
+	FeatureNormal MakeFeatureNormal(double mean, double standardDeviation, float weight)
+	{
+		FeatureNormal normal;
+		normal.Mean = float(mean);
+		normal.Scale = (standardDeviation != 0.0) ? float(1.0 / standardDeviation) * weight : 0.f;
+		return normal;
+	}
+
+	void NormalizeColumns(float* rows, int32_t numRows, int32_t stride, int32_t column, int32_t width, const FeatureNormal& normal)
+	{
+		for (int32_t row = 0; row != numRows; ++row)
+		{
+			float* values = rows + row * stride + column;
+
+			for (int32_t i = 0; i != width; ++i)
+				values[i] = normal.Normalize(values[i]);
+		}
+	}
+
+	void BuildQuery(const FeatureLayout& layout, const FeatureNormal& rootVelocityNormal, const FeatureNormal* trajectoryPositionNormals,
+		const FeatureNormal* trajectoryFacingNormals, const float* poseRow, const float* rootVelocity, const float* trajectoryPositions,
+		const float* trajectoryFacings, float* outQuery)
+	{
+		for (int32_t i = 0; i != 3; ++i)
+			outQuery[layout.RootVelocity + i] = rootVelocityNormal.Normalize(rootVelocity[i]);
+
+		std::memcpy(outQuery + layout.Bones, poseRow + layout.Bones, layout.NumBones * 6 * sizeof(float));
+
+		for (int32_t i = 0; i != layout.NumTrajectoryPoints; ++i)
+		{
+			const FeatureNormal& posNormal = trajectoryPositionNormals[i];
+			float* point = outQuery + layout.TrajectoryPosition + i * 3;
+
+			point[0] = posNormal.Normalize(trajectoryPositions[i * 3 + 0]);
+			point[1] = posNormal.Normalize(trajectoryPositions[i * 3 + 1]);
+			point[2] = posNormal.Normalize(trajectoryPositions[i * 3 + 2]);
+
+			outQuery[layout.TrajectoryFacing + i] = trajectoryFacingNormals[i].Normalize(trajectoryFacings[i]);
+		}
+	}
+}
@@ -0,0 +1,295 @@
+// Copyright Wild Montage, LLC. All Rights Reserved.
+
+#include "Core/MMCoreSearch.h"
+
+#include <algorithm>
+
+namespace MMCore
+{
+	namespace
+	{
+		inline float LaneDistSquared(const float* a, const float* b, int32_t dims)
+		{
+			float lanes[4] = { 0.f, 0.f, 0.f, 0.f };
+			int32_t d = 0;
+
+			for (; d + 4 <= dims; d += 4)
+			{
+				for (int32_t lane = 0; lane != 4; ++lane)
+				{
+					const float diff = a[d + lane] - b[d + lane];
+					lanes[lane] += diff * diff;
+				}
+			}
+
+			for (; d != dims; ++d)
+				lanes[0] += (a[d] - b[d]) * (a[d] - b[d]);
+
+			return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+		}
+
+		// Accumulates in chunks of 8 dimensions and bails out once the cost can't win. Returns false if pruned.
+		// Callers prune against the runner-up so SecondCost stays exact too.
+		inline bool PrunedDistSquared(const float* a, const float* b, int32_t dims, float limit, float& outDist)
+		{
+			float dist = 0.f;
+			int32_t d = 0;
+
+			while (d != dims)
+			{
+				const int32_t end = std::min(d + 8, dims);
+
+				for (; d != end; ++d)
+					dist += (a[d] - b[d]) * (a[d] - b[d]);
+
+				if (dist >= limit)
+					return false;
+			}
+
+			outDist = dist;
+			return true;
+		}
+
+		inline void Consider(SearchResult& result, float cost, int32_t stateIndex, int32_t poseIndex)
+		{
+			if (cost < result.Cost)
+			{
+				result.SecondCost = result.Cost;
+				result.Cost = cost;
+				result.StateIndex = stateIndex;
+				result.PoseIndex = poseIndex;
+			}
+			else if (cost < result.SecondCost)
+			{
+				result.SecondCost = cost;
+			}
+		}
+
+		// Squared distance from the query to a box.
+		inline float BoxDistSquared(const float* query, const float* mins, const float* maxs, int32_t dims)
+		{
+			float dist = 0.f;
+
+			for (int32_t d = 0; d != dims; ++d)
+			{
+				const float below = mins[d] - query[d];
+				const float above = query[d] - maxs[d];
+				const float outside = std::max(0.f, std::max(below, above));
+				dist += outside * outside;
+			}
+
+			return dist;
+		}
+
+		// Smallest bias multiplier any pose of the block can get. Keeps the box test exact.
+		inline float GetMinBiasScale(const SearchIndex::Block& block, bool bLoop, const SearchParams& params, const SearchBiases& biases)
+		{
+			float scale = GetBiasScale(-1, -1, bLoop, params, biases);
+
+			if (block.State == params.CurrentState)
+			{
+				scale = std::min(scale, GetBiasScale(block.State, -1, bLoop, params, biases));
+
+				if (params.CurrentPose >= block.FirstPose && params.CurrentPose < block.FirstPose + block.NumPoses)
+					scale = std::min(scale, GetBiasScale(block.State, params.CurrentPose, bLoop, params, biases));
+			}
+
+			return scale;
+		}
+	}
+
+	const char* GetSearchBackendName(SearchBackend backend)
+	{
+		switch (backend)
+		{
+		case SearchBackend::BruteForce: return "BruteForce";
+		case SearchBackend::Lanes: return "Lanes";
+		case SearchBackend::Pruned: return "Pruned";
+		case SearchBackend::Indexed: return "Indexed";
+		default: return "Unknown";
+		}
+	}
+
+	void SearchIndex::Build(const DatabaseView& db, int32_t blockSize)
+	{
+		BlockSize = std::max(blockSize, 1);
+		Dims = db.Layout->SearchDims;
+		Blocks.clear();
+		Mins.clear();
+		Maxs.clear();
+
+		for (int32_t stateIndex = 0; stateIndex != db.NumStates; ++stateIndex)
+		{
+			const StateRange& state = db.States[stateIndex];
+
+			for (int32_t firstPose = 0; firstPose < state.NumPoses; firstPose += BlockSize)
+			{
+				Block block;
+				block.State = stateIndex;
+				block.FirstPose = firstPose;
+				block.NumPoses = std::min(BlockSize, state.NumPoses - firstPose);
+				Blocks.push_back(block);
+
+				const size_t offset = Mins.size();
+				Mins.resize(offset + Dims, std::numeric_limits<float>::max());
+				Maxs.resize(offset + Dims, -std::numeric_limits<float>::max());
+
+				for (int32_t pose = firstPose; pose != firstPose + block.NumPoses; ++pose)
+				{
+					const float* row = db.GetRow(stateIndex, pose);
+
+					for (int32_t d = 0; d != Dims; ++d)
+					{
+						Mins[offset + d] = std::min(Mins[offset + d], row[d]);
+						Maxs[offset + d] = std::max(Maxs[offset + d], row[d]);
+					}
+				}
+			}
+		}
+	}
+
+	SearchResult BruteForceSearch(const DatabaseView& db, const float* query, const SearchParams& params, SearchStats* stats)
+	{
+		SearchResult result;
+		const int32_t dims = db.Layout->SearchDims;
+		const int32_t stride = db.Layout->Stride;
+
+		for (int32_t stateIndex = 0; stateIndex != db.NumStates; ++stateIndex)
+		{
+			const StateRange& state = db.States[stateIndex];
+
+			if (params.bLoopsOnly && !state.bLoop)
+				continue;
+
+			const float* row = db.Rows + state.FirstRow * stride;
+
+			for (int32_t poseIndex = 0; poseIndex != state.NumPoses; ++poseIndex, row += stride)
+				Consider(result, ApplyBiases(DistSquared(query, row, dims), stateIndex, poseIndex, state.bLoop, params, db.Biases), stateIndex, poseIndex);
+
+			if (stats) stats->PosesScanned += state.NumPoses;
+		}
+
+		return result;
+	}
+
+	SearchResult LaneSearch(const DatabaseView& db, const float* query, const SearchParams& params, SearchStats* stats)
+	{
+		SearchResult result;
+		const int32_t dims = db.Layout->SearchDims;
+		const int32_t stride = db.Layout->Stride;
+
+		for (int32_t stateIndex = 0; stateIndex != db.NumStates; ++stateIndex)
+		{
+			const StateRange& state = db.States[stateIndex];
+
+			if (params.bLoopsOnly && !state.bLoop)
+				continue;
+
+			const float* row = db.Rows + state.FirstRow * stride;
+
+			for (int32_t poseIndex = 0; poseIndex != state.NumPoses; ++poseIndex, row += stride)
+				Consider(result, ApplyBiases(LaneDistSquared(query, row, dims), stateIndex, poseIndex, state.bLoop, params, db.Biases), stateIndex, poseIndex);
+
+			if (stats) stats->PosesScanned += state.NumPoses;
+		}
+
+		return result;
+	}
+
+	SearchResult PrunedSearch(const DatabaseView& db, const float* query, const SearchParams& params, SearchStats* stats)
+	{
+		SearchResult result;
+		const int32_t dims = db.Layout->SearchDims;
+		const int32_t stride = db.Layout->Stride;
+		const float tolerance = 1.f + std::max(params.Tolerance, 0.f);
+
+		for (int32_t stateIndex = 0; stateIndex != db.NumStates; ++stateIndex)
+		{
+			const StateRange& state = db.States[stateIndex];
+
+			if (params.bLoopsOnly && !state.bLoop)
+				continue;
+
+			const float* row = db.Rows + state.FirstRow * stride;
+
+			for (int32_t poseIndex = 0; poseIndex != state.NumPoses; ++poseIndex, row += stride)
+			{
+				const float scale = GetBiasScale(stateIndex, poseIndex, state.bLoop, params, db.Biases);
+				const float limit = (scale > 0.f) ? result.SecondCost / (scale * tolerance) : std::numeric_limits<float>::max();
+				float dist;
+
+				if (PrunedDistSquared(query, row, dims, limit, dist))
+				{
+					Consider(result, dist * scale, stateIndex, poseIndex);
+					if (stats) stats->PosesScanned++;
+				}
+				else if (stats)
+				{
+					stats->PosesPruned++;
+				}
+			}
+		}
+
+		return result;
+	}
+
+	SearchResult IndexedSearch(const DatabaseView& db, const SearchIndex& index, const float* query, const SearchParams& params, SearchStats* stats)
+	{
+		if (!index.IsValid())
+			return PrunedSearch(db, query, params, stats);
+
+		SearchResult result;
+		const int32_t dims = db.Layout->SearchDims;
+		const float tolerance = 1.f + std::max(params.Tolerance, 0.f);
+
+		for (size_t blockIndex = 0; blockIndex != index.Blocks.size(); ++blockIndex)
+		{
+			const SearchIndex::Block& block = index.Blocks[blockIndex];
+			const StateRange& state = db.States[block.State];
+
+			if (params.bLoopsOnly && !state.bLoop)
+				continue;
+
+			const float minScale = GetMinBiasScale(block, state.bLoop, params, db.Biases);
+			const float* mins = index.Mins.data() + blockIndex * index.Dims;
+			const float* maxs = index.Maxs.data() + blockIndex * index.Dims;
+
+			// Blocks that can be biased down to zero (or below) can't be culled.
+			if (minScale > 0.f && BoxDistSquared(query, mins, maxs, dims) * minScale * tolerance >= result.SecondCost)
+			{
+				if (stats) stats->PosesPruned += block.NumPoses;
+				continue;
+			}
+
+			for (int32_t poseIndex = block.FirstPose; poseIndex != block.FirstPose + block.NumPoses; ++poseIndex)
+			{
+				const float scale = GetBiasScale(block.State, poseIndex, state.bLoop, params, db.Biases);
+				const float limit = (scale > 0.f) ? result.SecondCost / (scale * tolerance) : std::numeric_limits<float>::max();
+				float dist;
+
+				if (PrunedDistSquared(query, db.GetRow(block.State, poseIndex), dims, limit, dist))
+				{
+					Consider(result, dist * scale, block.State, poseIndex);
+					if (stats) stats->PosesScanned++;
+				}
+				else if (stats)
+				{
+					stats->PosesPruned++;
+				}
+			}
+		}
+
+		return result;
+	}
+
+	SearchResult Search(SearchBackend backend, const DatabaseView& db, const SearchIndex* index, const float* query, const SearchParams& params, SearchStats* stats)
+	{
+		switch (backend)
+		{
+		case SearchBackend::Lanes: return LaneSearch(db, query, params, stats);
+		case SearchBackend::Pruned: return PrunedSearch(db, query, params, stats);
+		case SearchBackend::Indexed: return index ? IndexedSearch(db, *index, query, params, stats) : PrunedSearch(db, query, params, stats);
+		default: return BruteForceSearch(db, query, params, stats);
+		}
+	}
+}
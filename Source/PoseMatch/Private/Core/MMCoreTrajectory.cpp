@@ -0,0 +1,216 @@
+// Copyright Wild Montage, LLC. All Rights Reserved.
+
+#include "Core/MMCoreTrajectory.h"
+
+#include <cmath>
+
+namespace MMCore
+{
+	void PredictTrajectory(const float* timings, int32_t numTimings, const TrajectoryInput& input, float* outPositions, float* outFacings)
+	{
+		const float lastTime = (numTimings != 0) ? timings[numTimings - 1] : 0.f;
+
+		for (int32_t i = 0; i != numTimings; ++i)
+		{
+			const float timing = timings[i];
+			float* position = outPositions + i * 3;
+
+			if (timing < 0.f)
+			{
+				for (int32_t axis = 0; axis != 3; ++axis)
+					position[axis] = input.Velocity[axis] * timing;
+
+				outFacings[i] = input.TurnSpeed * timing;
+			}
+			else
+			{
+				const float alpha = (lastTime > 0.f) ? timing / lastTime : 1.f;
+
+				for (int32_t axis = 0; axis != 3; ++axis)
+				{
+					const float current = input.Velocity[axis] * timing;
+					position[axis] = current + (input.DesiredVelocity[axis] * timing - current) * alpha;
+				}
+
+				const float currentFacing = input.TurnSpeed * timing;
+				outFacings[i] = currentFacing + (input.DesiredFacing - currentFacing) * alpha;
+			}
+		}
+	}
+
+	// Yaw (degrees) of a direction in character space, relative to straight ahead (+y), in [-180, 180].
+	static float GetPathFacing(float dx, float dy)
+	{
+		float facing = std::atan2(dy, dx) * (180.f / 3.14159265f) - 90.f;
+		return (facing < -180.f) ? facing + 360.f : facing;
+	}
+
+	void SamplePath(const float* timings, int32_t numTimings, const float* pathPoints, int32_t numPathPoints, float speed, const TrajectoryInput& input, float* outPositions, float* outFacings)
+	{
+		const float minSegmentLength = 1e-3f;
+
+		// Facing of the first segment that has a direction, used until we reach one.
+		float facing = 0.f;
+
+		for (int32_t segment = 0; segment + 1 < numPathPoints; ++segment)
+		{
+			const float* a = pathPoints + segment * 3;
+			const float* b = a + 3;
+
+			if (std::abs(b[0] - a[0]) + std::abs(b[1] - a[1]) > minSegmentLength)
+			{
+				facing = GetPathFacing(b[0] - a[0], b[1] - a[1]);
+				break;
+			}
+		}
+
+		// Timings are sorted, so the walk along the path only goes forward.
+		int32_t segment = 0;
+		float segmentStart = 0.f; // Path length up to the current segment.
+
+		for (int32_t i = 0; i != numTimings; ++i)
+		{
+			const float timing = timings[i];
+			float* position = outPositions + i * 3;
+
+			if (timing < 0.f)
+			{
+				for (int32_t axis = 0; axis != 3; ++axis)
+					position[axis] = input.Velocity[axis] * timing;
+
+				outFacings[i] = input.TurnSpeed * timing;
+				continue;
+			}
+
+			if (numPathPoints < 2)
+			{
+				for (int32_t axis = 0; axis != 3; ++axis)
+					position[axis] = (numPathPoints != 0) ? pathPoints[axis] : 0.f;
+
+				outFacings[i] = facing;
+				continue;
+			}
+
+			const float distance = speed * timing;
+
+			for (;;)
+			{
+				const float* a = pathPoints + segment * 3;
+				const float* b = a + 3;
+				const float dx = b[0] - a[0], dy = b[1] - a[1], dz = b[2] - a[2];
+				const float length = std::sqrt(dx * dx + dy * dy + dz * dz);
+
+				if (length > minSegmentLength)
+					facing = GetPathFacing(dx, dy);
+
+				const bool bLastSegment = segment + 2 == numPathPoints;
+
+				if (segmentStart + length < distance && !bLastSegment)
+				{
+					segmentStart += length;
+					++segment;
+					continue;
+				}
+
+				const float alpha = (length > minSegmentLength) ? std::fmin((distance - segmentStart) / length, 1.f) : 1.f;
+
+				position[0] = a[0] + dx * alpha;
+				position[1] = a[1] + dy * alpha;
+				position[2] = a[2] + dz * alpha;
+				break;
+			}
+
+			outFacings[i] = facing;
+		}
+	}
+
+	// Damping of a critically damped spring that halves its distance to the goal every halfLife seconds, halved.
+	static float GetSpringDecay(float halfLife)
+	{
+		return (4.f * 0.69314718f) / (halfLife + 1e-5f) / 2.f;
+	}
+
+	void SpringTrajectoryPredictor::Init(const float* timings, int32_t numTimings, float halfLife, float facingHalfLife)
+	{
+		Timings.assign(timings, timings + numTimings);
+		HalfLife = halfLife;
+		FacingHalfLife = facingHalfLife;
+
+		PositionVelocity.resize(numTimings);
+		PositionGoal.resize(numTimings);
+		PositionAcceleration.resize(numTimings);
+		FacingGoal.resize(numTimings);
+		FacingVelocity.resize(numTimings);
+
+		const float y = GetSpringDecay(halfLife);
+		const float fy = GetSpringDecay(facingHalfLife);
+
+		for (int32_t i = 0; i != numTimings; ++i)
+		{
+			const float t = timings[i];
+
+			if (t < 0.f)
+			{
+				PositionVelocity[i] = t;
+				PositionGoal[i] = 0.f;
+				PositionAcceleration[i] = 0.f;
+				FacingGoal[i] = 0.f;
+				FacingVelocity[i] = t;
+				continue;
+			}
+
+			// Velocity spring integrated from 0 (see spring_character_update), expanded in terms of the inputs:
+			//   x(t) = j0 (1 - e) / y + j1 ((1 - e) / y^2 - e t / y) + goal t,  j0 = v - goal, j1 = a + j0 y, e = exp(-y t)
+			const float e = std::exp(-y * t);
+			const float a = (1.f - e) / y;
+			const float b = (1.f - e) / (y * y) - e * t / y;
+
+			PositionVelocity[i] = a + y * b;
+			PositionGoal[i] = t - PositionVelocity[i];
+			PositionAcceleration[i] = b;
+
+			// Facing spring from 0 towards the desired facing, starting at the current turn speed:
+			//   f(t) = goal + e (j0 + j1 t),  j0 = -goal, j1 = turnSpeed + j0 y
+			const float fe = std::exp(-fy * t);
+
+			FacingGoal[i] = 1.f - fe - fe * t * fy;
+			FacingVelocity[i] = fe * t;
+		}
+	}
+
+	void SpringTrajectoryPredictor::Predict(const TrajectoryInput& input, float* outPositions, float* outFacings) const
+	{
+		PredictBatch(&input, 1, outPositions, outFacings);
+	}
+
+	void SpringTrajectoryPredictor::PredictBatch(const TrajectoryInput* inputs, int32_t numInputs, float* outPositions, float* outFacings) const
+	{
+		const int32_t numTimings = (int32_t)Timings.size();
+		const float* pv = PositionVelocity.data();
+		const float* pg = PositionGoal.data();
+		const float* pa = PositionAcceleration.data();
+		const float* fg = FacingGoal.data();
+		const float* fv = FacingVelocity.data();
+
+		for (int32_t c = 0; c != numInputs; ++c)
+		{
+			const TrajectoryInput& input = inputs[c];
+			float* positions = outPositions + c * numTimings * 3;
+			float* facings = outFacings + c * numTimings;
+
+			// Straight multiply-adds over the timings, which the compiler turns into vector code.
+			for (int32_t axis = 0; axis != 3; ++axis)
+			{
+				const float v = input.Velocity[axis];
+				const float g = input.DesiredVelocity[axis];
+				const float a = input.Acceleration[axis];
+
+				for (int32_t i = 0; i != numTimings; ++i)
+					positions[i * 3 + axis] = v * pv[i] + g * pg[i] + a * pa[i];
+			}
+
+			for (int32_t i = 0; i != numTimings; ++i)
+				facings[i] = input.DesiredFacing * fg[i] + input.TurnSpeed * fv[i];
+		}
+	}
+}
@@ -13,11 +13,20 @@ USkeleton* UMotionData::GetSkeleton(bool& bInvalidSkeletonIsError)
 	return TargetSkeleton;
 }
 
+void UMotionData::PostLoad()
+{
+	Super::PostLoad();
+
+	// Build now rather than when the first character spawns.
+	GetDatabase();
+}
+
 #if WITH_EDITOR
 void UMotionData::PreEditChange(FProperty* PropertyAboutToChange)
 {
 	//PropertyAboutToChange->GetNameCPP()
 	bOutdatedMotionCache = true;
+	InvalidateDatabase();
 }
 #endif
 
@@ -102,3 +111,19 @@ void FFeatureNormalData::SetDefaultValues()
 	StdInverse = 0.f;
 	UserWeight = 1.0f;
 }
+
+FMotionDatabasePtr UMotionData::GetDatabase()
+{
+	FScopeLock lock(&DatabaseLock);
+
+	if (!Database.IsValid())
+		Database = FMotionDatabase::Build(*this);
+
+	return Database;
+}
+
+void UMotionData::InvalidateDatabase()
+{
+	FScopeLock lock(&DatabaseLock);
+	Database.Reset();
+}
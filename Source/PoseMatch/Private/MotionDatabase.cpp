@@ -0,0 +1,347 @@
+// Copyright Wild Montage, LLC. All Rights Reserved.
+
+#include "MotionDatabase.h"
+#include "MotionData.h"
+#include "Animation/AnimSequence.h"
+#include "HAL/IConsoleManager.h"
+#include "MotionMatchingStats.h"
+#include "Core/MMCoreNormalization.h"
+#include "Core/MMCoreSearch.h"
+#include "Core/MMCoreContacts.h"
+
+static TAutoConsoleVariable<int32> CVarSearchBackend(
+	TEXT("mm.SearchBackend"),
+	(int32)MMCore::SearchBackend::Indexed,
+	TEXT("Pose search implementation. All of them pick the same pose.\n")
+	TEXT(" 0: Brute force\n")
+	TEXT(" 1: Brute force, four lanes\n")
+	TEXT(" 2: Pruned (early-out per pose)\n")
+	TEXT(" 3: Indexed (bounding boxes over blocks of poses, default)"),
+	ECVF_Default);
+
+TSharedRef<const FMotionDatabase, ESPMode::ThreadSafe> FMotionDatabase::Build(const UMotionData& motionData)
+{
+	TSharedRef<FMotionDatabase, ESPMode::ThreadSafe> db = MakeShared<FMotionDatabase, ESPMode::ThreadSafe>();
+
+	db->SourcePath = motionData.GetPathName();
+	db->SamplingRate = motionData.MotionCacheSamplingRate;
+	db->NaturalBias = motionData.NaturalBias;
+	db->LoopBias = motionData.LoopBias;
+
+	//
+	// Query normalization
+	//
+
+	auto makeNormal = [](const FFeatureNormalData& normalData, float weight) {
+		return MMCore::MakeFeatureNormal(normalData.Mean, normalData.StandardDeviation, normalData.UserWeight * weight);
+	};
+
+	db->RootVelocityNormal = makeNormal(motionData.NormalData_RootVelocity, motionData.RootVelocityWeight);
+
+	for (const FFeatureNormalData& normalData : motionData.NormalData_TrajectoryPosition)
+		db->TrajectoryPositionNormals.Add(makeNormal(normalData, 1.f));
+
+	for (const FFeatureNormalData& normalData : motionData.NormalData_TrajectoryFacing)
+		db->TrajectoryFacingNormals.Add(makeNormal(normalData, 1.f));
+
+	db->TrajectoryPositionNormals.SetNum(motionData.TrajectoryTimings.Num());
+	db->TrajectoryFacingNormals.SetNum(motionData.TrajectoryTimings.Num());
+
+	//
+	// Trajectory settings
+	//
+
+	db->TrajectoryTimings = motionData.TrajectoryTimings;
+
+	for (int32 i = 0; i != db->TrajectoryTimings.Num(); ++i)
+	{
+		if (db->TrajectoryTimings[i] < 0.f) continue;
+
+		db->FirstFutureTrajectoryTiming = i;
+		break;
+	}
+
+	if (db->TrajectoryTimings.Num() != 0)
+	{
+		db->LastTrajectoryTime = db->TrajectoryTimings.Last();
+
+		// The first element. We always assume these timings are sorted.
+		const float firstTiming = db->TrajectoryTimings[0];
+
+		if (firstTiming < 0.f)
+			db->HistoryCount = FMath::CeilToInt(FMath::Abs(firstTiming) / MOTION_MATCHING_RECORD_RATE) + 1;
+	}
+
+	//
+	// Feet
+	//
+
+	for (int32 i = 0; i != motionData.PoseMatchingBones.Num(); ++i)
+	{
+		const FName& boneName = motionData.PoseMatchingBones[i].BoneName;
+
+		if (boneName == NAME_None) continue;
+		if (boneName == motionData.LeftFoot.BoneName) db->FootBoneIndices[0] = i;
+		if (boneName == motionData.RightFoot.BoneName) db->FootBoneIndices[1] = i;
+	}
+
+	//
+	// Pose rows
+	//
+
+	FMMatcherFeatureLayout& L = db->Layout;
+	L.Init(motionData.PoseMatchingBones.Num(), motionData.TrajectoryTimings.Num());
+
+	int32 numRows = 0;
+	db->States.AddDefaulted(motionData.States.Num());
+
+	for (int32 stateIndex = 0; stateIndex != motionData.States.Num(); ++stateIndex)
+	{
+		const FMMatcherState& state = motionData.States[stateIndex];
+		FMotionDatabaseState& dbState = db->States[stateIndex];
+
+		dbState.FirstRow = numRows;
+		dbState.NumPoses = state.CachedPoses.Num();
+		dbState.PlayLength = state.Animation ? state.Animation->SequenceLength : 0.f;
+		dbState.bLoop = state.bLoop;
+		numRows += dbState.NumPoses;
+	}
+
+	db->Rows.AddZeroed(numRows * L.Stride);
+	db->Times.AddZeroed(numRows);
+
+	auto writeVec = [](float* dst, const FVector& v) { dst[0] = v.X; dst[1] = v.Y; dst[2] = v.Z; };
+
+	for (int32 stateIndex = 0; stateIndex != motionData.States.Num(); ++stateIndex)
+	{
+		const FMMatcherState& state = motionData.States[stateIndex];
+
+		for (int32 poseIndex = 0; poseIndex != state.CachedPoses.Num(); ++poseIndex)
+		{
+			const FMMatcherPoseSample& pose = state.CachedPoses[poseIndex];
+			float* row = db->Rows.GetData() + (db->States[stateIndex].FirstRow + poseIndex) * L.Stride;
+
+			db->Times[db->States[stateIndex].FirstRow + poseIndex] = pose.Time;
+
+			writeVec(row + L.RootVelocity, pose.RootVelocity);
+
+			for (int32 i = 0; i != L.NumBones && pose.BoneData.IsValidIndex(i); ++i)
+			{
+				writeVec(row + L.Bones + i * 6, pose.BoneData[i].Position);
+				writeVec(row + L.Bones + i * 6 + 3, pose.BoneData[i].Velocity);
+			}
+
+			for (int32 i = 0; i != L.NumTrajectoryPoints && pose.Trajectory.IsValidIndex(i); ++i)
+			{
+				const FTrajectoryPoint& point = pose.Trajectory[i];
+
+				// Facing has to go back to degrees before we can turn it into a sin/cos pair.
+				const float facingRad = FMath::DegreesToRadians(db->TrajectoryFacingNormals[i].Unnormalize(point.Facing));
+
+				writeVec(row + L.TrajectoryPosition + i * 3, point.Position);
+				row[L.TrajectoryFacing + i] = point.Facing;
+				FMath::SinCos(row + L.TrajectoryFacingSinCos + i * 2, row + L.TrajectoryFacingSinCos + i * 2 + 1, facingRad);
+			}
+
+			row[L.RootRotationSpeed] = pose.RootRotationSpeed;
+			writeVec(row + L.FacingAxis, pose.FacingAxis);
+		}
+	}
+
+	//
+	// Foot contacts
+	//
+
+	db->FootContacts.AddZeroed((numRows * 2 + 31) / 32);
+
+	for (int32 stateIndex = 0; stateIndex != motionData.States.Num(); ++stateIndex)
+	{
+		const FMMatcherState& state = motionData.States[stateIndex];
+		const int32 firstBit = db->States[stateIndex].FirstRow * 2;
+		const bool bBaked = state.FootContacts.Num() * 16 >= state.CachedPoses.Num();
+
+		for (int32 poseIndex = 0; poseIndex != state.CachedPoses.Num(); ++poseIndex)
+		{
+			uint32 contacts;
+
+			if (bBaked)
+			{
+				contacts = (state.FootContacts[poseIndex >> 4] >> ((poseIndex & 15) * 2)) & 3;
+			}
+			else
+			{
+				// Older cache, one array per pose.
+				const TArray<uint8>& footLocks = state.CachedPoses[poseIndex].FootLocks_DEPRECATED;
+				contacts = (footLocks.Num() == 2) ? (footLocks[0] ? 1 : 0) | (footLocks[1] ? 2 : 0) : 3;
+			}
+
+			const int32 bit = firstBit + poseIndex * 2;
+			db->FootContacts[bit >> 5] |= contacts << (bit & 31);
+		}
+	}
+
+	db->SearchIndex.Build(db->GetView());
+
+	return db;
+}
+
+MMCore::DatabaseView FMotionDatabase::GetView() const
+{
+	MMCore::DatabaseView view;
+	view.Layout = &Layout;
+	view.Rows = Rows.GetData();
+	view.States = States.GetData();
+	view.NumStates = States.Num();
+	view.Biases.NaturalBias = NaturalBias;
+	view.Biases.LoopBias = LoopBias;
+	return view;
+}
+
+void FMotionDatabase::BuildQuery(const float* poseRow, const FVector& rootVelocity, const FVector* trajectoryPositions, const float* trajectoryFacings, float* outQuery) const
+{
+	static_assert(sizeof(FVector) == sizeof(float) * 3, "The core reads vectors as packed xyz floats.");
+
+	MMCore::BuildQuery(Layout, RootVelocityNormal, TrajectoryPositionNormals.GetData(), TrajectoryFacingNormals.GetData(),
+		poseRow, &rootVelocity.X, &trajectoryPositions[0].X, trajectoryFacings, outQuery);
+}
+
+FMotionSearchResult FMotionDatabase::Search(const float* query, const FMotionSearchParams& params, MMCore::SearchStats* stats) const
+{
+	MM_SCOPE_CYCLE_COUNTER(STAT_MMIndexSearch);
+
+#if STATS
+	MMCore::SearchStats localStats;
+	MMCore::SearchStats& searchStats = stats ? *stats : localStats;
+	const int64 scannedBefore = searchStats.PosesScanned;
+	const int64 prunedBefore = searchStats.PosesPruned;
+
+	const FMotionSearchResult result = MMCore::Search(GetSearchBackend(), GetView(), &SearchIndex, query, params, &searchStats);
+
+	INC_DWORD_STAT(STAT_MMSearches);
+	INC_DWORD_STAT_BY(STAT_MMPosesScanned, (uint32)(searchStats.PosesScanned - scannedBefore));
+	INC_DWORD_STAT_BY(STAT_MMPosesPruned, (uint32)(searchStats.PosesPruned - prunedBefore));
+
+	return result;
+#else
+	return MMCore::Search(GetSearchBackend(), GetView(), &SearchIndex, query, params, stats);
+#endif
+}
+
+float FMotionDatabase::AdvanceTime(int32 stateIndex, float time, float deltaTime) const
+{
+	const FMotionDatabaseState& state = States[stateIndex];
+
+	time += deltaTime;
+
+	if (time >= state.PlayLength)
+		time = (state.bLoop && state.PlayLength > 0.f) ? FMath::Fmod(time, state.PlayLength) : state.PlayLength;
+
+	return time;
+}
+
+FMotionSearchParams FMotionDatabase::MakeSearchParams(int32 stateIndex, float time, float steadyBias, bool bLoopsOnly, float tolerance) const
+{
+	const FMotionDatabaseState& state = States[stateIndex];
+
+	FMotionSearchParams params;
+	params.CurrentState = stateIndex;
+	params.CurrentPose = GetPoseIndex(stateIndex, time);
+	params.SteadyBias = steadyBias;
+	params.bLoopsOnly = IsEnding(stateIndex, time) || bLoopsOnly;
+	params.Tolerance = tolerance;
+	return params;
+}
+
+bool FMotionDatabase::IsEnding(int32 stateIndex, float time) const
+{
+	const FMotionDatabaseState& state = States[stateIndex];
+	return !state.bLoop && state.PlayLength - time < MOTION_MATCHING_BLEND_TIME;
+}
+
+float FMotionDatabase::GetTrajectoryDivergence(const float* poseRow, const FVector* trajectoryPositions, const float* trajectoryFacings) const
+{
+	const int32 first = FirstFutureTrajectoryTiming;
+	const int32 numTimings = TrajectoryTimings.Num();
+
+	if (numTimings <= first) return 0.f;
+
+	float divergence = 0.f;
+
+	for (int32 i = first; i != numTimings; ++i)
+	{
+		const float* position = poseRow + Layout.TrajectoryPosition + i * 3;
+		const FMotionFeatureNormal& positionNormal = TrajectoryPositionNormals[i];
+
+		for (int32 axis = 0; axis != 3; ++axis)
+			divergence += FMath::Square(position[axis] - positionNormal.Normalize(trajectoryPositions[i][axis]));
+
+		divergence += FMath::Square(poseRow[Layout.TrajectoryFacing + i] - TrajectoryFacingNormals[i].Normalize(trajectoryFacings[i]));
+	}
+
+	return divergence / (numTimings - first);
+}
+
+FMotionSearchResult FMotionDatabase::SearchFromPlayback(const FMotionSearchParams& params, const FVector& rootVelocity, const FVector* trajectoryPositions, const float* trajectoryFacings, MMCore::SearchStats* stats) const
+{
+	TArray<float, TInlineAllocator<256>> query;
+	query.SetNumUninitialized(Layout.SearchDims);
+	BuildQuery(GetRow(params.CurrentState, params.CurrentPose), rootVelocity, trajectoryPositions, trajectoryFacings, query.GetData());
+
+	return Search(query.GetData(), params, stats);
+}
+
+bool FMotionDatabase::ShouldTransition(const FMotionSearchResult& best, int32 stateIndex, float time, int32 matchedPoseIndex, float timeSinceTransition) const
+{
+	if (!best.IsValid() || timeSinceTransition <= MOTION_MATCHING_MIN_TRANSITION_TIME)
+		return false;
+
+	if (best.StateIndex != stateIndex)
+		return true;
+
+	const bool bLooping = States[stateIndex].bLoop;
+	const bool bWinnerAtSameLocation = FMath::Abs(time - GetTime(best.StateIndex, best.PoseIndex)) < 1.0f || best.PoseIndex == matchedPoseIndex;
+
+	return !bLooping && !bWinnerAtSameLocation;
+}
+
+float FMotionDatabase::GetSteadyBias(const FVector& desiredVector, const FVector& steadyInput, float desiredFacing)
+{
+	const float inputSteadiness = FVector::DistSquared(desiredVector, steadyInput);
+	const float facingSteadiness = FMath::Abs(desiredFacing) * 0.02f;
+	return 1.0f - FMath::Clamp(inputSteadiness + facingSteadiness, 0.f, 1.0f);
+}
+
+MMCore::SearchBackend FMotionDatabase::GetSearchBackend()
+{
+	const int32 backend = CVarSearchBackend.GetValueOnAnyThread();
+	return (backend >= 0 && backend < (int32)MMCore::SearchBackend::Count) ? (MMCore::SearchBackend)backend : MMCore::SearchBackend::BruteForce;
+}
+
+void FMotionDatabase::NormalizeFeature(float* rows, int32 numRows, int32 stride, int32 column, int32 width, float weight, FFeatureNormalData& outNormalData)
+{
+	const MMCore::FeatureStats stats = MMCore::ComputeFeatureStats(rows, numRows, stride, column, width);
+
+	outNormalData.Count = (float)stats.Count;
+	outNormalData.Sum = (float)(stats.Mean * stats.Count);
+	outNormalData.Mean = (float)stats.Mean;
+	outNormalData.Variance = (float)stats.Variance;
+	outNormalData.StandardDeviation = (float)stats.StandardDeviation;
+	outNormalData.StdInverse = (float)(1.0 / stats.StandardDeviation);
+	outNormalData.UserWeight = weight;
+
+	MMCore::NormalizeColumns(rows, numRows, stride, column, width, MMCore::MakeFeatureNormal(stats.Mean, stats.StandardDeviation, weight));
+}
+
+void FMotionDatabase::DetectFootContacts(const TArray<FVector>& footTrack, float keyInterval, const MMCore::ContactParams& params, TArray<uint8>& outContacts)
+{
+	outContacts.SetNumUninitialized(footTrack.Num());
+	MMCore::DetectContacts(&footTrack.GetData()->X, footTrack.Num(), keyInterval, params, outContacts.GetData());
+}
+
+SIZE_T FMotionDatabase::GetAllocatedSize() const
+{
+	return sizeof(*this) + Rows.GetAllocatedSize() + Times.GetAllocatedSize() + States.GetAllocatedSize() + TrajectoryTimings.GetAllocatedSize()
+		+ FootContacts.GetAllocatedSize()
+		+ TrajectoryPositionNormals.GetAllocatedSize() + TrajectoryFacingNormals.GetAllocatedSize()
+		+ (SearchIndex.Mins.capacity() + SearchIndex.Maxs.capacity()) * sizeof(float) + SearchIndex.Blocks.capacity() * sizeof(MMCore::SearchIndex::Block);
+}
@@ -0,0 +1,313 @@
+#include "MotionMatcherCrowdComponent.h"
+
+#include "Async/ParallelFor.h"
+#include "Animation/AnimSequence.h"
+#include "Core/MMCoreTrajectory.h"
+#include "Misc/App.h"
+#include "MotionMatchingStats.h"
+
+UMotionMatcherCrowdComponent::UMotionMatcherCrowdComponent(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	PrimaryComponentTick.TickGroup = TG_PrePhysics;
+	PrimaryComponentTick.bCanEverTick = true;
+
+	bAutoActivate = true;
+}
+
+void UMotionMatcherCrowdComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	database.Reset();
+	budget = GetWorld() ? GetWorld()->GetSubsystem<UMotionMatchingBudgetSubsystem>() : nullptr;
+
+	if (MotionDataAsset)
+		database = MotionDataAsset->GetDatabase();
+
+	if (!database.IsValid() || !database->HasPoses())
+	{
+		database.Reset();
+		UE_LOG(LogTemp, Warning, TEXT("Motion matcher crowd %s has no usable motion data."), *GetPathName());
+	}
+}
+
+void UMotionMatcherCrowdComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	float stepTime;
+	const int32 numSteps = fixedStep.Advance(DeltaTime, FMotionMatchingFixedStep::GetTimeStep(FixedTimeStep), MaxFixedSteps, stepTime);
+
+	if (budget && database.IsValid())
+		budget->ReportActive(GetNumAgents());
+
+	for (int32 step = 0; step != numSteps; ++step)
+		StepCrowd(stepTime);
+}
+
+int32 UMotionMatcherCrowdComponent::AddAgent(const FTransform& Transform)
+{
+	int32 agent;
+
+	if (freeAgents.Num() != 0)
+	{
+		agent = freeAgents.Pop(false);
+	}
+	else
+	{
+		agent = agentActive.Add(false);
+		positions.AddUninitialized();
+		yaws.AddUninitialized();
+		velocities.AddUninitialized();
+		desiredVectors.AddUninitialized();
+		steadyInputs.AddUninitialized();
+		desiredFacings.AddUninitialized();
+		turnSpeeds.AddUninitialized();
+		pathPoints.AddDefaulted();
+		pathSpeeds.AddUninitialized();
+		paths.AddDefaulted();
+		stateIndices.AddUninitialized();
+		playTimes.AddUninitialized();
+		timeSinceMatch.AddUninitialized();
+		matchedPoses.AddUninitialized();
+		timeSinceTransition.AddUninitialized();
+	}
+
+	agentActive[agent] = true;
+	positions[agent] = Transform.GetLocation();
+	yaws[agent] = Transform.Rotator().Yaw;
+	velocities[agent] = FVector::ZeroVector;
+	desiredVectors[agent] = FVector::ZeroVector;
+	steadyInputs[agent] = FVector::ZeroVector;
+	desiredFacings[agent] = 0.f;
+	turnSpeeds[agent] = 0.f;
+	pathPoints[agent].Reset();
+	pathSpeeds[agent] = 0.f;
+	paths[agent].Reset();
+	stateIndices[agent] = 0;
+	playTimes[agent] = 0.f;
+	timeSinceMatch[agent] = MOTION_MATCHING_INTERVAL; // Match on the first step.
+	matchedPoses[agent] = 0;
+	timeSinceTransition[agent] = MOTION_MATCHING_MIN_TRANSITION_TIME;
+
+	return agent;
+}
+
+void UMotionMatcherCrowdComponent::RemoveAgent(int32 Agent)
+{
+	if (!agentActive.IsValidIndex(Agent) || !agentActive[Agent]) return;
+
+	agentActive[Agent] = false;
+	freeAgents.Add(Agent);
+}
+
+void UMotionMatcherCrowdComponent::SetAgentInput(int32 Agent, const FMMatcherInput& AgentInput)
+{
+	if (!agentActive.IsValidIndex(Agent)) return;
+
+	desiredVectors[Agent] = AgentInput.DesiredVector;
+	desiredFacings[Agent] = AgentInput.DesiredFacing;
+	pathPoints[Agent] = AgentInput.PathPoints;
+	pathSpeeds[Agent] = AgentInput.PathSpeed;
+}
+
+FTransform UMotionMatcherCrowdComponent::GetAgentTransform(int32 Agent) const
+{
+	if (!agentActive.IsValidIndex(Agent)) return FTransform::Identity;
+
+	return FTransform(FRotator(0.f, yaws[Agent], 0.f), positions[Agent]);
+}
+
+void UMotionMatcherCrowdComponent::GetAgentPlayback(int32 Agent, UAnimSequence*& Animation, float& Time) const
+{
+	Animation = nullptr;
+	Time = 0.f;
+
+	if (!agentActive.IsValidIndex(Agent) || !MotionDataAsset || !MotionDataAsset->States.IsValidIndex(stateIndices[Agent])) return;
+
+	Animation = MotionDataAsset->States[stateIndices[Agent]].Animation;
+
+	// The last step plus the time not simulated yet.
+	Time = database.IsValid() ? database->AdvanceTime(stateIndices[Agent], playTimes[Agent], fixedStep.Accumulator) : playTimes[Agent];
+}
+
+int32 UMotionMatcherCrowdComponent::GetNumAgents() const
+{
+	return agentActive.Num() - freeAgents.Num();
+}
+
+void UMotionMatcherCrowdComponent::StepCrowd(float deltaTime)
+{
+	if (!database.IsValid() || deltaTime <= 0.f) return;
+
+	MM_SCOPE_CYCLE_COUNTER(STAT_MMCrowdStep);
+
+	const int32 numTimings = database->TrajectoryTimings.Num();
+
+	if (TrajectoryHalfLife > 0.f && (trajectoryPredictor.GetHalfLife() != TrajectoryHalfLife || trajectoryPredictor.GetNumTimings() != numTimings))
+		trajectoryPredictor.Init(database->TrajectoryTimings.GetData(), numTimings, TrajectoryHalfLife, TrajectoryHalfLife);
+
+	const int32 numAgents = agentActive.Num();
+	const int32 agentsPerTask = FMath::Max(MinAgentsPerTask, 1);
+	const int32 numTasks = FMath::DivideAndRoundUp(numAgents, agentsPerTask);
+
+	ParallelFor(numTasks, [this, deltaTime, numAgents, numTimings, agentsPerTask](int32 task) {
+		const int32 last = FMath::Min((task + 1) * agentsPerTask, numAgents);
+
+		// Agents of this task that search this step.
+		TArray<int32, TInlineAllocator<64>> searching;
+		TArray<FMotionMatchingBudgetDecision, TInlineAllocator<64>> decisions;
+		TArray<MMCore::TrajectoryInput, TInlineAllocator<64>> inputs;
+
+		for (int32 agent = task * agentsPerTask; agent != last; ++agent)
+		{
+			FMotionMatchingBudgetDecision budgetDecision;
+
+			if (!StepAgent(agent, deltaTime, budgetDecision)) continue;
+
+			searching.Add(agent);
+			decisions.Add(budgetDecision);
+			inputs.Add(GetTrajectoryInput(agent));
+		}
+
+		if (searching.Num() == 0) return;
+
+		// Predict every searching agent's trajectory in one pass.
+		TArray<FVector, TInlineAllocator<256>> trajectoryPositions;
+		TArray<float, TInlineAllocator<256>> trajectoryFacings;
+		trajectoryPositions.SetNumUninitialized(searching.Num() * numTimings);
+		trajectoryFacings.SetNumUninitialized(searching.Num() * numTimings);
+
+		if (TrajectoryHalfLife > 0.f)
+		{
+			trajectoryPredictor.PredictBatch(inputs.GetData(), inputs.Num(), &trajectoryPositions.GetData()->X, trajectoryFacings.GetData());
+		}
+		else
+		{
+			for (int32 i = 0; i != searching.Num(); ++i)
+				MMCore::PredictTrajectory(database->TrajectoryTimings.GetData(), numTimings, inputs[i], &trajectoryPositions[i * numTimings].X, &trajectoryFacings[i * numTimings]);
+		}
+
+		// Agents following a path sample it instead.
+		for (int32 i = 0; i != searching.Num(); ++i)
+		{
+			const FMotionMatchingPath& path = paths[searching[i]];
+
+			if (path.IsValid())
+				path.Sample(database->TrajectoryTimings.GetData(), numTimings, inputs[i], &trajectoryPositions[i * numTimings], &trajectoryFacings[i * numTimings]);
+		}
+
+		for (int32 i = 0; i != searching.Num(); ++i)
+			MatchAgent(searching[i], decisions[i], &trajectoryPositions[i * numTimings], &trajectoryFacings[i * numTimings]);
+	});
+}
+
+bool UMotionMatcherCrowdComponent::StepAgent(int32 agent, float deltaTime, FMotionMatchingBudgetDecision& outBudgetDecision)
+{
+	if (!agentActive[agent]) return false;
+
+	const FMotionDatabase& db = *database;
+
+	// Following a path: it decides the input too, like it does for the anim node.
+	if (pathPoints[agent].Num() != 0 && db.TrajectoryTimings.IsValidIndex(db.FirstFutureTrajectoryTiming))
+	{
+		const float maxSpeed = SpeedMultiplier * 120;
+
+		paths[agent].Set(pathPoints[agent], (pathSpeeds[agent] > 0.f) ? pathSpeeds[agent] : maxSpeed, positions[agent], yaws[agent] - 90.f);
+		paths[agent].GetInput(db.TrajectoryTimings[db.FirstFutureTrajectoryTiming], db.LastTrajectoryTime, maxSpeed, GetTrajectoryInput(agent), desiredVectors[agent], desiredFacings[agent]);
+	}
+	else
+	{
+		paths[agent].Reset();
+	}
+
+	//
+	// Movement. Stands in for the character movement component the anim node would rely on.
+	//
+
+	const FVector inputVector = desiredVectors[agent];
+	const FVector targetVelocity = inputVector * (SpeedMultiplier * 120);
+
+	FVector& velocity = velocities[agent];
+	velocity = FMath::VInterpTo(velocity, targetVelocity, deltaTime, Acceleration);
+
+	float& turnSpeed = turnSpeeds[agent];
+	turnSpeed = (db.LastTrajectoryTime > 0.f) ? desiredFacings[agent] / db.LastTrajectoryTime : 0.f;
+
+	yaws[agent] = FRotator::NormalizeAxis(yaws[agent] + turnSpeed * deltaTime);
+
+	// The trajectory space is the mesh space, rotated -90 from the actor like the usual character setup.
+	positions[agent] += velocity.RotateAngleAxis(yaws[agent] - 90.f, FVector::UpVector) * deltaTime;
+
+	// Steady bias input, same as the anim node.
+	steadyInputs[agent] = FMath::VInterpTo(steadyInputs[agent], inputVector, deltaTime, 0.4f);
+
+	// Playback moves with the simulation, so the searches don't depend on the frame rate.
+	playTimes[agent] = db.AdvanceTime(stateIndices[agent], playTimes[agent], deltaTime);
+
+	const FMotionDatabaseState* state = &db.States[stateIndices[agent]];
+
+	timeSinceMatch[agent] += deltaTime;
+	timeSinceTransition[agent] += deltaTime;
+
+	// Throttling depends on measured cost, which would make fixed step searches irreproducible.
+	if (budget && FMotionMatchingFixedStep::GetTimeStep(FixedTimeStep) <= 0.f)
+		outBudgetDecision = budget->GetDecision(positions[agent]);
+
+	if (timeSinceMatch[agent] < MOTION_MATCHING_INTERVAL * outBudgetDecision.IntervalScale || state->NumPoses == 0)
+	{
+		INC_DWORD_STAT(STAT_MMSearchesSkipped);
+		return false;
+	}
+
+	timeSinceMatch[agent] = 0.f;
+	return true;
+}
+
+MMCore::TrajectoryInput UMotionMatcherCrowdComponent::GetTrajectoryInput(int32 agent) const
+{
+	// No recorded history here, the past is extrapolated from the current velocity.
+	const FVector targetVelocity = desiredVectors[agent] * (SpeedMultiplier * 120);
+
+	MMCore::TrajectoryInput trajectoryInput;
+	FMemory::Memcpy(trajectoryInput.Velocity, &velocities[agent].X, sizeof(trajectoryInput.Velocity));
+	FMemory::Memcpy(trajectoryInput.DesiredVelocity, &targetVelocity.X, sizeof(trajectoryInput.DesiredVelocity));
+	trajectoryInput.TurnSpeed = turnSpeeds[agent];
+	trajectoryInput.DesiredFacing = desiredFacings[agent];
+
+	return trajectoryInput;
+}
+
+void UMotionMatcherCrowdComponent::MatchAgent(int32 agent, const FMotionMatchingBudgetDecision& budgetDecision, const FVector* trajectoryPositions, const float* trajectoryFacings)
+{
+	const FMotionDatabase& db = *database;
+
+	int32& stateIndex = stateIndices[agent];
+	float& playTime = playTimes[agent];
+
+	const float steadyBias = FMotionDatabase::GetSteadyBias(desiredVectors[agent], steadyInputs[agent], desiredFacings[agent]);
+
+	//
+	// Search
+	//
+
+	const FMotionSearchParams searchParams = db.MakeSearchParams(stateIndex, playTime, steadyBias, budgetDecision.bLoopsOnly, budgetDecision.SearchTolerance);
+
+	const uint64 searchStart = FPlatformTime::Cycles64();
+	const FMotionSearchResult best = db.SearchFromPlayback(searchParams, velocities[agent], trajectoryPositions, trajectoryFacings);
+
+	if (budget)
+		budget->ReportSearch(FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - searchStart) * 1000.0);
+
+	if (db.ShouldTransition(best, stateIndex, playTime, matchedPoses[agent], timeSinceTransition[agent]))
+	{
+		stateIndex = best.StateIndex;
+		playTime = db.GetTime(best.StateIndex, best.PoseIndex);
+		matchedPoses[agent] = best.PoseIndex;
+		timeSinceTransition[agent] = 0.f;
+
+		INC_DWORD_STAT(STAT_MMTransitions);
+		INC_FLOAT_STAT_BY(STAT_MMTransitionsPerSecond, 1.f / FMath::Max((float)FApp::GetDeltaTime(), KINDA_SMALL_NUMBER));
+	}
+}
@@ -0,0 +1,278 @@
+// Copyright Wild Montage, LLC. All Rights Reserved.
+
+#include "MotionMatcherHeadlessComponent.h"
+
+#include "Components/SkeletalMeshComponent.h"
+#include "Core/MMCoreTrajectory.h"
+#include "GameFramework/Character.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "Misc/App.h"
+#include "MotionMatchingStats.h"
+
+UMotionMatcherHeadlessComponent::UMotionMatcherHeadlessComponent(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	PrimaryComponentTick.TickGroup = TG_PrePhysics;
+	PrimaryComponentTick.bCanEverTick = true;
+
+	bAutoActivate = true;
+}
+
+void UMotionMatcherHeadlessComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	bRunning = false;
+	database.Reset();
+	character = Cast<ACharacter>(GetOwner());
+	moveComp = character ? character->GetCharacterMovement() : nullptr;
+
+	if (bDedicatedServerOnly && GetNetMode() != NM_DedicatedServer)
+	{
+		SetComponentTickEnabled(false);
+		return;
+	}
+
+	if (MotionDataAsset)
+		database = MotionDataAsset->GetDatabase();
+
+	if (!database.IsValid() || !database->HasPoses() || !moveComp)
+	{
+		database.Reset();
+		SetComponentTickEnabled(false);
+		UE_LOG(LogTemp, Warning, TEXT("Headless motion matcher %s needs a character with a movement component and usable motion data."), *GetPathName());
+		return;
+	}
+
+	budget = GetWorld() ? GetWorld()->GetSubsystem<UMotionMatchingBudgetSubsystem>() : nullptr;
+
+	// Same as the anim node: the root motion of this frame's movement is what we computed after the previous one.
+	AddTickPrerequisiteComponent(moveComp);
+	rootMotionSourceID = FMotionMatchingRootMotion::AddSource(*moveComp);
+
+	if (USkeletalMeshComponent* mesh = character->GetMesh())
+	{
+		meshYaw = mesh->GetRelativeRotation().Yaw;
+
+		if (bDisableMeshAnimation)
+			mesh->VisibilityBasedAnimTickOption = EVisibilityBasedAnimTickOption::OnlyTickMontagesWhenNotRendered;
+	}
+
+	stateIndex = 0;
+	playTime = 0.f;
+	matchedPoseIndex = 0;
+	timeSinceLastMatch = MOTION_MATCHING_INTERVAL; // Match on the first step.
+	searchSchedule = FMotionMatchingSearchSchedule();
+	timeSinceTransition = MOTION_MATCHING_MIN_TRANSITION_TIME;
+	lastYaw = character->GetActorRotation().Yaw;
+	lastStepYaw = lastYaw;
+	bRunning = true;
+}
+
+void UMotionMatcherHeadlessComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	if (!bRunning) return;
+
+	MM_SCOPE_CYCLE_COUNTER(STAT_MMUpdate);
+
+	float stepTime;
+	const int32 numSteps = fixedStep.Advance(DeltaTime, FMotionMatchingFixedStep::GetTimeStep(FixedTimeStep), MaxFixedSteps, stepTime);
+
+	// Turn speed is measured between steps, like the anim node does.
+	const float yaw = character->GetActorRotation().Yaw;
+
+	if (numSteps != 0 && stepTime > 0.f)
+	{
+		turnSpeed = FRotator::NormalizeAxis(yaw - lastStepYaw) / (numSteps * stepTime);
+		lastStepYaw = yaw;
+	}
+
+	lastYaw = yaw;
+
+	// This tick's input. Input itself is left as it was set.
+	desiredVector = Input.DesiredVector;
+	desiredFacing = Input.DesiredFacing;
+
+	if (bInputFromAcceleration)
+	{
+		const FVector acceleration = moveComp->GetCurrentAcceleration();
+		const float maxAcceleration = moveComp->GetMaxAcceleration();
+
+		// The input is in mesh space. See FMotionMatchingRootMotion::Update().
+		desiredVector = (maxAcceleration > 0.f) ? (acceleration / maxAcceleration).GetClampedToMaxSize(1.f) : FVector::ZeroVector;
+		desiredVector = desiredVector.RotateAngleAxis(-(yaw + meshYaw), FVector::UpVector);
+	}
+
+	// Following a path: it decides the input too, like it does for the anim node.
+	if (Input.PathPoints.Num() != 0 && database->TrajectoryTimings.IsValidIndex(database->FirstFutureTrajectoryTiming))
+	{
+		const float maxSpeed = SpeedMultiplier * 120;
+		const FVector velocity = character->GetVelocity().RotateAngleAxis(-(yaw + meshYaw), FVector::UpVector);
+
+		MMCore::TrajectoryInput trajectoryInput;
+		FMemory::Memcpy(trajectoryInput.Velocity, &velocity.X, sizeof(trajectoryInput.Velocity));
+		trajectoryInput.TurnSpeed = turnSpeed;
+
+		path.Set(Input.PathPoints, (Input.PathSpeed > 0.f) ? Input.PathSpeed : maxSpeed, character->GetActorLocation(), yaw + meshYaw);
+		path.GetInput(database->TrajectoryTimings[database->FirstFutureTrajectoryTiming], database->LastTrajectoryTime, maxSpeed, trajectoryInput, desiredVector, desiredFacing);
+	}
+	else
+	{
+		path.Reset();
+	}
+
+	budgetDecision = FMotionMatchingBudgetDecision();
+
+	if (budget)
+	{
+		budget->ReportActive();
+
+		// Throttling depends on measured cost, which would make fixed step searches irreproducible.
+		if (FMotionMatchingFixedStep::GetTimeStep(FixedTimeStep) <= 0.f)
+			budgetDecision = budget->GetDecision(character->GetActorLocation());
+	}
+
+	for (int32 step = 0; step != numSteps; ++step)
+		Step(stepTime);
+
+	// Hand the root motion to the movement component.
+	TSharedPtr<FRootMotionSource> RMS = moveComp->GetRootMotionSourceByID(rootMotionSourceID);
+
+	if (RMS.IsValid() && RMS->GetScriptStruct() == FRootMotionSource_Custom::StaticStruct())
+		static_cast<FRootMotionSource_Custom*>(RMS.Get())->RootMotion = rootMotionSpring.GetTransform();
+}
+
+void UMotionMatcherHeadlessComponent::SetInput(const FMMatcherInput& NewInput)
+{
+	Input = NewInput;
+}
+
+void UMotionMatcherHeadlessComponent::GetPlayback(int32& StateIndex, float& Time) const
+{
+	StateIndex = stateIndex;
+
+	// Like the anim node shows it: the last step plus the time not simulated yet.
+	Time = database.IsValid() ? database->AdvanceTime(stateIndex, playTime, fixedStep.Accumulator * timeScaleWarp) : playTime;
+}
+
+void UMotionMatcherHeadlessComponent::Step(float deltaTime)
+{
+	if (deltaTime <= 0.f) return;
+
+	const FMotionDatabase& db = *database;
+	const int32 numTimings = db.TrajectoryTimings.Num();
+	const float actorYaw = lastYaw + meshYaw;
+
+	// Smooth the input, same as the anim node.
+	desiredVecA = FMath::VInterpTo(desiredVecA, desiredVector * (SpeedMultiplier * 120), deltaTime, 12.f);
+	inputSteady = FMath::VInterpTo(inputSteady, desiredVector, deltaTime, 0.4f);
+
+	const float steadyBias = FMotionDatabase::GetSteadyBias(desiredVector, inputSteady, desiredFacing);
+
+	// Playback moves with the simulation, so the searches don't depend on the frame rate.
+	playTime = db.AdvanceTime(stateIndex, playTime, deltaTime * timeScaleWarp);
+
+	const FMotionDatabaseState* state = &db.States[stateIndex];
+
+	timeSinceLastMatch += deltaTime;
+	timeSinceTransition += deltaTime;
+
+	//
+	// Desired trajectory. Like the crowd, the past is extrapolated from the current velocity instead of recorded.
+	//
+
+	const FVector velocity = character->GetVelocity().RotateAngleAxis(-actorYaw, FVector::UpVector);
+
+	MMCore::TrajectoryInput trajectoryInput;
+	FMemory::Memcpy(trajectoryInput.Velocity, &velocity.X, sizeof(trajectoryInput.Velocity));
+	FMemory::Memcpy(trajectoryInput.DesiredVelocity, &desiredVecA.X, sizeof(trajectoryInput.DesiredVelocity));
+	trajectoryInput.TurnSpeed = turnSpeed;
+	trajectoryInput.DesiredFacing = desiredFacing;
+
+	TArray<FVector, TInlineAllocator<16>> trajectoryPositions;
+	TArray<float, TInlineAllocator<16>> trajectoryFacings;
+	trajectoryPositions.SetNumUninitialized(numTimings);
+	trajectoryFacings.SetNumUninitialized(numTimings);
+
+	if (path.IsValid())
+	{
+		path.Sample(db.TrajectoryTimings.GetData(), numTimings, trajectoryInput, trajectoryPositions.GetData(), trajectoryFacings.GetData());
+	}
+	else if (TrajectoryHalfLife > 0.f)
+	{
+		if (trajectoryPredictor.GetHalfLife() != TrajectoryHalfLife || trajectoryPredictor.GetNumTimings() != numTimings)
+			trajectoryPredictor.Init(db.TrajectoryTimings.GetData(), numTimings, TrajectoryHalfLife, TrajectoryHalfLife);
+
+		trajectoryPredictor.Predict(trajectoryInput, &trajectoryPositions.GetData()->X, trajectoryFacings.GetData());
+	}
+	else
+	{
+		MMCore::PredictTrajectory(db.TrajectoryTimings.GetData(), numTimings, trajectoryInput, &trajectoryPositions.GetData()->X, trajectoryFacings.GetData());
+	}
+
+	//
+	// Search
+	//
+
+	int32 poseIndex = db.GetPoseIndex(stateIndex, playTime);
+
+	// Same schedule as the anim node, with the playing pose's baked trajectory standing in for the evaluated one.
+	const float divergence = (TrajectoryChangeThreshold > 0.f && state->NumPoses != 0)
+		? db.GetTrajectoryDivergence(db.GetRow(stateIndex, poseIndex), trajectoryPositions.GetData(), trajectoryFacings.GetData()) : 0.f;
+
+	if (state->NumPoses != 0 && searchSchedule.ShouldSearch(timeSinceLastMatch, budgetDecision.IntervalScale, TrajectoryChangeThreshold, MaxSearchInterval, divergence, db.IsEnding(stateIndex, playTime)))
+	{
+		timeSinceLastMatch = 0.f;
+
+		const FMotionSearchParams searchParams = db.MakeSearchParams(stateIndex, playTime, steadyBias, budgetDecision.bLoopsOnly, budgetDecision.SearchTolerance);
+
+		const uint64 searchStart = FPlatformTime::Cycles64();
+		const FMotionSearchResult best = db.SearchFromPlayback(searchParams, velocity, trajectoryPositions.GetData(), trajectoryFacings.GetData());
+
+		if (budget)
+			budget->ReportSearch(FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - searchStart) * 1000.0);
+
+		if (db.ShouldTransition(best, stateIndex, playTime, matchedPoseIndex, timeSinceTransition))
+		{
+			stateIndex = best.StateIndex;
+			playTime = db.GetTime(best.StateIndex, best.PoseIndex);
+			poseIndex = best.PoseIndex;
+			matchedPoseIndex = best.PoseIndex;
+			timeSinceTransition = 0.f;
+			state = &db.States[stateIndex];
+
+			INC_DWORD_STAT(STAT_MMTransitions);
+			INC_FLOAT_STAT_BY(STAT_MMTransitionsPerSecond, 1.f / FMath::Max((float)FApp::GetDeltaTime(), KINDA_SMALL_NUMBER));
+		}
+	}
+	else
+	{
+		INC_DWORD_STAT(STAT_MMSearchesSkipped);
+	}
+
+	//
+	// Time warp, from the playing pose's baked trajectory instead of an evaluated pose.
+	//
+
+	if (desiredVector.SizeSquared() > 0.1f && numTimings != 0 && state->NumPoses != 0)
+	{
+		const int32 last = numTimings - 1;
+		const float* futurePoint = db.GetRow(stateIndex, poseIndex) + db.Layout.TrajectoryPosition + last * 3;
+		const FMotionFeatureNormal& normal = db.TrajectoryPositionNormals[last];
+
+		const FVector futurePosition(normal.Unnormalize(futurePoint[0]), normal.Unnormalize(futurePoint[1]), normal.Unnormalize(futurePoint[2]));
+		const float futureSpeed = futurePosition.Size();
+		const float desiredSpeed = trajectoryPositions[last].Size();
+
+		timeScaleWarp = (futureSpeed > KINDA_SMALL_NUMBER) ? FMath::Clamp(desiredSpeed / futureSpeed, 0.8f, 1.2f) : 1.f;
+	}
+	else
+	{
+		timeScaleWarp = 1.f;
+	}
+
+	// Character movement
+	rootMotionSpring.Update(desiredVector, desiredFacing, actorYaw, deltaTime);
+}
@@ -0,0 +1,74 @@
+// Copyright Wild Montage, LLC. All Rights Reserved.
+
+//
+// Search microbenchmarks. Enter in console:
+//   mm.Benchmark Poses=1000,10000,100000 Bones=3 Points=5 Queries=500 States=50 Warmup=1
+// Runs MMCore::RunBenchmark(), the same benchmark the standalone MMCoreBenchmark target runs, inside the editor's build.
+// Results are logged and written as JSON to Saved/Profiling/MotionMatching/ so they can be compared between plugin versions.
+// BruteForce is what STAT_MMIndexSearch measured before the other backends existed, so speedups are relative to it.
+//
+
+#include "CoreMinimal.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/DateTime.h"
+#include "Misc/EngineVersion.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+#include "Core/MMCoreBenchmark.h"
+
+namespace MotionMatchingBenchmark
+{
+	static void Run(const TArray<FString>& args)
+	{
+		MMCore::BenchmarkParams params;
+		FString posesArg;
+
+		for (const FString& arg : args)
+		{
+			// Don't stop on the commas of the list.
+			FParse::Value(*arg, TEXT("Poses="), posesArg, false);
+			FParse::Value(*arg, TEXT("Bones="), params.NumBones);
+			FParse::Value(*arg, TEXT("Points="), params.NumTrajectoryPoints);
+			FParse::Value(*arg, TEXT("Queries="), params.NumQueries);
+			FParse::Value(*arg, TEXT("States="), params.NumStates);
+			FParse::Value(*arg, TEXT("Warmup="), params.WarmupPasses);
+		}
+
+		if (!posesArg.IsEmpty())
+		{
+			TArray<FString> posesList;
+			posesArg.ParseIntoArray(posesList, TEXT(","));
+
+			params.PoseCounts.clear();
+
+			for (const FString& posesString : posesList)
+				params.PoseCounts.push_back(FCString::Atoi(*posesString));
+		}
+
+		const std::vector<MMCore::DatabaseBenchmark> results = MMCore::RunBenchmark(params);
+
+		for (const MMCore::DatabaseBenchmark& db : results)
+		{
+			for (const MMCore::BackendBenchmark& backend : db.Backends)
+			{
+				UE_LOG(LogTemp, Log, TEXT("mm.Benchmark %d poses, %s: %.2f us/query (x%.2f), scanned %.0f, pruned %.0f, agreement %.1f%%"),
+					db.NumPoses, ANSI_TO_TCHAR(MMCore::GetSearchBackendName(backend.Backend)), backend.UsPerQuery, backend.Speedup,
+					backend.PosesScannedPerQuery, backend.PosesPrunedPerQuery, 100.0 * backend.Agreement);
+			}
+		}
+
+		const std::string json = MMCore::BenchmarkToJson(params, results, TCHAR_TO_UTF8(*FEngineVersion::Current().ToString()),
+			TCHAR_TO_UTF8(*FDateTime::UtcNow().ToIso8601()));
+		const FString path = FPaths::ProfilingDir() / TEXT("MotionMatching") / FString::Printf(TEXT("Benchmark-%s.json"), *FDateTime::Now().ToString());
+
+		if (FFileHelper::SaveStringToFile(FString(UTF8_TO_TCHAR(json.c_str())), *path))
+			UE_LOG(LogTemp, Log, TEXT("mm.Benchmark results written to %s"), *path);
+	}
+
+	static FAutoConsoleCommand BenchmarkCommand(
+		TEXT("mm.Benchmark"),
+		TEXT("Times pose search backends, query building and normalization on synthetic databases. ")
+		TEXT("Args: Poses=1000,10000,100000 Bones=3 Points=5 Queries=500 States=50 Warmup=1"),
+		FConsoleCommandWithArgsDelegate::CreateStatic(&Run));
+}
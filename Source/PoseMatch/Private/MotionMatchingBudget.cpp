@@ -0,0 +1,155 @@
+// Copyright Wild Montage, LLC. All Rights Reserved.
+
+#include "MotionMatchingBudget.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/IConsoleManager.h"
+#include "MotionMatchingStats.h"
+
+static TAutoConsoleVariable<float> CVarBudgetMs(
+	TEXT("mm.Budget.Ms"),
+	2.f,
+	TEXT("Per-frame pose search budget of a world, in milliseconds. 0 disables throttling."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarBudgetFullQualityDistance(
+	TEXT("mm.Budget.FullQualityDistance"),
+	1500.f,
+	TEXT("Characters closer than this to the viewer are never throttled."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarBudgetLowQualityDistance(
+	TEXT("mm.Budget.LowQualityDistance"),
+	5000.f,
+	TEXT("Characters this far from the viewer (or further) get the full throttle of the current level."),
+	ECVF_Default);
+
+// Lower the level only once the cost is well below the budget, so we don't oscillate around it.
+static const float BudgetRecoverRatio = 0.7f;
+
+// Minimum time between level changes, in seconds. Gives the previous change a chance to show up in the cost.
+static const float BudgetLevelChangeDelay = 0.25f;
+
+bool UMotionMatchingBudgetSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	UWorld* world = Cast<UWorld>(Outer);
+	return world && world->IsGameWorld();
+}
+
+void UMotionMatchingBudgetSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	level = 0;
+	smoothedSearchMs = 0.f;
+	timeSinceLevelChange = 0.f;
+}
+
+void UMotionMatchingBudgetSubsystem::Tick(float DeltaTime)
+{
+	lastFrameSearchMs = pendingSearchNanoseconds.Exchange(0) / 1000000.f;
+	lastFrameUpdateMs = pendingUpdateNanoseconds.Exchange(0) / 1000000.f;
+	activeMatchers = pendingActive.Exchange(0);
+
+	// A spawn wave should trip the governor within a few frames, a single hitch shouldn't.
+	smoothedSearchMs = FMath::Lerp(smoothedSearchMs, lastFrameSearchMs, 0.25f);
+	timeSinceLevelChange += DeltaTime;
+
+	const float budgetMs = CVarBudgetMs.GetValueOnGameThread();
+	int32 newLevel = level;
+
+	if (budgetMs <= 0.f)
+	{
+		newLevel = 0;
+	}
+	else if (timeSinceLevelChange > BudgetLevelChangeDelay)
+	{
+		if (smoothedSearchMs > budgetMs)
+			newLevel = FMath::Min(newLevel + 1, MaxLevel);
+		else if (smoothedSearchMs < budgetMs * BudgetRecoverRatio)
+			newLevel = FMath::Max(newLevel - 1, 0);
+	}
+
+	if (newLevel != level)
+	{
+		level = newLevel;
+		timeSinceLevelChange = 0.f;
+	}
+
+	// Significance is measured from the first local player's view point.
+	FVector location = FVector::ZeroVector;
+	bool bFoundView = false;
+
+	for (FConstPlayerControllerIterator it = GetWorld()->GetPlayerControllerIterator(); it; ++it)
+	{
+		APlayerController* controller = it->Get();
+
+		if (controller && controller->IsLocalController())
+		{
+			FRotator rotation;
+			controller->GetPlayerViewPoint(location, rotation);
+			bFoundView = true;
+			break;
+		}
+	}
+
+	{
+		FRWScopeLock lock(viewLock, SLT_Write);
+		viewLocation = location;
+		bHasView = bFoundView;
+	}
+
+	SET_DWORD_STAT(STAT_MMBudgetLevel, newLevel);
+	SET_FLOAT_STAT(STAT_MMBudgetSearchMs, smoothedSearchMs);
+}
+
+void UMotionMatchingBudgetSubsystem::ReportSearch(float microseconds)
+{
+	pendingSearchNanoseconds += (int64)(microseconds * 1000.f);
+}
+
+void UMotionMatchingBudgetSubsystem::ReportUpdate(float microseconds)
+{
+	pendingUpdateNanoseconds += (int64)(microseconds * 1000.f);
+}
+
+void UMotionMatchingBudgetSubsystem::ReportActive(int32 numMatchers)
+{
+	pendingActive += numMatchers;
+}
+
+FMotionMatchingBudgetDecision UMotionMatchingBudgetSubsystem::GetDecision(const FVector& location) const
+{
+	FMotionMatchingBudgetDecision decision;
+	const int32 currentLevel = level;
+
+	if (currentLevel == 0) return decision;
+
+	// 0 = right next to the viewer (untouched), 1 = far away (fully throttled). Without a viewer (e.g., a dedicated server) everyone is far away.
+	float throttle = 1.f;
+
+	{
+		FRWScopeLock lock(viewLock, SLT_ReadOnly);
+
+		if (bHasView)
+		{
+			const float fullQualityDistance = CVarBudgetFullQualityDistance.GetValueOnAnyThread();
+			const float lowQualityDistance = FMath::Max(CVarBudgetLowQualityDistance.GetValueOnAnyThread(), fullQualityDistance + 1.f);
+
+			throttle = FMath::GetRangePct(fullQualityDistance, lowQualityDistance, FVector::Dist(location, viewLocation));
+			throttle = FMath::Clamp(throttle, 0.f, 1.f);
+		}
+	}
+
+	if (throttle == 0.f) return decision;
+
+	decision.IntervalScale = 1.f + throttle * (currentLevel >= 3 ? 4.f : 2.f);
+
+	if (currentLevel >= 2)
+		decision.SearchTolerance = throttle * 0.5f;
+
+	if (currentLevel >= 3 && throttle > 0.5f)
+		decision.bLoopsOnly = true;
+
+	return decision;
+}
@@ -0,0 +1,232 @@
+// Copyright Wild Montage, LLC. All Rights Reserved.
+
+#include "MotionMatchingCapture.h"
+#include "HAL/FileManager.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/DateTime.h"
+#include "Misc/Paths.h"
+
+//
+// File layout (little endian):
+//   uint32 magic, int32 version
+//   then records, each starting with a uint8 type:
+//     Database: int32 id, FString path, int32 searchDims, int32 numPoses
+//     Query:    int32 database, int32 currentState, int32 currentPose, float steadyBias, uint8 loopsOnly, float tolerance (v2+),
+//               float naturalBias, float loopBias, int32 winnerState, int32 winnerPose, float cost, float searchUs,
+//               float query[searchDims of the database]
+// Databases are written the first time a query references them.
+//
+
+namespace
+{
+	const uint32 CaptureMagic = 0x50434D4D; // "MMCP"
+	const int32 CaptureVersion = 2;
+
+	enum class ECaptureRecord : uint8
+	{
+		Database,
+		Query
+	};
+
+	FCriticalSection CaptureLock;
+	TUniquePtr<FArchive> CaptureFile;
+	TMap<FString, int32> CaptureDatabaseIds;
+	TArray<int32> CaptureDatabaseDims;
+	int32 CaptureQueryCount = 0;
+}
+
+TAtomic<bool> FMotionCaptureWriter::bCapturing(false);
+
+FString FMotionCaptureWriter::GetCaptureDir()
+{
+	return FPaths::ProfilingDir() / TEXT("MotionMatching");
+}
+
+bool FMotionCaptureWriter::Start(const FString& fileName)
+{
+	Stop();
+
+	FString path = fileName.IsEmpty() ? FString::Printf(TEXT("Capture-%s"), *FDateTime::Now().ToString()) : fileName;
+
+	if (FPaths::IsRelative(path))
+		path = GetCaptureDir() / path;
+
+	if (FPaths::GetExtension(path).IsEmpty())
+		path += TEXT(".mmcap");
+
+	FScopeLock lock(&CaptureLock);
+
+	CaptureFile.Reset(IFileManager::Get().CreateFileWriter(*path));
+
+	if (!CaptureFile)
+	{
+		UE_LOG(LogTemp, Error, TEXT("Motion matching capture: couldn't open %s"), *path);
+		return false;
+	}
+
+	uint32 magic = CaptureMagic;
+	int32 version = CaptureVersion;
+	*CaptureFile << magic << version;
+
+	CaptureDatabaseIds.Reset();
+	CaptureDatabaseDims.Reset();
+	CaptureQueryCount = 0;
+	bCapturing = true;
+
+	UE_LOG(LogTemp, Log, TEXT("Motion matching capture started: %s"), *path);
+	return true;
+}
+
+void FMotionCaptureWriter::Stop()
+{
+	FScopeLock lock(&CaptureLock);
+
+	if (!CaptureFile) return;
+
+	bCapturing = false;
+	CaptureFile->Close();
+	CaptureFile.Reset();
+
+	UE_LOG(LogTemp, Log, TEXT("Motion matching capture stopped after %d queries."), CaptureQueryCount);
+}
+
+void FMotionCaptureWriter::Record(const FMotionDatabase& database, const float* query, const FMotionSearchParams& params, const FMotionSearchResult& result, float searchMicroseconds)
+{
+	FScopeLock lock(&CaptureLock);
+
+	if (!CaptureFile) return;
+
+	FArchive& ar = *CaptureFile;
+	int32 databaseId;
+
+	if (const int32* id = CaptureDatabaseIds.Find(database.SourcePath))
+	{
+		databaseId = *id;
+	}
+	else
+	{
+		databaseId = CaptureDatabaseDims.Add(database.Layout.SearchDims);
+		CaptureDatabaseIds.Add(database.SourcePath, databaseId);
+
+		uint8 type = (uint8)ECaptureRecord::Database;
+		FString path = database.SourcePath;
+		int32 searchDims = database.Layout.SearchDims;
+		int32 numPoses = database.Times.Num();
+
+		ar << type << databaseId << path << searchDims << numPoses;
+	}
+
+	// A rebuilt database with a different layout can't be replayed against the same id.
+	if (CaptureDatabaseDims[databaseId] != database.Layout.SearchDims) return;
+
+	uint8 type = (uint8)ECaptureRecord::Query;
+	int32 currentState = params.CurrentState;
+	int32 currentPose = params.CurrentPose;
+	float steadyBias = params.SteadyBias;
+	uint8 loopsOnly = params.bLoopsOnly ? 1 : 0;
+	float tolerance = params.Tolerance;
+	float naturalBias = database.NaturalBias;
+	float loopBias = database.LoopBias;
+	int32 winnerState = result.StateIndex;
+	int32 winnerPose = result.PoseIndex;
+	float cost = result.Cost;
+
+	ar << type << databaseId << currentState << currentPose << steadyBias << loopsOnly << tolerance << naturalBias << loopBias
+		<< winnerState << winnerPose << cost << searchMicroseconds;
+	ar.Serialize(const_cast<float*>(query), database.Layout.SearchDims * sizeof(float));
+
+	CaptureQueryCount++;
+}
+
+bool FMotionCapture::Load(const FString& fileName)
+{
+	Databases.Reset();
+	Queries.Reset();
+
+	TUniquePtr<FArchive> file(IFileManager::Get().CreateFileReader(*fileName));
+
+	if (!file)
+	{
+		UE_LOG(LogTemp, Error, TEXT("Motion matching capture: couldn't open %s"), *fileName);
+		return false;
+	}
+
+	FArchive& ar = *file;
+	uint32 magic = 0;
+	int32 version = 0;
+	ar << magic << version;
+
+	if (magic != CaptureMagic || version < 1 || version > CaptureVersion)
+	{
+		UE_LOG(LogTemp, Error, TEXT("Motion matching capture: %s is not a version %d capture."), *fileName, CaptureVersion);
+		return false;
+	}
+
+	while (!ar.AtEnd() && !ar.IsError())
+	{
+		uint8 type = 0;
+		ar << type;
+
+		if (type == (uint8)ECaptureRecord::Database)
+		{
+			int32 id = 0;
+			FMotionCapturedDatabase db;
+			ar << id << db.Path << db.SearchDims << db.NumPoses;
+
+			if (id != Databases.Num()) break;
+
+			Databases.Add(MoveTemp(db));
+		}
+		else if (type == (uint8)ECaptureRecord::Query)
+		{
+			FMotionCapturedQuery& q = Queries.AddDefaulted_GetRef();
+			uint8 loopsOnly = 0;
+
+			ar << q.Database << q.Params.CurrentState << q.Params.CurrentPose << q.Params.SteadyBias << loopsOnly;
+
+			// Version 1 predates approximate search.
+			if (version >= 2)
+				ar << q.Params.Tolerance;
+
+			ar << q.NaturalBias << q.LoopBias << q.Result.StateIndex << q.Result.PoseIndex << q.Result.Cost << q.SearchMicroseconds;
+
+			q.Params.bLoopsOnly = loopsOnly != 0;
+
+			if (!Databases.IsValidIndex(q.Database))
+			{
+				Queries.Pop(false);
+				break;
+			}
+
+			q.Query.SetNumUninitialized(Databases[q.Database].SearchDims);
+			ar.Serialize(q.Query.GetData(), q.Query.Num() * sizeof(float));
+		}
+		else
+		{
+			break;
+		}
+	}
+
+	if (ar.IsError())
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Motion matching capture: %s is truncated, loaded %d queries."), *fileName, Queries.Num());
+
+		// The last query may be partially read.
+		if (Queries.Num() != 0)
+			Queries.Pop(false);
+	}
+
+	return true;
+}
+
+static FAutoConsoleCommand CaptureStartCommand(
+	TEXT("mm.Capture.Start"),
+	TEXT("Records every motion matching search to Saved/Profiling/MotionMatching/<FileName>.mmcap. Args: [FileName]"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& args) {
+		FMotionCaptureWriter::Start(args.Num() != 0 ? args[0] : FString());
+	}));
+
+static FAutoConsoleCommand CaptureStopCommand(
+	TEXT("mm.Capture.Stop"),
+	TEXT("Stops the motion matching capture."),
+	FConsoleCommandDelegate::CreateStatic(&FMotionCaptureWriter::Stop));
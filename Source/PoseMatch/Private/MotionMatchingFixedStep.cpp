@@ -0,0 +1,40 @@
+// Copyright Wild Montage, LLC. All Rights Reserved.
+
+#include "MotionMatchingFixedStep.h"
+#include "HAL/IConsoleManager.h"
+
+static TAutoConsoleVariable<float> CVarFixedTimeStep(
+	TEXT("mm.FixedTimeStep"),
+	0.f,
+	TEXT("Overrides the fixed time step of every motion matcher node, headless and crowd component, in seconds. 0 uses each one's FixedTimeStep setting."),
+	ECVF_Default);
+
+float FMotionMatchingFixedStep::GetTimeStep(float fixedTimeStep)
+{
+	const float overrideStep = CVarFixedTimeStep.GetValueOnAnyThread();
+	return (overrideStep > 0.f) ? overrideStep : fixedTimeStep;
+}
+
+int32 FMotionMatchingFixedStep::Advance(float frameDeltaTime, float fixedTimeStep, int32 maxSteps, float& outStepTime)
+{
+	if (fixedTimeStep <= 0.f)
+	{
+		Accumulator = 0.f;
+		outStepTime = frameDeltaTime;
+		return 1;
+	}
+
+	Accumulator += frameDeltaTime;
+	int32 numSteps = FMath::FloorToInt(Accumulator / fixedTimeStep);
+
+	// After a hitch, drop what we can't catch up on instead of stalling even longer.
+	if (numSteps > maxSteps)
+	{
+		numSteps = FMath::Max(maxSteps, 1);
+		Accumulator = numSteps * fixedTimeStep;
+	}
+
+	Accumulator -= numSteps * fixedTimeStep;
+	outStepTime = fixedTimeStep;
+	return numSteps;
+}
@@ -0,0 +1,79 @@
+// Copyright Wild Montage, LLC. All Rights Reserved.
+
+#include "MotionMatchingFootLock.h"
+
+void FMotionMatchingFootLock::SetTarget(int32 foot, bool bLock, const FVector& location, const FVector& normal)
+{
+	if (foot == MM_FOOT::LEFT)
+	{
+		target.LFoot_LockStrength = bLock ? 1.f : 0.f;
+
+		if (bLock)
+		{
+			target.LFootLocation = location;
+			target.LFootNormal = normal;
+		}
+	}
+	else
+	{
+		target.RFoot_LockStrength = bLock ? 1.f : 0.f;
+
+		if (bLock)
+		{
+			target.RFootLocation = location;
+			target.RFootNormal = normal;
+		}
+	}
+}
+
+void FMotionMatchingFootLock::Update(float deltaTime, const FTransform& componentT, const FTransform& actorT)
+{
+	const FVector actorPos = actorT.GetLocation();
+	const FTransform footWorldT[2] = { feet[0] * componentT, feet[1] * componentT };
+
+	auto calcIKPos = [&actorPos](const FTransform& t, FVector& ikPos) {
+		ikPos = FVector::ForwardVector * -100.f;
+		ikPos = ikPos.RotateAngleAxis(t.GetRotation().Rotator().Euler().Z, FVector::UpVector).RotateAngleAxis(90.f, FVector::UpVector) + actorPos + FVector(0.f, 0.f, -50.f);
+	};
+
+	calcIKPos(footWorldT[0], current.LLegIKLocation);
+	calcIKPos(footWorldT[1], current.RLegIKLocation);
+
+	if (target.LFoot_LockStrength == 1.f)
+	{
+		current.LFoot_LockStrength = FMath::FInterpTo(current.LFoot_LockStrength, target.LFoot_LockStrength, deltaTime, 8.0f);
+		current.LFootLocation = FMath::VInterpTo(current.LFootLocation, target.LFootLocation, deltaTime, 4.0f);
+		current.LFootNormal = FMath::VInterpTo(current.LFootNormal, target.LFootNormal, deltaTime, 8.0f).GetSafeNormal();
+	}
+	else
+	{
+		current.LFoot_LockStrength = FMath::FInterpTo(current.LFoot_LockStrength, target.LFoot_LockStrength, deltaTime, 3.0f);
+		current.LFootLocation = FMath::VInterpTo(current.LFootLocation, footWorldT[0].GetLocation(), deltaTime, 28.0f);
+		current.LFootNormal = FMath::VInterpTo(current.LFootNormal, FVector::UpVector, deltaTime, 8.0f).GetSafeNormal();
+
+		const FRotator rot = feet[0].GetRotation().Rotator();
+		current.LLegIKLocation = FVector::ForwardVector * -100.f;
+		current.LLegIKLocation = current.LLegIKLocation.RotateAngleAxis(rot.Euler().Z, FVector::UpVector).RotateAngleAxis(actorT.GetRotation().Rotator().Euler().Z, FVector::UpVector);
+		current.LLegIKLocation += actorPos + FVector(0.f, 0.f, -50.f);
+	}
+
+	if (target.RFoot_LockStrength == 1.f)
+	{
+		current.RFoot_LockStrength = FMath::FInterpTo(current.RFoot_LockStrength, target.RFoot_LockStrength, deltaTime, 8.0f);
+		current.RFootLocation = FMath::VInterpTo(current.RFootLocation, target.RFootLocation, deltaTime, 4.0f);
+		current.RFootNormal = FMath::VInterpTo(current.RFootNormal, target.RFootNormal, deltaTime, 8.0f).GetSafeNormal();
+	}
+	else
+	{
+		current.RFoot_LockStrength = FMath::FInterpTo(current.RFoot_LockStrength, target.RFoot_LockStrength, deltaTime, 3.0f);
+		current.RFootLocation = FMath::VInterpTo(current.RFootLocation, footWorldT[1].GetLocation(), deltaTime, 28.0f);
+		current.RFootNormal = FMath::VInterpTo(current.RFootNormal, FVector::UpVector, deltaTime, 8.0f).GetSafeNormal();
+	}
+}
+
+void FMotionMatchingFootLock::Reset()
+{
+	current = FFootLock();
+	target = FFootLock();
+	feet[0] = feet[1] = FTransform::Identity;
+}
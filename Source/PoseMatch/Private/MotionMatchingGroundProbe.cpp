@@ -0,0 +1,108 @@
+// Copyright Wild Montage, LLC. All Rights Reserved.
+
+#include "MotionMatchingGroundProbe.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "MotionMatchingStats.h"
+
+static TAutoConsoleVariable<float> CVarGroundProbeUp(
+	TEXT("mm.GroundProbe.Up"),
+	50.f,
+	TEXT("Ground probes start this far above the animated foot, in cm. The highest step a locked foot can go up."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarGroundProbeDown(
+	TEXT("mm.GroundProbe.Down"),
+	50.f,
+	TEXT("Ground probes end this far below the animated foot, in cm. The deepest step a locked foot can go down."),
+	ECVF_Default);
+
+// Owners that haven't requested a probe for this many frames are dropped.
+static const uint64 GroundProbeForgetFrames = 4;
+
+bool UMotionMatchingGroundProbeSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	UWorld* world = Cast<UWorld>(Outer);
+	return world && world->IsGameWorld();
+}
+
+void UMotionMatchingGroundProbeSubsystem::Tick(float DeltaTime)
+{
+	UWorld* world = GetWorld();
+	if (!world) return;
+
+	const FVector up(0.f, 0.f, CVarGroundProbeUp.GetValueOnGameThread());
+	const FVector down(0.f, 0.f, CVarGroundProbeDown.GetValueOnGameThread());
+	int32 numTraces = 0;
+
+	FRWScopeLock scopeLock(lock, SLT_Write);
+
+	for (auto it = probes.CreateIterator(); it; ++it)
+	{
+		FOwnerProbes& owner = it.Value();
+
+		if (GFrameCounter - owner.LastRequestFrame > GroundProbeForgetFrames)
+		{
+			it.RemoveCurrent();
+			continue;
+		}
+
+		FCollisionQueryParams params(SCENE_QUERY_STAT(MMGroundProbe), false, owner.IgnoredActor.Get());
+
+		for (FFootProbe& probe : owner.Feet)
+		{
+			// Last frame's trace.
+			if (probe.Handle.IsValid())
+			{
+				FTraceDatum datum;
+
+				if (world->QueryTraceData(probe.Handle, datum))
+				{
+					const FHitResult* hit = (datum.OutHits.Num() != 0 && datum.OutHits[0].bBlockingHit) ? &datum.OutHits[0] : nullptr;
+
+					probe.Result.ProbeLocation = probe.TracedLocation;
+					probe.Result.bHit = hit != nullptr;
+					probe.Result.Location = hit ? FVector(hit->ImpactPoint) : probe.TracedLocation;
+					probe.Result.Normal = hit ? FVector(hit->ImpactNormal) : FVector::UpVector;
+					probe.bHasResult = true;
+				}
+
+				probe.Handle.Invalidate();
+			}
+
+			if (!probe.bRequested) continue;
+
+			probe.bRequested = false;
+			probe.TracedLocation = probe.RequestLocation;
+			probe.Handle = world->AsyncLineTraceByChannel(EAsyncTraceType::Single, probe.RequestLocation + up, probe.RequestLocation - down, owner.Channel, params);
+			++numTraces;
+		}
+	}
+
+	SET_DWORD_STAT(STAT_MMGroundProbes, numTraces);
+}
+
+void UMotionMatchingGroundProbeSubsystem::Request(const void* owner, int32 foot, const FVector& location, const AActor* ignoredActor, ECollisionChannel channel)
+{
+	FRWScopeLock scopeLock(lock, SLT_Write);
+
+	FOwnerProbes& ownerProbes = probes.FindOrAdd(owner);
+	ownerProbes.IgnoredActor = ignoredActor;
+	ownerProbes.Channel = channel;
+	ownerProbes.LastRequestFrame = GFrameCounter;
+
+	FFootProbe& probe = ownerProbes.Feet[foot];
+	probe.RequestLocation = location;
+	probe.bRequested = true;
+}
+
+bool UMotionMatchingGroundProbeSubsystem::GetResult(const void* owner, int32 foot, FMotionMatchingGroundHit& outHit) const
+{
+	FRWScopeLock scopeLock(lock, SLT_ReadOnly);
+
+	const FOwnerProbes* ownerProbes = probes.Find(owner);
+	if (!ownerProbes || !ownerProbes->Feet[foot].bHasResult) return false;
+
+	outHit = ownerProbes->Feet[foot].Result;
+	return true;
+}
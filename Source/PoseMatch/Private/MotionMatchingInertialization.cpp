@@ -0,0 +1,148 @@
+// Copyright Wild Montage, LLC. All Rights Reserved.
+
+#include "MotionMatchingInertialization.h"
+
+#include "Animation/AnimSequence.h"
+#include "Spring/Spring.h"
+
+static const int32 FloatsPerBone = 6;
+
+// Half-lives per blend time. The offsets are down to about 8% by the blend time and we stop at twice that.
+static const float HalfLivesPerBlend = 3.f;
+
+static FVector ToRotationVector(FQuat q)
+{
+	// Shortest way around.
+	if (q.W < 0.f)
+		q = FQuat(-q.X, -q.Y, -q.Z, -q.W);
+
+	FVector axis;
+	float angle;
+	q.ToAxisAndAngle(axis, angle);
+
+	return axis * angle;
+}
+
+static FQuat FromRotationVector(const FVector& v)
+{
+	const float angle = v.Size();
+	return (angle > SMALL_NUMBER) ? FQuat(v / angle, angle) : FQuat::Identity;
+}
+
+void FMotionMatchingInertialization::Request(const UAnimSequence* fromAnimation, float fromTime, float blendTime)
+{
+	if (!pendingAnimation)
+	{
+		pendingAnimation = fromAnimation;
+		pendingTime = fromTime;
+	}
+
+	pendingBlendTime = blendTime;
+}
+
+void FMotionMatchingInertialization::Apply(FPoseContext& output, const UAnimSequence* animation, float time, float deltaTime)
+{
+	const int32 numBones = output.Pose.GetNumBones();
+
+	// Required bones changed (e.g., LOD), the offsets don't line up anymore.
+	if (offsets.Num() != numBones * FloatsPerBone && IsBlending())
+		Reset();
+
+	if (pendingAnimation && animation && deltaTime > 0.f)
+	{
+		// Velocities come from where both animations were a frame ago.
+		FPoseContext source(output), sourceBefore(output), destinationBefore(output);
+		FAnimationPoseData sourceData(source), sourceBeforeData(sourceBefore), destinationBeforeData(destinationBefore);
+
+		pendingAnimation->GetAnimationPose(sourceData, FAnimExtractContext(pendingTime, false));
+		pendingAnimation->GetAnimationPose(sourceBeforeData, FAnimExtractContext(FMath::Max(pendingTime - deltaTime, 0.f), false));
+		animation->GetAnimationPose(destinationBeforeData, FAnimExtractContext(FMath::Max(time - deltaTime, 0.f), false));
+
+		halfLife = pendingBlendTime / HalfLivesPerBlend;
+		blendTimeLeft = pendingBlendTime * 2.f;
+
+		Start(source.Pose, sourceBefore.Pose, output.Pose, destinationBefore.Pose, deltaTime);
+
+		// Show exactly the source this frame, decay from the next one on.
+		deltaTime = 0.f;
+	}
+
+	pendingAnimation = nullptr;
+
+	if (!IsBlending()) return;
+
+	blendTimeLeft -= deltaTime;
+
+	if (!IsBlending())
+	{
+		Reset();
+		return;
+	}
+
+	Spring::decay_spring_damper_implicit_batch(offsets.GetData(), offsetVelocities.GetData(), offsets.Num(), halfLife, deltaTime);
+
+	for (int32 bone = 1; bone < numBones; ++bone)
+	{
+		FTransform& transform = output.Pose[FCompactPoseBoneIndex(bone)];
+		const float* offset = &offsets[bone * FloatsPerBone];
+
+		transform.AddToTranslation(FVector(offset[0], offset[1], offset[2]));
+		transform.SetRotation(FromRotationVector(FVector(offset[3], offset[4], offset[5])) * transform.GetRotation());
+		transform.NormalizeRotation();
+	}
+}
+
+void FMotionMatchingInertialization::Start(const FCompactPose& source, const FCompactPose& sourceBefore, const FCompactPose& destination, const FCompactPose& destinationBefore, float deltaTime)
+{
+	const int32 numBones = destination.GetNumBones();
+	const bool bWasBlending = offsets.Num() == numBones * FloatsPerBone;
+
+	// A blend still going on is part of the source: that's what's showing.
+	if (!bWasBlending)
+	{
+		offsets.SetNumZeroed(numBones * FloatsPerBone);
+		offsetVelocities.SetNumZeroed(numBones * FloatsPerBone);
+	}
+
+	const float invDeltaTime = 1.f / deltaTime;
+
+	for (int32 bone = 1; bone < numBones; ++bone)
+	{
+		const FCompactPoseBoneIndex index(bone);
+		float* offset = &offsets[bone * FloatsPerBone];
+		float* velocity = &offsetVelocities[bone * FloatsPerBone];
+
+		const FQuat currentRotationOffset = FromRotationVector(FVector(offset[3], offset[4], offset[5]));
+
+		const FVector sourcePosition = source[index].GetTranslation() + FVector(offset[0], offset[1], offset[2]);
+		const FQuat sourceRotation = currentRotationOffset * source[index].GetRotation();
+
+		const FVector sourceVelocity = (source[index].GetTranslation() - sourceBefore[index].GetTranslation()) * invDeltaTime + FVector(velocity[0], velocity[1], velocity[2]);
+		const FVector sourceAngularVelocity = ToRotationVector(source[index].GetRotation() * sourceBefore[index].GetRotation().Inverse()) * invDeltaTime + FVector(velocity[3], velocity[4], velocity[5]);
+
+		const FVector destinationVelocity = (destination[index].GetTranslation() - destinationBefore[index].GetTranslation()) * invDeltaTime;
+		const FVector destinationAngularVelocity = ToRotationVector(destination[index].GetRotation() * destinationBefore[index].GetRotation().Inverse()) * invDeltaTime;
+
+		const FVector positionOffset = sourcePosition - destination[index].GetTranslation();
+		const FVector rotationOffset = ToRotationVector(sourceRotation * destination[index].GetRotation().Inverse());
+		const FVector velocityOffset = sourceVelocity - destinationVelocity;
+		const FVector angularVelocityOffset = sourceAngularVelocity - destinationAngularVelocity;
+
+		FMemory::Memcpy(offset, &positionOffset.X, sizeof(float) * 3);
+		FMemory::Memcpy(offset + 3, &rotationOffset.X, sizeof(float) * 3);
+		FMemory::Memcpy(velocity, &velocityOffset.X, sizeof(float) * 3);
+		FMemory::Memcpy(velocity + 3, &angularVelocityOffset.X, sizeof(float) * 3);
+	}
+}
+
+void FMotionMatchingInertialization::Reset()
+{
+	offsets.Reset();
+	offsetVelocities.Reset();
+	blendTimeLeft = 0.f;
+}
+
+SIZE_T FMotionMatchingInertialization::GetAllocatedSize() const
+{
+	return offsets.GetAllocatedSize() + offsetVelocities.GetAllocatedSize();
+}
@@ -0,0 +1,80 @@
+// Copyright Wild Montage, LLC. All Rights Reserved.
+
+#include "MotionMatchingPath.h"
+
+void FMotionMatchingPath::Reset()
+{
+	Points.Reset();
+	Length = 0.f;
+	Speed = 0.f;
+}
+
+void FMotionMatchingPath::Set(const TArray<FVector>& worldPoints, float speed, const FVector& location, float actorYaw)
+{
+	Reset();
+	Speed = speed;
+
+	for (const FVector& point : worldPoints)
+	{
+		// The matcher's trajectories are flat.
+		FVector local = (point - location).RotateAngleAxis(-actorYaw, FVector::UpVector);
+		local.Z = 0.f;
+
+		Points.Add(local);
+	}
+
+	if (Points.Num() == 0) return;
+
+	// Paths usually start where the character was when it was found, so start from the closest point to where it is now.
+	int32 closestSegment = 0;
+	FVector closestPoint = Points[0];
+	float closestDistance = closestPoint.SizeSquared();
+
+	for (int32 i = 0; i + 1 < Points.Num(); ++i)
+	{
+		const FVector point = FMath::ClosestPointOnSegment(FVector::ZeroVector, Points[i], Points[i + 1]);
+		const float distance = point.SizeSquared();
+
+		if (distance < closestDistance)
+		{
+			closestSegment = i;
+			closestPoint = point;
+			closestDistance = distance;
+		}
+	}
+
+	Points.RemoveAt(0, closestSegment + 1, false);
+	Points.Insert(closestPoint, 0);
+
+	// Get there from where we are.
+	if (closestDistance > KINDA_SMALL_NUMBER)
+		Points.Insert(FVector::ZeroVector, 0);
+
+	for (int32 i = 0; i + 1 < Points.Num(); ++i)
+		Length += FVector::Dist(Points[i], Points[i + 1]);
+}
+
+void FMotionMatchingPath::Sample(const float* timings, int32 numTimings, const MMCore::TrajectoryInput& trajectoryInput, FVector* outPositions, float* outFacings) const
+{
+	MMCore::SamplePath(timings, numTimings, &Points.GetData()->X, Points.Num(), Speed, trajectoryInput, &outPositions->X, outFacings);
+}
+
+void FMotionMatchingPath::GetInput(float nearTime, float farTime, float maxSpeed, const MMCore::TrajectoryInput& trajectoryInput, FVector& outDesiredVector, float& outDesiredFacing) const
+{
+	outDesiredVector = FVector::ZeroVector;
+	outDesiredFacing = 0.f;
+
+	if (!IsValid() || farTime <= 0.f || maxSpeed <= 0.f) return;
+
+	const float timings[2] = { FMath::Max(nearTime, 0.f), farTime };
+	FVector positions[2];
+	float facings[2];
+
+	Sample(timings, 2, trajectoryInput, positions, facings);
+
+	const FVector direction = positions[0].IsNearlyZero() ? positions[1].GetSafeNormal() : positions[0].GetSafeNormal();
+	const float speed = FMath::Min(Speed * farTime, Length) / farTime;
+
+	outDesiredVector = direction * FMath::Min(speed / maxSpeed, 1.f);
+	outDesiredFacing = facings[1];
+}
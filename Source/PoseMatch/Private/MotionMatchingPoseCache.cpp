@@ -0,0 +1,85 @@
+// Copyright Wild Montage, LLC. All Rights Reserved.
+
+#include "MotionMatchingPoseCache.h"
+
+#include "Animation/AnimSequence.h"
+#include "HAL/IConsoleManager.h"
+#include "MotionMatchingStats.h"
+
+static TAutoConsoleVariable<float> CVarPoseCacheTimeStep(
+	TEXT("mm.PoseCache.TimeStep"),
+	1.f / 60.f,
+	TEXT("Nodes using the shared pose cache sample clips at multiples of this many seconds, so nearby times share a pose. 0 disables the cache."),
+	ECVF_Scalability);
+
+static TAutoConsoleVariable<int32> CVarPoseCacheMaxEntries(
+	TEXT("mm.PoseCache.MaxEntries"),
+	256,
+	TEXT("Most poses the shared pose cache holds in a frame. Further poses are extracted without being cached."),
+	ECVF_Default);
+
+FMotionMatchingPoseCache& FMotionMatchingPoseCache::Get()
+{
+	static FMotionMatchingPoseCache cache;
+	return cache;
+}
+
+void FMotionMatchingPoseCache::GetAnimationPose(const UAnimSequence* animation, float time, bool bExtractRootMotion, FAnimationPoseData& output)
+{
+	const float timeStep = CVarPoseCacheTimeStep.GetValueOnAnyThread();
+
+	if (timeStep <= 0.f)
+	{
+		animation->GetAnimationPose(output, FAnimExtractContext(time, bExtractRootMotion));
+		return;
+	}
+
+	FCompactPose& pose = output.GetPose();
+	const FBoneContainer& boneContainer = pose.GetBoneContainer();
+
+	FKey key;
+	key.Animation = animation;
+	key.BoneAsset = boneContainer.GetAsset();
+	key.NumBones = pose.GetNumBones();
+	key.TimeStep = FMath::RoundToInt(time / timeStep);
+	key.bExtractRootMotion = bExtractRootMotion;
+
+	const uint64 currentFrame = GFrameCounter;
+
+	{
+		FRWScopeLock readLock(lock, SLT_ReadOnly);
+
+		if (frame == currentFrame)
+		{
+			if (const FEntry* entry = entries.Find(key))
+			{
+				for (const FCompactPoseBoneIndex index : pose.ForEachBoneIndex())
+					pose[index] = entry->Bones[index.GetInt()];
+
+				output.GetCurve().CopyFrom(entry->Curve);
+
+				INC_DWORD_STAT(STAT_MMPoseCacheHits);
+				return;
+			}
+		}
+	}
+
+	// Not there yet. Several threads may get here for the same pose at once, they all extract it and the last one stays.
+	animation->GetAnimationPose(output, FAnimExtractContext(key.TimeStep * timeStep, bExtractRootMotion));
+	INC_DWORD_STAT(STAT_MMPoseCacheMisses);
+
+	FRWScopeLock writeLock(lock, SLT_Write);
+
+	if (frame != currentFrame)
+	{
+		entries.Reset();
+		frame = currentFrame;
+	}
+
+	if (entries.Num() >= CVarPoseCacheMaxEntries.GetValueOnAnyThread()) return;
+
+	FEntry& entry = entries.FindOrAdd(key);
+	entry.Bones.Reset(pose.GetNumBones());
+	entry.Bones.Append(pose.GetBones());
+	entry.Curve.CopyFrom(output.GetCurve());
+}
@@ -0,0 +1,26 @@
+// Copyright Wild Montage, LLC. All Rights Reserved.
+
+#include "MotionMatchingSearchSchedule.h"
+
+bool FMotionMatchingSearchSchedule::ShouldSearch(float timeSinceLastMatch, float intervalScale, float changeThreshold, float maxSearchInterval, float divergence, bool bEnding)
+{
+	if (changeThreshold <= 0.f)
+		return timeSinceLastMatch > MOTION_MATCHING_INTERVAL * intervalScale;
+
+	const bool bNowDiverged = divergence > changeThreshold || bEnding;
+	const bool bJustDiverged = bNowDiverged && !bDiverged;
+	bDiverged = bNowDiverged;
+
+	// Search right away when things change, then at the regular rate for as long as they're off.
+	if (bDiverged)
+		SearchInterval = MOTION_MATCHING_INTERVAL;
+
+	if (!bJustDiverged && timeSinceLastMatch <= SearchInterval * intervalScale)
+		return false;
+
+	// Still on track, give the next search twice as long.
+	if (!bDiverged)
+		SearchInterval = FMath::Min(SearchInterval * 2.f, FMath::Max(maxSearchInterval, MOTION_MATCHING_INTERVAL));
+
+	return true;
+}
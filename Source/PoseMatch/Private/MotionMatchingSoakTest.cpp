@@ -0,0 +1,529 @@
+// Copyright Wild Montage, LLC. All Rights Reserved.
+
+//
+// Soak test. Spawns waves of motion matched characters in the game world, drives them with scripted input and records
+// the cost per agent count. One automation test per wave (PoseMatch.Soak.<N> Agents), run e.g. with:
+//   UE4Editor-Cmd <Project> -game -nullrhi -MMSoakClass=/Game/Characters/BP_Hero.BP_Hero_C -MMSoakAgents=10,100,500
+//     -MMSoakFrames=300 [-MMSoakMap=/Game/Maps/Flat] -ExecCmds="Automation RunTests PoseMatch.Soak; Quit"
+// The class must be a character whose anim blueprint uses the motion matcher node. Results are added to the automation
+// report and written as JSON to Saved/Profiling/MotionMatching/ so scaling curves can be compared between plugin versions.
+// Allocations are counted in their own untimed pass before the timed frames, which run on the stock allocator.
+//
+
+#include "CoreMinimal.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "GameFramework/Character.h"
+#include "HAL/MemoryBase.h"
+#include "HAL/PlatformTime.h"
+#include "HAL/ThreadSafeCounter64.h"
+#include "Misc/AutomationTest.h"
+#include "Misc/CommandLine.h"
+#include "Misc/DateTime.h"
+#include "Misc/EngineVersion.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "RenderCore.h"
+#include "RenderingThread.h"
+#include "Serialization/JsonWriter.h"
+#include "Tests/AutomationCommon.h"
+#include "UObject/UObjectGlobals.h"
+#include "UObject/UObjectIterator.h"
+
+#include "MotionMatcherInterface.h"
+#include "MotionMatchingBudget.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace MotionMatchingSoakTest
+{
+	// Frames to let a new wave settle (spawning, first matches) before measuring.
+	static const int32 WarmupFrames = 30;
+
+	// Untimed frames run with allocations counted, after the warmup and before the timed frames.
+	static const int32 CountedFrames = 60;
+
+	// Distance between spawned characters.
+	static const float SpawnSpacing = 300.f;
+
+	/**
+	 * Forwards everything to the allocator it wraps and counts allocations and allocated bytes on the way.
+	 * Installed as GMalloc from spawning a wave until its counted frames are over, never while frames are timed: asking
+	 * the wrapped allocator for every block's size isn't free. Never deleted, since other threads may still be inside it
+	 * after it's uninstalled; whatever was allocated through it belongs to the wrapped allocator, so it can come and go.
+	 */
+	class FCountingMalloc final : public FMalloc
+	{
+	public:
+		FMalloc* Inner = nullptr;
+
+		// Mallocs and reallocs.
+		FThreadSafeCounter64 Allocations;
+		// Total size of those allocations.
+		FThreadSafeCounter64 AllocatedBytes;
+		// Allocated minus freed, since installed.
+		FThreadSafeCounter64 NetBytes;
+
+		virtual void* Malloc(SIZE_T count, uint32 alignment) override
+		{
+			void* ptr = Inner->Malloc(count, alignment);
+			Count(ptr);
+			return ptr;
+		}
+
+		virtual void* TryMalloc(SIZE_T count, uint32 alignment) override
+		{
+			void* ptr = Inner->TryMalloc(count, alignment);
+			Count(ptr);
+			return ptr;
+		}
+
+		virtual void* Realloc(void* original, SIZE_T count, uint32 alignment) override
+		{
+			Uncount(original);
+			void* ptr = Inner->Realloc(original, count, alignment);
+			Count(ptr);
+			return ptr;
+		}
+
+		virtual void* TryRealloc(void* original, SIZE_T count, uint32 alignment) override
+		{
+			Uncount(original);
+			void* ptr = Inner->TryRealloc(original, count, alignment);
+			Count(ptr);
+			return ptr;
+		}
+
+		virtual void Free(void* original) override
+		{
+			Uncount(original);
+			Inner->Free(original);
+		}
+
+		virtual SIZE_T QuantizeSize(SIZE_T count, uint32 alignment) override { return Inner->QuantizeSize(count, alignment); }
+		virtual bool GetAllocationSize(void* original, SIZE_T& sizeOut) override { return Inner->GetAllocationSize(original, sizeOut); }
+		virtual void Trim(bool bTrimThreadCaches) override { Inner->Trim(bTrimThreadCaches); }
+		virtual void SetupTLSCachesOnCurrentThread() override { Inner->SetupTLSCachesOnCurrentThread(); }
+		virtual void ClearAndDisableTLSCachesOnCurrentThread() override { Inner->ClearAndDisableTLSCachesOnCurrentThread(); }
+		virtual void GetAllocatorStats(FGenericMemoryStats& outStats) override { Inner->GetAllocatorStats(outStats); }
+		virtual void DumpAllocatorStats(FOutputDevice& ar) override { Inner->DumpAllocatorStats(ar); }
+		virtual bool IsInternallyThreadSafe() const override { return true; }
+		virtual bool ValidateHeap() override { return Inner->ValidateHeap(); }
+		virtual const TCHAR* GetDescriptiveName() override { return Inner->GetDescriptiveName(); }
+
+		// Game thread only, between frames.
+		void Install()
+		{
+			if (GMalloc == this) return;
+
+			// Let the render thread and async loading go idle, then publish the swap with a full barrier. A thread that
+			// read GMalloc just before still allocates from the same heap, it's just not counted.
+			FlushRenderingCommands();
+			FlushAsyncLoading();
+
+			Inner = GMalloc;
+			FPlatformAtomics::InterlockedExchangePtr((void**)&GMalloc, this);
+		}
+
+		void Uninstall()
+		{
+			if (GMalloc == this)
+				FPlatformAtomics::InterlockedExchangePtr((void**)&GMalloc, Inner);
+		}
+
+	private:
+		void Count(void* ptr)
+		{
+			if (!ptr) return;
+
+			Allocations.Increment();
+			SIZE_T size = 0;
+
+			if (Inner->GetAllocationSize(ptr, size))
+			{
+				AllocatedBytes.Add((int64)size);
+				NetBytes.Add((int64)size);
+			}
+		}
+
+		// Blocks from before we were installed are uncounted too, so NetBytes can go negative. Deltas are still right.
+		void Uncount(void* ptr)
+		{
+			SIZE_T size = 0;
+
+			if (ptr && Inner->GetAllocationSize(ptr, size))
+				NetBytes.Subtract((int64)size);
+		}
+	};
+
+	static FCountingMalloc& GetCountingMalloc()
+	{
+		// FMalloc news with the system allocator, so this doesn't go through GMalloc.
+		static FCountingMalloc* countingMalloc = new FCountingMalloc();
+		return *countingMalloc;
+	}
+
+	struct FSample
+	{
+		int32 Agents = 0;
+		int32 Frames = 0;
+		double FrameMs = 0.0;
+		double MaxFrameMs = 0.0;
+		double GameThreadMs = 0.0;
+		double MatcherMs = 0.0;
+		double SearchMs = 0.0;
+		double AllocationsPerFrame = 0.0;
+		double AllocatedKBPerFrame = 0.0;
+		double MemoryPerAgentKB = 0.0;
+		double NodeMemoryPerAgentKB = 0.0;
+		double MemoryGrowthKB = 0.0;
+		int32 MaxBudgetLevel = 0;
+	};
+
+	// State shared by the latent commands of one wave.
+	struct FWave
+	{
+		TWeakObjectPtr<UClass> CharacterClass;
+		int32 NumAgents = 0;
+		int32 MeasuredFrames = 300;
+
+		TWeakObjectPtr<UWorld> World;
+		TArray<TWeakObjectPtr<ACharacter>> Agents;
+		FSample Sample;
+		int32 Frame = 0;
+		double LastFrameTime = 0.0;
+		float Elapsed = 0.f;
+		int64 NetBytesBeforeSpawn = 0;
+		int64 NetBytesAtCountStart = 0;
+		int64 AllocationsAtCountStart = 0;
+		int64 AllocatedBytesAtCountStart = 0;
+		bool bFailed = false;
+
+		void Spawn();
+		bool Tick();
+		void Destroy();
+		void Finish(FAutomationTestBase& test);
+
+	private:
+		void DriveAgents(float time);
+		void EndCount();
+		void EndMeasure();
+	};
+
+	static UWorld* FindGameWorld()
+	{
+		for (const FWorldContext& context : GEngine->GetWorldContexts())
+		{
+			if ((context.WorldType == EWorldType::Game || context.WorldType == EWorldType::PIE) && context.World())
+				return context.World();
+		}
+
+		return nullptr;
+	}
+
+	void FWave::Spawn()
+	{
+		UWorld* world = FindGameWorld();
+
+		if (!world || !CharacterClass.IsValid())
+		{
+			bFailed = true;
+			return;
+		}
+
+		World = world;
+		Sample.Agents = NumAgents;
+
+		FCountingMalloc& counter = GetCountingMalloc();
+		counter.Install();
+		NetBytesBeforeSpawn = counter.NetBytes.GetValue();
+
+		const int32 columns = FMath::CeilToInt(FMath::Sqrt((float)NumAgents));
+
+		FActorSpawnParameters spawnParams;
+		spawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+		for (int32 i = 0; i != NumAgents; ++i)
+		{
+			const FVector location((i % columns) * SpawnSpacing, (i / columns) * SpawnSpacing, 100.f);
+
+			if (ACharacter* character = world->SpawnActor<ACharacter>(CharacterClass.Get(), location, FRotator::ZeroRotator, spawnParams))
+			{
+				// Movement input is only consumed by controlled pawns.
+				if (!character->GetController())
+					character->SpawnDefaultController();
+
+				Agents.Add(character);
+			}
+		}
+
+		UE_LOG(LogTemp, Display, TEXT("PoseMatch.Soak: spawned %d of %d agents."), Agents.Num(), NumAgents);
+	}
+
+	// One frame. Returns true once the wave is measured.
+	bool FWave::Tick()
+	{
+		UWorld* world = World.Get();
+
+		if (bFailed || !world || !CharacterClass.IsValid())
+		{
+			bFailed = true;
+			return true;
+		}
+
+		const double now = FPlatformTime::Seconds();
+		const double frameMs = (LastFrameTime > 0.0) ? (now - LastFrameTime) * 1000.0 : 0.0;
+		const float deltaTime = world->GetDeltaSeconds();
+		LastFrameTime = now;
+		Elapsed += deltaTime;
+
+		DriveAgents(Elapsed);
+		Frame++;
+
+		if (Frame <= WarmupFrames)
+		{
+			if (Frame == WarmupFrames)
+			{
+				const FCountingMalloc& counter = GetCountingMalloc();
+				NetBytesAtCountStart = counter.NetBytes.GetValue();
+				AllocationsAtCountStart = counter.Allocations.GetValue();
+				AllocatedBytesAtCountStart = counter.AllocatedBytes.GetValue();
+			}
+
+			return false;
+		}
+
+		// Counted, untimed.
+		if (Frame <= WarmupFrames + CountedFrames)
+		{
+			if (Frame == WarmupFrames + CountedFrames)
+				EndCount();
+
+			return false;
+		}
+
+		Sample.Frames++;
+		Sample.FrameMs += frameMs;
+		Sample.MaxFrameMs = FMath::Max(Sample.MaxFrameMs, frameMs);
+		Sample.GameThreadMs += FPlatformTime::ToMilliseconds(GGameThreadTime);
+
+		if (const UMotionMatchingBudgetSubsystem* budget = world->GetSubsystem<UMotionMatchingBudgetSubsystem>())
+		{
+			Sample.MatcherMs += budget->GetLastFrameUpdateMs();
+			Sample.SearchMs += budget->GetLastFrameSearchMs();
+			Sample.MaxBudgetLevel = FMath::Max(Sample.MaxBudgetLevel, budget->GetLevel());
+		}
+
+		if (Frame == WarmupFrames + CountedFrames + MeasuredFrames)
+		{
+			EndMeasure();
+			return true;
+		}
+
+		return false;
+	}
+
+	void FWave::EndCount()
+	{
+		FCountingMalloc& counter = GetCountingMalloc();
+		const double numAgents = FMath::Max(Sample.Agents, 1);
+
+		Sample.AllocationsPerFrame = (counter.Allocations.GetValue() - AllocationsAtCountStart) / (double)CountedFrames;
+		Sample.AllocatedKBPerFrame = (counter.AllocatedBytes.GetValue() - AllocatedBytesAtCountStart) / 1024.0 / CountedFrames;
+		Sample.MemoryPerAgentKB = (NetBytesAtCountStart - NetBytesBeforeSpawn) / 1024.0 / numAgents;
+		Sample.MemoryGrowthKB = (counter.NetBytes.GetValue() - NetBytesAtCountStart) / 1024.0;
+
+		// The timed frames run on the stock allocator.
+		counter.Uninstall();
+	}
+
+	void FWave::EndMeasure()
+	{
+		const double frames = FMath::Max(Sample.Frames, 1);
+		const double numAgents = FMath::Max(Sample.Agents, 1);
+
+		Sample.FrameMs /= frames;
+		Sample.GameThreadMs /= frames;
+		Sample.MatcherMs /= frames;
+		Sample.SearchMs /= frames;
+
+		// Interfaces aren't outered to their character, find ours through the pairing.
+		TSet<const ACharacter*> agentSet;
+		SIZE_T nodeBytes = 0;
+
+		for (const TWeakObjectPtr<ACharacter>& agent : Agents)
+			agentSet.Add(agent.Get());
+
+		for (TObjectIterator<UMotionMatcherInterface> it; it; ++it)
+		{
+			if (agentSet.Contains(it->GetCharacter()))
+				nodeBytes += it->GetNodeMemoryFootprint();
+		}
+
+		Sample.NodeMemoryPerAgentKB = nodeBytes / 1024.0 / numAgents;
+	}
+
+	void FWave::Destroy()
+	{
+		for (const TWeakObjectPtr<ACharacter>& agent : Agents)
+		{
+			if (!agent.IsValid()) continue;
+
+			if (AController* controller = agent->GetController())
+				controller->Destroy();
+
+			agent->Destroy();
+		}
+
+		Agents.Reset();
+		GetCountingMalloc().Uninstall();
+	}
+
+	// Deterministic per agent: walk/run in slowly turning circles, stop for a second every few seconds.
+	void FWave::DriveAgents(float time)
+	{
+		for (int32 i = 0; i != Agents.Num(); ++i)
+		{
+			ACharacter* agent = Agents[i].Get();
+
+			if (!agent) continue;
+
+			const float period = 4.f + (i % 5);
+			const bool bStopped = FMath::Fmod(time + i * 0.37f, period) > period - 1.f;
+
+			if (bStopped) continue;
+
+			const float heading = time * (20.f + (i % 7) * 10.f) * ((i % 2) ? 1.f : -1.f) + i * 47.f;
+			const FVector direction = FRotator(0.f, heading, 0.f).Vector();
+			const float scale = (i % 3 == 0) ? 0.5f : 1.f;
+
+			agent->AddMovementInput(direction, scale);
+		}
+	}
+
+	void FWave::Finish(FAutomationTestBase& test)
+	{
+		Destroy();
+
+		if (bFailed)
+		{
+			test.AddError(TEXT("No game world or character class, run with -game and -MMSoakClass=<character class path>."));
+			return;
+		}
+
+		const double numAgents = FMath::Max(Sample.Agents, 1);
+
+		test.AddInfo(FString::Printf(TEXT("%4d agents: frame %.2f ms (max %.2f), game thread %.2f ms, matcher %.3f ms (%.1f us/agent), search %.3f ms, ")
+			TEXT("%.1f allocations (%.1f KB)/frame, memory %.1f KB/agent (node %.1f KB), growth %.1f KB, budget level %d"),
+			Sample.Agents, Sample.FrameMs, Sample.MaxFrameMs, Sample.GameThreadMs, Sample.MatcherMs, Sample.MatcherMs * 1000.0 / numAgents,
+			Sample.SearchMs, Sample.AllocationsPerFrame, Sample.AllocatedKBPerFrame, Sample.MemoryPerAgentKB, Sample.NodeMemoryPerAgentKB,
+			Sample.MemoryGrowthKB, Sample.MaxBudgetLevel));
+
+		FString json;
+		TSharedRef<TJsonWriter<>> writer = TJsonWriterFactory<>::Create(&json);
+
+		writer->WriteObjectStart();
+		writer->WriteValue(TEXT("engine"), FEngineVersion::Current().ToString());
+		writer->WriteValue(TEXT("date"), FDateTime::UtcNow().ToIso8601());
+		writer->WriteValue(TEXT("class"), CharacterClass.IsValid() ? CharacterClass->GetPathName() : FString());
+		writer->WriteValue(TEXT("frames"), Sample.Frames);
+		writer->WriteValue(TEXT("agents"), Sample.Agents);
+		writer->WriteValue(TEXT("frameMs"), Sample.FrameMs);
+		writer->WriteValue(TEXT("maxFrameMs"), Sample.MaxFrameMs);
+		writer->WriteValue(TEXT("gameThreadMs"), Sample.GameThreadMs);
+		writer->WriteValue(TEXT("matcherMs"), Sample.MatcherMs);
+		writer->WriteValue(TEXT("searchMs"), Sample.SearchMs);
+		writer->WriteValue(TEXT("allocationsPerFrame"), Sample.AllocationsPerFrame);
+		writer->WriteValue(TEXT("allocatedKBPerFrame"), Sample.AllocatedKBPerFrame);
+		writer->WriteValue(TEXT("memoryPerAgentKB"), Sample.MemoryPerAgentKB);
+		writer->WriteValue(TEXT("nodeMemoryPerAgentKB"), Sample.NodeMemoryPerAgentKB);
+		writer->WriteValue(TEXT("memoryGrowthKB"), Sample.MemoryGrowthKB);
+		writer->WriteValue(TEXT("maxBudgetLevel"), Sample.MaxBudgetLevel);
+		writer->WriteObjectEnd();
+		writer->Close();
+
+		const FString path = FPaths::ProfilingDir() / TEXT("MotionMatching") / FString::Printf(TEXT("Soak-%d-%s.json"), Sample.Agents, *FDateTime::Now().ToString());
+
+		if (FFileHelper::SaveStringToFile(json, *path))
+			UE_LOG(LogTemp, Display, TEXT("PoseMatch.Soak results written to %s"), *path);
+	}
+
+	DEFINE_LATENT_AUTOMATION_COMMAND_ONE_PARAMETER(FSpawnWaveCommand, TSharedRef<FWave>, Wave);
+
+	bool FSpawnWaveCommand::Update()
+	{
+		Wave->Spawn();
+		return true;
+	}
+
+	DEFINE_LATENT_AUTOMATION_COMMAND_ONE_PARAMETER(FMeasureWaveCommand, TSharedRef<FWave>, Wave);
+
+	bool FMeasureWaveCommand::Update()
+	{
+		return Wave->Tick();
+	}
+
+	DEFINE_LATENT_AUTOMATION_COMMAND_TWO_PARAMETER(FFinishWaveCommand, TSharedRef<FWave>, Wave, FAutomationTestBase*, Test);
+
+	bool FFinishWaveCommand::Update()
+	{
+		Wave->Finish(*Test);
+		return true;
+	}
+}
+
+IMPLEMENT_COMPLEX_AUTOMATION_TEST(FMotionMatchingSoakTest, "PoseMatch.Soak", EAutomationTestFlags::ClientContext | EAutomationTestFlags::StressFilter)
+
+void FMotionMatchingSoakTest::GetTests(TArray<FString>& OutBeautifiedNames, TArray<FString>& OutTestCommands) const
+{
+	FString agentsArg = TEXT("10,100,500");
+
+	// Don't stop on the commas of the list.
+	FParse::Value(FCommandLine::Get(), TEXT("MMSoakAgents="), agentsArg, false);
+
+	TArray<FString> agentsList;
+	agentsArg.ParseIntoArray(agentsList, TEXT(","));
+
+	for (const FString& count : agentsList)
+	{
+		const int32 numAgents = FMath::Max(FCString::Atoi(*count), 1);
+		OutBeautifiedNames.Add(FString::Printf(TEXT("%d Agents"), numAgents));
+		OutTestCommands.Add(FString::FromInt(numAgents));
+	}
+}
+
+bool FMotionMatchingSoakTest::RunTest(const FString& Parameters)
+{
+	using namespace MotionMatchingSoakTest;
+
+	FString className;
+	FString mapName;
+	int32 frames = 300;
+
+	FParse::Value(FCommandLine::Get(), TEXT("MMSoakClass="), className);
+	FParse::Value(FCommandLine::Get(), TEXT("MMSoakMap="), mapName);
+	FParse::Value(FCommandLine::Get(), TEXT("MMSoakFrames="), frames);
+
+	UClass* characterClass = className.IsEmpty() ? nullptr : LoadClass<ACharacter>(nullptr, *className);
+
+	if (!characterClass)
+	{
+		AddError(TEXT("PoseMatch.Soak needs -MMSoakClass=<character blueprint class path>."));
+		return false;
+	}
+
+	if (!mapName.IsEmpty())
+		AutomationOpenMap(mapName);
+
+	TSharedRef<FWave> wave = MakeShared<FWave>();
+	wave->CharacterClass = characterClass;
+	wave->NumAgents = FMath::Max(FCString::Atoi(*Parameters), 1);
+	wave->MeasuredFrames = FMath::Max(frames, 1);
+
+	ADD_LATENT_AUTOMATION_COMMAND(FSpawnWaveCommand(wave));
+	ADD_LATENT_AUTOMATION_COMMAND(FMeasureWaveCommand(wave));
+	ADD_LATENT_AUTOMATION_COMMAND(FFinishWaveCommand(wave, this));
+	return true;
+}
+
+#endif
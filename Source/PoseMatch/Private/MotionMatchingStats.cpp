@@ -0,0 +1,30 @@
+// Copyright Wild Montage, LLC. All Rights Reserved.
+
+#include "MotionMatchingStats.h"
+
+DEFINE_STAT(STAT_MMUpdate);
+DEFINE_STAT(STAT_MMEvaluate);
+DEFINE_STAT(STAT_MMTrajectory);
+DEFINE_STAT(STAT_MMPastHistory);
+DEFINE_STAT(STAT_MMEvaluatePoseSample);
+DEFINE_STAT(STAT_MMNormalization);
+DEFINE_STAT(STAT_MMMatch);
+DEFINE_STAT(STAT_MMIndexSearch);
+DEFINE_STAT(STAT_MMRootMotionWarping);
+DEFINE_STAT(STAT_MMFootLock);
+DEFINE_STAT(STAT_MMCrowdStep);
+
+DEFINE_STAT(STAT_MMSearches);
+DEFINE_STAT(STAT_MMSearchesSkipped);
+DEFINE_STAT(STAT_MMPosesScanned);
+DEFINE_STAT(STAT_MMPosesPruned);
+DEFINE_STAT(STAT_MMTransitions);
+DEFINE_STAT(STAT_MMPoseCacheHits);
+DEFINE_STAT(STAT_MMPoseCacheMisses);
+DEFINE_STAT(STAT_MMTransitionsPerSecond);
+
+DEFINE_STAT(STAT_MMBudgetLevel);
+DEFINE_STAT(STAT_MMBudgetSearchMs);
+DEFINE_STAT(STAT_MMGroundProbes);
+
+UE_TRACE_CHANNEL_DEFINE(MotionMatchingChannel);
@@ -0,0 +1,51 @@
+// Copyright Wild Montage, LLC. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Stats/Stats.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+
+//
+// Performance profiling. Enter in console "stat motionmatching" to display perf data. "stat none" to disable.
+// Every MM_SCOPE_CYCLE_COUNTER also shows up in Unreal Insights when tracing with -trace=cpu,MotionMatching.
+//
+
+DECLARE_STATS_GROUP(TEXT("MotionMatching"), STATGROUP_MotionMatching, STATCAT_Advanced);
+
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Update"), STAT_MMUpdate, STATGROUP_MotionMatching, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Evaluate"), STAT_MMEvaluate, STATGROUP_MotionMatching, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Trajectory Build"), STAT_MMTrajectory, STATGROUP_MotionMatching, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Past History"), STAT_MMPastHistory, STATGROUP_MotionMatching, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Evaluate Pose Sample"), STAT_MMEvaluatePoseSample, STATGROUP_MotionMatching, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Normalization"), STAT_MMNormalization, STATGROUP_MotionMatching, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Match"), STAT_MMMatch, STATGROUP_MotionMatching, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Index Search"), STAT_MMIndexSearch, STATGROUP_MotionMatching, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Root Motion Warping"), STAT_MMRootMotionWarping, STATGROUP_MotionMatching, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Foot Lock"), STAT_MMFootLock, STATGROUP_MotionMatching, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Crowd Step"), STAT_MMCrowdStep, STATGROUP_MotionMatching, );
+
+// Totals of the current frame. Counter stats are cleared every frame, accumulators never are.
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Searches"), STAT_MMSearches, STATGROUP_MotionMatching, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Searches Skipped"), STAT_MMSearchesSkipped, STATGROUP_MotionMatching, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Poses Scanned"), STAT_MMPosesScanned, STATGROUP_MotionMatching, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Poses Pruned"), STAT_MMPosesPruned, STATGROUP_MotionMatching, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Transitions"), STAT_MMTransitions, STATGROUP_MotionMatching, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Pose Cache Hits"), STAT_MMPoseCacheHits, STATGROUP_MotionMatching, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Pose Cache Misses"), STAT_MMPoseCacheMisses, STATGROUP_MotionMatching, );
+
+// Each transition adds 1 / FApp::GetDeltaTime(), so the frame total is the current transition rate.
+DECLARE_FLOAT_COUNTER_STAT_EXTERN(TEXT("Transitions/s"), STAT_MMTransitionsPerSecond, STATGROUP_MotionMatching, );
+
+// Budget governor. See MotionMatchingBudget.h.
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Budget Level"), STAT_MMBudgetLevel, STATGROUP_MotionMatching, );
+DECLARE_FLOAT_COUNTER_STAT_EXTERN(TEXT("Budget Search Time (ms)"), STAT_MMBudgetSearchMs, STATGROUP_MotionMatching, );
+
+// Traces issued by the ground probe. See MotionMatchingGroundProbe.h.
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Ground Probes"), STAT_MMGroundProbes, STATGROUP_MotionMatching, );
+
+UE_TRACE_CHANNEL_EXTERN(MotionMatchingChannel);
+
+#define MM_SCOPE_CYCLE_COUNTER(Stat) \
+	SCOPE_CYCLE_COUNTER(Stat); \
+	TRACE_CPUPROFILER_EVENT_SCOPE_ON_CHANNEL(Stat, MotionMatchingChannel)
@@ -14,6 +14,7 @@
 
 #include "GameFramework/CharacterMovementComponent.h"
 #include "MotionMatcher_Component.h"
+#include "Components/SplineComponent.h"
 
 
 
@@ -84,4 +85,20 @@ FFootLock UPoseMatchBPLibrary::GetFootLockData(UAnimInstance* AnimInstance)
 UMotionMatcherInterface* UPoseMatchBPLibrary::CreateMotionMatcherInterface()
 {
 	return NewObject<UMotionMatcherInterface>();
-}
\ No newline at end of file
+}
+TArray<FVector> UPoseMatchBPLibrary::GetSplinePathPoints(const USplineComponent* Spline, float Spacing)
+{
+	TArray<FVector> points;
+
+	if (!Spline) return points;
+
+	const float length = Spline->GetSplineLength();
+	const int32 numSegments = FMath::Max(FMath::CeilToInt(length / FMath::Max(Spacing, 1.f)), 1);
+
+	points.Reserve(numSegments + 1);
+
+	for (int32 i = 0; i <= numSegments; ++i)
+		points.Add(Spline->GetLocationAtDistanceAlongSpline(length * i / numSegments, ESplineCoordinateSpace::World));
+
+	return points;
+}
@@ -1,4 +1,7 @@
 #include "RootMotionSource_Custom.h"
+#include "GameFramework/CharacterMovementComponent.h"
+
+#include "Spring/Spring.h"
 
 FRootMotionSource_Custom::FRootMotionSource_Custom()
 {
@@ -16,3 +19,52 @@ UScriptStruct* FRootMotionSource_Custom::GetScriptStruct() const
 {
 	return FRootMotionSource_Custom::StaticStruct();
 }
+
+static float InterpFacing(float desired)
+{
+	float newSpeed = (desired < 0.0f) ? -180.f : 180.f;
+	const float AngleTolerance = 0.1f;
+
+	if (FMath::IsNearlyEqual(desired, 0.0f, AngleTolerance))
+	{
+		newSpeed = 0.0f;
+	}
+
+	float inputDerived = desired * 2.0f;
+	newSpeed = FMath::Lerp(newSpeed, inputDerived, 0.9f);
+
+	return newSpeed;
+}
+
+void FMotionMatchingRootMotion::Update(const FVector& desiredVector, float desiredFacing, float actorYaw, float deltaTime)
+{
+	const float halfLife = 0.4f; // 0.2f;
+
+	FVector correctedInput = (120.0f * desiredVector).RotateAngleAxis(actorYaw, FVector::UpVector);
+
+	Spring::spring_character_update(X, XVelocity, XAcceleration, correctedInput.X, halfLife, deltaTime);
+	Spring::spring_character_update(Y, YVelocity, YAcceleration, correctedInput.Y, halfLife, deltaTime);
+
+	YawStep = InterpFacing(desiredFacing) * deltaTime;
+}
+
+FTransform FMotionMatchingRootMotion::GetTransform() const
+{
+	FTransform rootT;
+	rootT.SetRotation(FQuat::MakeFromEuler(FVector(0.f, 0.f, YawStep)));
+	rootT.SetLocation(FVector(XVelocity, YVelocity, 0.f));
+
+	return rootT;
+}
+
+uint16 FMotionMatchingRootMotion::AddSource(UCharacterMovementComponent& moveComp)
+{
+	TSharedPtr<FRootMotionSource_Custom> customRootMotion = MakeShared<FRootMotionSource_Custom>();
+	customRootMotion->InstanceName = "MM_ROOT_WARPING";
+	customRootMotion->AccumulateMode = ERootMotionAccumulateMode::Override;
+	customRootMotion->Priority = 500;
+	customRootMotion->bInLocalSpace = false;
+	customRootMotion->Settings.SetFlag(ERootMotionSourceSettingsFlags::IgnoreZAccumulate);
+
+	return moveComp.ApplyRootMotionSource(customRootMotion);
+}
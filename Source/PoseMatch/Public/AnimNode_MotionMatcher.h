@@ -3,9 +3,18 @@
 #pragma once
 #include "Animation/AnimNodeBase.h"
 #include "MotionData.h"
+#include "Core/MMCoreTrajectory.h"
+#include "MotionMatchingInertialization.h"
+#include "MotionMatchingFootLock.h"
+#include "MotionMatchingPath.h"
 #include "AnimNode_PoseWatcher.h"
+#include "MotionMatcherInterface.h"
+#include "MotionMatchingBudget.h"
+#include "MotionMatchingFixedStep.h"
+#include "MotionMatchingGroundProbe.h"
+#include "MotionMatchingSearchSchedule.h"
+#include "RootMotionSource_Custom.h"
 #include "Kismet/KismetMathLibrary.h"
-#include "Animation/AnimNode_SequencePlayer.h"
 #include "Animation/AnimNode_Inertialization.h"
 
 #include "AnimNode_MotionMatcher.generated.h"
@@ -32,6 +41,15 @@ struct FMMatcherInput
 
 	UPROPERTY(EditAnywhere, BlueprintReadWrite)
 	bool Aiming;
+
+	/** Optional path to follow in world space, e.g., a navigation path's points. The desired trajectory is sampled from
+	* it instead of predicted, and DesiredVector and DesiredFacing are derived from it (overwriting what was set). */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	TArray<FVector> PathPoints;
+
+	/** Speed along PathPoints in cm/s. 0 is the speed of a full DesiredVector. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	float PathSpeed = 0.f;
 };
 
 struct FPastSnapshot
@@ -52,22 +70,30 @@ struct FMMatcherStatePlayData
 {
 	int32 MatchedStateIndex = 0;
 	int32 MatchedPoseIndex = 0;
-	float MatchedTime = 0.0f;
-
 
 	// The time at which the animation is currently playing.
 	float CurrentPlayTime = 0.0f;
-	int32 CurrentPointIndex = 0;
+
+	// Where the simulation is in the animation. Only moves on steps, CurrentPlayTime is this plus the time not simulated yet.
+	float SimulatedPlayTime = 0.0f;
+
+	float BlendTime = MOTION_MATCHING_BLEND_TIME;
 
 	// Marker tick record for this play through
 	FMarkerTickRecord MarkerTickRecord;
+};
 
-	float CurrentTime = 0.0f;
-	float PlayRate = 0.0f;
-
-	float Cost = 0.0f;
+/**
+ * An older clip of the blend stack, still fading out under the newer ones. See FAnimNode_MotionMatcher::BlendStackLayers.
+ */
+struct FMMatcherBlendLayer
+{
+	int32 StateIndex = 0;
+	float Time = 0.f;
 
-	float BlendTime = MOTION_MATCHING_BLEND_TIME;
+	// Since this clip started fading in, and over how long.
+	float Age = 0.f;
+	float BlendTime = 0.f;
 };
 
 struct FSpringPoint
@@ -82,6 +108,126 @@ struct FInertBlendStates
 	TArray<float> ActiveBlends = {};
 };
 
+/**
+ * Everything a matcher instance reads and writes on every tick, packed together so a crowd of instances
+ * touches as few cache lines as possible. Rarely used data lives in FMMatcherColdState instead.
+ */
+struct FMMatcherHotState
+{
+	FMMatcherStatePlayData currentPlayData;
+
+	float timeSinceLastMatch = 0.f;
+	float timeSinceLastSave = 0.f;
+	float timeSinceLastBlend = 0.f;
+	float lastBestCost = 0.f;
+
+	// Frame time not simulated yet, in fixed step mode.
+	FMotionMatchingFixedStep fixedStep;
+
+	// When to search. See TrajectoryChangeThreshold.
+	FMotionMatchingSearchSchedule searchSchedule;
+
+	// Time warp for candidate error correction
+	float currentTimeScaleWarp = 1.0f;
+
+	// Rotation error warping (steering)
+	float rootRotWarp = 0.f;
+
+	// Steady bias - used to bias looping animations when input is steady.
+	float steadyBias = 0.f;
+
+	float turnSpeed = 0.f;
+
+	// Recommended values for optional IK
+	float ik_left_alpha = 0.f;
+	float ik_right_alpha = 0.f;
+
+	// Furthest point on the desired trajectory.
+	FVector desiredVecA = FVector::ZeroVector;
+	FVector inputSteady = FVector::ZeroVector;
+
+	FVector lastPosition = FVector::ZeroVector;
+	FRotator lastRotation = FRotator::ZeroRotator;
+
+	// Initial component position within the blueprint viewport scene.
+	// Used to fix offsets if the mesh rotated -90 or underground.
+	FVector localMeshCompPos = FVector::ZeroVector;
+
+	// Actor yaw as of the last step. Turn speed is measured between steps.
+	float lastStepYaw = 0.f;
+
+	// Current character velocity in worldspace.
+	FVector currentRootVelocity = FVector::ZeroVector;
+
+	// Character movement spring (root motion warping).
+	FMotionMatchingRootMotion rootMotionSpring;
+
+	// Is the foot currently locked? (Left, right)
+	bool footLocks[2] = { false, false };
+
+	// Feet planted in the animation at the current pose, see FMotionDatabase::GetFootContacts().
+	uint32 poseFootContacts = 0;
+
+	// Did we just switched the animation?
+	bool bAnimChanged = false;
+
+	// Did a search run during this update?
+	bool bSearched = false;
+
+	// Rolling transition rate, see FMotionMatcherTelemetry::TransitionsPerSecond.
+	float transitionsPerSecond = 0.f;
+
+	// What the budget governor allows this update.
+	FMotionMatchingBudgetDecision budgetDecision;
+};
+
+/**
+ * Matcher data that is only touched on rare events (foot lock changes, balancing) or while debugging.
+ * Allocated on initialization so it stays out of the node itself.
+ */
+struct FMMatcherColdState
+{
+	FVector lockedfootPositions[2] = { FVector::ZeroVector, FVector::ZeroVector };
+
+	// Height of the locked feet above the animation's ground. Kept when the lock is put on the probed ground.
+	float lockedFootHeights[2] = { 0.f, 0.f };
+
+	// For IsPointInBalancingArea()
+	FVector2D centerOfMass = FVector2D::ZeroVector;
+
+	bool bAdjustingBalance = false;
+	int lastUnlockedFoot = -1;
+	float timeStandingStill = 0.f;
+
+	// Debug drawing animation.
+	float lerpAlpha = 0.0f;
+	bool bReverse = false;
+
+	// Search statistics. Only written by searches and transitions, the per update fields are filled in when publishing.
+	FMotionMatcherTelemetry telemetry;
+
+#if WITH_EDITOR
+	UDebugWidget* debugWidget = nullptr;
+#endif
+};
+
+/**
+ * Optional parts of the matcher pipeline. Resolved once when the node is initialized (and when bones are cached)
+ * so an instance only pays for what its setup actually uses. E.g., an NPC without a movement component or foot
+ * lock receivers never extracts root motion or converts receiver bones.
+ */
+enum class EMMatcherFeatures : uint8
+{
+	None				= 0,
+	RootMotion			= 1 << 0,	// A character movement component receives our custom root motion.
+	FootLock			= 1 << 1,	// Both feet resolve, so lock states can be sent to the matcher interface.
+	FootLockReceivers	= 1 << 2,	// Both foot lock receiver (virtual) bones resolve.
+	IKCurves			= 1 << 3,	// At least one IK alpha curve name maps to a skeleton curve.
+	CenterOfMass		= 1 << 4,	// The center of mass bone resolves.
+	Logging				= 1 << 5,	// Verbose logging. Only honored when MM_VERBOSE_LOGGING is enabled.
+};
+ENUM_CLASS_FLAGS(EMMatcherFeatures);
+
 USTRUCT(BlueprintInternalUseOnly)
 struct POSEMATCH_API FAnimNode_MotionMatcher : public FAnimNode_Base
 {
@@ -117,6 +263,62 @@ struct POSEMATCH_API FAnimNode_MotionMatcher : public FAnimNode_Base
 	UPROPERTY(EditAnywhere, Category = "Settings", meta = (PinHiddenByDefault))
 	uint8 bDebugMode : 1;
 
+	/** If the motion data's cache sampling rate is this dense (in seconds) or denser, our current pose is snapped to the
+	* nearest cached sample instead of interpolating between two. 0 always interpolates. */
+	UPROPERTY(EditAnywhere, Category = "Settings", meta = (ClampMin = "0.0"))
+	float SnapToNearestSampleRate = 0.f;
+
+	/** Predict the future trajectory with critically damped springs reaching halfway to the desired velocity and facing
+	* in this many seconds. 0 blends from the current to the desired velocity instead. */
+	UPROPERTY(EditAnywhere, Category = "Settings", meta = (ClampMin = "0.0"))
+	float TrajectoryHalfLife = 0.f;
+
+	/** Blend transitions inside this node, by fading out per-bone offsets from the previous pose, instead of through
+	* Inertialization nodes above it. No extra graph nodes needed and transitions are never dropped for lack of a free
+	* blend. Don't combine with Inertialization nodes, they'd no longer be told about transitions anyway. */
+	UPROPERTY(EditAnywhere, Category = "Settings")
+	bool bBuiltInInertialization = false;
+
+	/** Share extracted poses with other characters playing the same clip at (nearly) the same time this frame, instead
+	* of decompressing them again. Clips are sampled at multiples of mm.PoseCache.TimeStep. See FMotionMatchingPoseCache. */
+	UPROPERTY(EditAnywhere, Category = "Settings")
+	bool bUseSharedPoseCache = false;
+
+	/** Put locked feet on the ground under them instead of at the animation's ground height. Every locked foot is
+	* probed with an asynchronous line trace once a frame, in one batch for the whole world, and its lock follows the
+	* hit (height and surface normal, see FFootLock) a frame later. Range is set by mm.GroundProbe.Up/Down. */
+	UPROPERTY(EditAnywhere, Category = "Settings")
+	bool bProbeGround = false;
+
+	UPROPERTY(EditAnywhere, Category = "Settings", meta = (EditCondition = "bProbeGround"))
+	TEnumAsByte<ECollisionChannel> GroundProbeChannel = ECC_Visibility;
+
+	/** Cross-fade the last this many matched clips on transitions, each newer clip fading in over the older ones. Every
+	* layer is evaluated, so the cost grows with it: it's reduced by one layer per LOD level and capped by
+	* mm.BlendStack.MaxLayers. Replaces inertialization (of both kinds) when set. 0 or 1 disables. */
+	UPROPERTY(EditAnywhere, Category = "Settings", meta = (ClampMin = "0", ClampMax = "4"))
+	int32 BlendStackLayers = 0;
+
+	/** Search as soon as the playing animation's future trajectory strays this far from the desired one (mean squared
+	* difference of the normalized points), instead of on a fixed interval. While it stays closer, the time between
+	* searches doubles after each search, up to MaxSearchInterval. 0 always searches on the fixed interval. */
+	UPROPERTY(EditAnywhere, Category = "Settings", meta = (ClampMin = "0.0"))
+	float TrajectoryChangeThreshold = 0.f;
+
+	/** Longest time between searches while the trajectory doesn't change, in seconds. */
+	UPROPERTY(EditAnywhere, Category = "Settings", meta = (ClampMin = "0.0", EditCondition = "TrajectoryChangeThreshold > 0"))
+	float MaxSearchInterval = 0.5f;
+
+	/** Simulate (input smoothing, trajectory prediction, matching and root motion warping) in steps of this many seconds,
+	* independent of the frame rate, so the same input always produces the same searches. 0 steps once per frame.
+	* The pose shown is the last step's plus the time not simulated yet, and budget throttling is disabled. Can be overridden with mm.FixedTimeStep. */
+	UPROPERTY(EditAnywhere, Category = "Settings", meta = (ClampMin = "0.0"))
+	float FixedTimeStep = 0.f;
+
+	/** Most fixed steps simulated in one update. Time beyond that (e.g., after a hitch) is dropped. */
+	UPROPERTY(EditAnywhere, Category = "Settings", meta = (ClampMin = "1", EditCondition = "FixedTimeStep > 0"))
+	int32 MaxFixedSteps = 4;
+
 public:
 	FAnimNode_MotionMatcher();
 
@@ -138,7 +340,21 @@ public:
 	// Gets the currently running state.
 	const int32& GetStateIndex();
 
+	// Approximate number of bytes this instance occupies, including its heap allocations.
+	SIZE_T GetInstanceMemoryFootprint() const;
+
 private:
+	// Advances input smoothing, trajectory prediction, matching and root motion warping by one step.
+	void Simulate(float deltaTime, float actorYaw, UAnimInstance* AnimInstance);
+
+	bool UsesBlendStack() const { return BlendStackLayers > 1; }
+
+	// Evaluates and blends the current clip and the older ones of the blend stack that we can afford.
+	void EvaluateBlendStack(FPoseContext& Output);
+
+	// Whether it's time to search. See TrajectoryChangeThreshold.
+	bool ShouldSearch();
+
 	// Searches in the pose database for a pose with a better motion than the currently playing one.
 	void MatchNow();
 
@@ -152,75 +368,91 @@ private:
 	// Interprets two trajectories as feature vectors in a high-dimensional data space and calculates the squared euclidean distance between them.
 	float TrajDistSquared(const FTrajectory& goal, const FTrajectory& candidate);
 
-	// Interprets two pose samples as feature vectors in a high-dimensional data space and calculates the squared euclidean distance between them.
-	float PoseDistSquared(const FMMatcherPoseSample& goal, const FMMatcherPoseSample& candidate);
-
 	// Use this function to determine whether our center of mass (or a custom point) is out of the balancing area.
 	// If it does, it will return false and you should unlock the nearest foot to the center to regain our balance.
 	bool IsPointInBalancingArea(FVector2D point);
 
 	void UpdateFootLock(float dt, UAnimInstance* animInst);
 
+	// Puts the locked feet on the probed ground and requests the next probes. Once per update, after the steps.
+	void ProbeGround();
 
+	FORCEINLINE bool HasFeature(EMMatcherFeatures feature) const { return EnumHasAnyFlags(Features, feature); }
 
 private:
-	FAnimNode_SequencePlayer SequencePlayerNode;
+	// Pipeline stages this instance actually needs. See EMMatcherFeatures.
+	EMMatcherFeatures Features = EMMatcherFeatures::None;
+
+	// Skeleton curve ids for the IK alpha curves, resolved at initialization instead of every evaluation.
+	SmartName::UID_Type leftIKCurveUID = SmartName::MaxUID;
+	SmartName::UID_Type rightIKCurveUID = SmartName::MaxUID;
+
+	// Compiled version of MotionDataAsset, shared with every other instance using it.
+	FMotionDatabasePtr database;
+
+	// Per-tick state. See FMMatcherHotState.
+	FMMatcherHotState hot;
+
+	// Rarely touched state. See FMMatcherColdState.
+	TSharedPtr<FMMatcherColdState> cold;
 
 	// Used to setup stuff that can't be set up in the initializer.
 	bool bFirstUpdate = true;
 
-	// Initial component position within the blueprint viewport scene.
-	// Used to fix offsets if the mesh rotated -90 or underground.
-	FVector localMeshCompPos;
+	bool bHasValidMotionData = false;
 
-	// Initial component rotation within the blueprint viewport scene.
-	FVector localMeshCompRot;
+	// Resolved from SnapToNearestSampleRate at initialization.
+	bool bSnapToNearestSample = false;
 
-	FTransform csToWs;
+	// Initial component yaw within the blueprint viewport scene.
+	float localMeshCompYaw = 0.f;
 
-	// Inverted transform that can be used to convert between component space and other spaces. TODO!
-	FTransform componentDeltaTransform;
+	// The id of the custom root motion source that moves the actor.
+	uint16 RootMotionSourceID;
 
-	// Interface class to communicate between this anim node and the anim blueprint
-	UMotionMatcherInterface* mmInterface = nullptr;
+	AActor* owningActor = nullptr;
 
 	// The character movement component so we can override its root motion.
 	UCharacterMovementComponent* moveComp = nullptr;
 
-	// List of connected inertialization nodes that we can use for blending between animations.
-	TArray<FInertBlendStates> inertializationNodes;
+	// Receives the smoothed foot locks along with MotionMatcherInterface, if the actor has one.
+	UMotionMatcherComponent* footLockComponent = nullptr;
 
 	// Connected anim node that saves our bone pose after inertialization for better pose matching.
 	FAnimNode_PoseWatcher* poseWatcher = nullptr;
 
-	// Did we just switched the animation?
-	bool bAnimChanged = false;
+	// Budget governor of our world. Null outside game worlds.
+	UMotionMatchingBudgetSubsystem* budget = nullptr;
 
-	// Time warp for candidate error correction
-	float currentTimeScaleWarp = 1.0f;
+	// Ground probe of our world when bProbeGround is set.
+	UMotionMatchingGroundProbeSubsystem* groundProbe = nullptr;
 
-	// Recommended values for optional IK
-	float ik_left_alpha = 0.f;
-	float ik_right_alpha = 0.f;
+	// List of connected inertialization nodes that we can use for blending between animations.
+	TArray<FInertBlendStates> inertializationNodes;
 
-	TArray<FBoneReference> footLockReceivers;
-	TArray<FBoneReference> footLockFeet;
+	// Blending when bBuiltInInertialization is set.
+	FMotionMatchingInertialization inertialization;
 
+	// Foot lock smoothing for MotionMatcherInterface and footLockComponent.
+	FMotionMatchingFootLock footLock;
 
+	// Most layers of a blend stack, the current clip included.
+	static constexpr int32 MaxBlendStackLayers = 4;
 
+	// Older clips of the blend stack, oldest first. The current clip is the layer on top.
+	TArray<FMMatcherBlendLayer, TInlineAllocator<MaxBlendStackLayers - 1>> blendStack;
 
-	//FFootLock currentFootLock;
+	// Scratch row for EvaluatePoseSample(). Kept around to avoid reallocating every tick.
+	TArray<float> sampleRow;
 
-	// Here we keep a copy of the bones that are used for pose matching.
-	// Every bone needs to be initialized with the current LOD bone cache so we
-	// have to keep it separate from other instances of this MotionDataAsset.
-	TArray<FBoneReference> PoseMatchingBones;
+	// Used when TrajectoryHalfLife is set. Initialized on first use.
+	MMCore::SpringTrajectoryPredictor trajectoryPredictor;
 
-	FVector rootBonePos;
-	FVector rootBoneVel;
+	// Input.PathPoints in character space, as of this frame's update.
+	FMotionMatchingPath path;
 
-	FMMatcherStatePlayData currentPlayData;
-	FMMatcherStatePlayData nextPlayData;
+	// Scratch search query for MatchNow().
+	TArray<float> searchQuery;
 
 	// This is the currently evaluated pose from our database.
 	// It's what we match against during motion matching.
@@ -230,119 +462,15 @@ private:
 	// It is constantly up-to-date and used for motion matching.
 	TArray<FTrajectoryPoint> desiredTrajectory;
 
-	// This tiny thing is used to quickly remember when is the first future trajectory point in the trajectory timings array.
-	int32 firstFutureTrajectoryTiming;
-
-	// Furthest future timing. Typically 1 second into the future.
-	float lastTrajectoryTime;
-
 	// Trajectory history. Recorded in realtime.
 	TArray<FPastSnapshot> pastHistory;
 
+	TArray<FBoneReference> footLockReceivers;
+	TArray<FBoneReference> footLockFeet;
 
-	float timeSinceLastSave;
-	float maxHistoryLength;
-	float snapshotAge;
-	FVector currentPos;
-	FVector previousPos;
-
-	// Furthest point on the desired trajectory.
-	FVector desiredVecA = FVector::ZeroVector;
-	float desiredFacing = 0.0f;
-
-	FFloatSpringState facingSpringState;
-
-	// 
-	// Steady bias - used to bias looping animations when input is steady.
-	//
-
-	FVector inputSteady;
-	float steadyBias;
-
-	// How sure are we that we are stopping? Used to multiply stopping bias. (0.0f <-> 1.0f)
-	float stoppingCertainty = 0.0f;
-
-	FVector avgInputDir;
-
-	FVector lastInputVec;
-	FVectorSpringState SpringState;
-
-	FVector lastPosition;
-	FRotator lastRotation = FRotator();
-
-	// Current character velocity in worldspace.
-	FVector currentRootVelocity;
-
-	FRotator lastRot;
-
-	float yawStep = 0.0f;
-	float turnSpeed = 0.f;
-	float lastYaw = 0.f;
-
-	AActor* owningActor;
-
-	// The id of the custom root motion source that moves the actor.
-	uint16 RootMotionSourceID;
-
-
-	float timeSinceLastMatch;
-	float timeSinceLastBlend = 0.0f;
-	float lastBestCost;
-
-	bool bHasValidMotionData = false;
-
-	FRotator rotDiff;
-	FTransform rootMotion;
-
-	bool bIsLeftFootLocked = false;
-	bool bIsRightFootLocked = false;
-	FVector lastLFootLockedPos = FVector::ZeroVector;
-	FVector lastRFootLockedPos = FVector::ZeroVector;
-	TArray<bool> footLocks = { false, false };
-	TArray<FVector> lockedfootPositions = { FVector::ZeroVector, FVector::ZeroVector };
-
-	bool bAdjustingBalance = false;
-	int lastUnlockedFoot = -1;
-	float timeSinceLock = 0.f;
-
-	float timeStandingStill = 0.f;
-
-	float lerpAlpha = 0.0f;
-	bool bReverse = false;
-
-	enum
-	{
-		TRAJ_MAX = 32,
-		TRAJ_SUB = 4,
-		PRED_MAX = 4,
-		PRED_SUB = 4,
-	};
-
-	float trajx_prev[TRAJ_MAX];
-	float trajy_prev[TRAJ_MAX];
-
-	float predx[PRED_MAX], predy[PRED_MAX];
-	float predxv[PRED_MAX], predyv[PRED_MAX];
-	float predxa[PRED_MAX], predya[PRED_MAX];
-
-
-	float trajx = 0.0f;
-	float trajy = 0.0f;
-	float trajxv = 0.0f, trajyv = 0.0f;
-	float trajxa = 0.0f, trajya = 0.0f;
-	float traj_xv_goal = 0.0f;
-	float traj_yv_goal = 0.0f;
-
-	float rootRotWarp = 0.f;
-
-	// For IsPointInBalancingArea()
 	FBoneReference CenterOfMassBone;
-	FTransform CenterOfMassBoneTransform;
-	FVector2D centerOfMass;
 
 #if WITH_EDITOR
-	UDebugWidget* debugWidget;
-	bool bDebugVisible = false;
 	void DrawDebug(const FAnimationUpdateContext& context);
 	void DrawTrajectory(const FAnimationUpdateContext& context, const TArray<FTrajectoryPoint>& trajectory, FColor color);
 	void DrawBoneData(const FAnimationUpdateContext& context, const TArray<FMMatcherBoneData>& bones, FColor color);
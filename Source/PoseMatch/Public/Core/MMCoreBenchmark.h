@@ -0,0 +1,56 @@
+// Copyright Wild Montage, LLC. All Rights Reserved.
+
+#pragma once
+
+#include "MMCoreSearch.h"
+
+#include <string>
+#include <vector>
+
+namespace MMCore
+{
+	/**
+	 * Search microbenchmark settings. Every database size gets its own synthetic database, and every backend runs the
+	 * same queries against it.
+	 */
+	struct BenchmarkParams
+	{
+		std::vector<int32_t> PoseCounts = { 1000, 10000, 100000 };
+		int32_t NumBones = 3;
+		int32_t NumTrajectoryPoints = 5;
+		int32_t NumQueries = 500;
+		int32_t NumStates = 50;
+		// Untimed passes over the queries before each backend is timed, so no backend pays for cold caches.
+		int32_t WarmupPasses = 1;
+	};
+
+	struct BackendBenchmark
+	{
+		SearchBackend Backend = SearchBackend::BruteForce;
+		double UsPerQuery = 0.0;
+		// Relative to BruteForce.
+		double Speedup = 0.0;
+		double PosesScannedPerQuery = 0.0;
+		double PosesPrunedPerQuery = 0.0;
+		// Share of queries with the same winner as BruteForce.
+		double Agreement = 0.0;
+	};
+
+	struct DatabaseBenchmark
+	{
+		int32_t NumPoses = 0;
+		int32_t SearchDims = 0;
+		double Megabytes = 0.0;
+		double IndexBuildMs = 0.0;
+		double QueryBuildUs = 0.0;
+		std::vector<BackendBenchmark> Backends;
+		// Stats and normalization of every search feature, with the core functions the motion cache builder uses.
+		double NormalizationMs = 0.0;
+	};
+
+	// Runs the benchmark on every database size. Slow for large databases, takes seconds.
+	std::vector<DatabaseBenchmark> RunBenchmark(const BenchmarkParams& params);
+
+	// Results as JSON, tagged with what they were built with (engine version, compiler, ...) and when they were run.
+	std::string BenchmarkToJson(const BenchmarkParams& params, const std::vector<DatabaseBenchmark>& results, const std::string& build, const std::string& date);
+}
@@ -0,0 +1,30 @@
+// Copyright Wild Montage, LLC. All Rights Reserved.
+
+#pragma once
+
+#include "MMCoreTypes.h"
+
+namespace MMCore
+{
+	/**
+	 * Thresholds for telling a planted foot from a moving one.
+	 * The foot has to slow down below EnterSpeed to plant and speed up past ExitSpeed to lift again, so a foot hovering
+	 * around one threshold doesn't flicker between the two.
+	 */
+	struct ContactParams
+	{
+		// cm/s.
+		float EnterSpeed = 15.f;
+		float ExitSpeed = 30.f;
+
+		// Above the lowest point of the foot over the whole track, in cm. Never planted higher than that. 0 disables the test.
+		float MaxHeight = 10.f;
+	};
+
+	/**
+	 * Contact detection over a baked foot track: numKeys xyz positions (z up, animation space), keyInterval seconds apart.
+	 * Writes one 0/1 contact per key to outContacts. Speeds and heights are computed in one straight pass over the keys,
+	 * hysteresis in a second one.
+	 */
+	void DetectContacts(const float* positions, int32_t numKeys, float keyInterval, const ContactParams& params, uint8_t* outContacts);
+}
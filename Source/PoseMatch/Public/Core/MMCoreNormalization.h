@@ -0,0 +1,39 @@
+// Copyright Wild Montage, LLC. All Rights Reserved.
+
+#pragma once
+
+#include "MMCoreTypes.h"
+
+namespace MMCore
+{
+	/**
+	 * Mean and standard deviation of a feature, pooled over its components (e.g., xyz of a bone position share one set).
+	 */
+	struct FeatureStats
+	{
+		double Count = 0.0;
+		double Mean = 0.0;
+		double Variance = 0.0;
+		double StandardDeviation = 1.0;
+	};
+
+	/**
+	 * Computes stats of columns [column, column + width) over numRows rows of stride floats.
+	 * A zero variance falls back to a standard deviation of 1 so the feature stays finite.
+	 */
+	FeatureStats ComputeFeatureStats(const float* rows, int32_t numRows, int32_t stride, int32_t column, int32_t width);
+
+	// Turns stats and a user weight into a normal.
+	FeatureNormal MakeFeatureNormal(double mean, double standardDeviation, float weight);
+
+	// Normalizes width columns of every row in place.
+	void NormalizeColumns(float* rows, int32_t numRows, int32_t stride, int32_t column, int32_t width, const FeatureNormal& normal);
+
+	/**
+	 * Writes a layout.SearchDims query. Bone features are copied from poseRow (normally the playing pose, already normalized),
+	 * root velocity (xyz) and trajectory (xyz positions, facings) are normalized from raw character-space values.
+	 */
+	void BuildQuery(const FeatureLayout& layout, const FeatureNormal& rootVelocityNormal, const FeatureNormal* trajectoryPositionNormals,
+		const FeatureNormal* trajectoryFacingNormals, const float* poseRow, const float* rootVelocity, const float* trajectoryPositions,
+		const float* trajectoryFacings, float* outQuery);
+}
@@ -0,0 +1,101 @@
+// Copyright Wild Montage, LLC. All Rights Reserved.
+
+#pragma once
+
+#include "MMCoreTypes.h"
+
+#include <vector>
+
+namespace MMCore
+{
+	/**
+	 * Available search implementations. They all return the same winner, they only differ in how much they scan.
+	 */
+	enum class SearchBackend : int32_t
+	{
+		BruteForce,		// Every dimension of every row.
+		Lanes,			// Same as brute force but accumulates four lanes at a time so the compiler can vectorize it.
+		Pruned,			// Stops accumulating a row as soon as it can't beat the best cost.
+		Indexed,		// Skips whole blocks of rows using their bounding boxes. Needs a SearchIndex.
+		Count
+	};
+
+	const char* GetSearchBackendName(SearchBackend backend);
+
+	/**
+	 * Axis-aligned bounding boxes over fixed-size blocks of consecutive rows of a state (search dimensions only).
+	 */
+	struct SearchIndex
+	{
+		struct Block
+		{
+			int32_t State = 0;
+			int32_t FirstPose = 0;
+			int32_t NumPoses = 0;
+		};
+
+		int32_t BlockSize = 16;
+		int32_t Dims = 0;
+		std::vector<Block> Blocks;
+		std::vector<float> Mins;	// Dims per block.
+		std::vector<float> Maxs;	// Dims per block.
+
+		void Build(const DatabaseView& db, int32_t blockSize = 16);
+		bool IsValid() const { return Dims != 0; }
+	};
+
+	/**
+	 * How much work a search did. Optional, pass to any backend.
+	 */
+	struct SearchStats
+	{
+		int64_t PosesScanned = 0;
+		int64_t PosesPruned = 0;
+	};
+
+	// Squared euclidean distance over the first dims floats.
+	inline float DistSquared(const float* a, const float* b, int32_t dims)
+	{
+		float dist = 0.f;
+
+		for (int32_t d = 0; d != dims; ++d)
+			dist += (a[d] - b[d]) * (a[d] - b[d]);
+
+		return dist;
+	}
+
+	// Bias multiplier of a candidate. Costs are multiplied by it.
+	inline float GetBiasScale(int32_t stateIndex, int32_t poseIndex, bool bLoop, const SearchParams& params, const SearchBiases& biases)
+	{
+		float scale = 1.0f;
+
+		if (stateIndex == params.CurrentState)
+			scale *= (1.0f - ((poseIndex == params.CurrentPose) ? biases.NaturalBias : biases.NaturalBias * 0.5f));
+
+		if (bLoop)
+			scale *= (1.0f - (biases.LoopBias * params.SteadyBias));
+
+		return scale;
+	}
+
+	// Applies the natural and loop biases to a raw candidate cost.
+	inline float ApplyBiases(float cost, int32_t stateIndex, int32_t poseIndex, bool bLoop, const SearchParams& params, const SearchBiases& biases)
+	{
+		return cost * GetBiasScale(stateIndex, poseIndex, bLoop, params, biases);
+	}
+
+	// Brute-force search over every row of the database.
+	SearchResult BruteForceSearch(const DatabaseView& db, const float* query, const SearchParams& params, SearchStats* stats = nullptr);
+
+	// Brute force with a four-lane unrolled distance.
+	SearchResult LaneSearch(const DatabaseView& db, const float* query, const SearchParams& params, SearchStats* stats = nullptr);
+
+	// Brute force with early-out once a row's partial cost exceeds the best one.
+	SearchResult PrunedSearch(const DatabaseView& db, const float* query, const SearchParams& params, SearchStats* stats = nullptr);
+
+	// Bounding box culling of row blocks, then pruned search within the remaining blocks.
+	SearchResult IndexedSearch(const DatabaseView& db, const SearchIndex& index, const float* query, const SearchParams& params, SearchStats* stats = nullptr);
+
+	// Dispatches to a backend. Indexed falls back to pruned if index is null or invalid.
+	SearchResult Search(SearchBackend backend, const DatabaseView& db, const SearchIndex* index, const float* query, const SearchParams& params, SearchStats* stats = nullptr);
+}
@@ -0,0 +1,81 @@
+// Copyright Wild Montage, LLC. All Rights Reserved.
+
+#pragma once
+
+#include "MMCoreTypes.h"
+
+#include <vector>
+
+namespace MMCore
+{
+	/**
+	 * Character state the trajectory is predicted from. Everything is in character space.
+	 */
+	struct TrajectoryInput
+	{
+		float Velocity[3] = { 0.f, 0.f, 0.f };
+		float DesiredVelocity[3] = { 0.f, 0.f, 0.f };
+
+		// Only used by the spring predictor.
+		float Acceleration[3] = { 0.f, 0.f, 0.f };
+
+		// Degrees/s.
+		float TurnSpeed = 0.f;
+
+		// Facing (degrees) we want to end up with at the last trajectory point.
+		float DesiredFacing = 0.f;
+	};
+
+	/**
+	 * Predicts raw trajectory points (xyz positions and facings) at sorted timings.
+	 * Future points blend from the current velocity to the desired one over the trajectory; there's no recorded
+	 * history here, so past points are extrapolated from the current velocity.
+	 */
+	void PredictTrajectory(const float* timings, int32_t numTimings, const TrajectoryInput& input, float* outPositions, float* outFacings);
+
+	/**
+	 * Samples a path to follow instead of predicting: future points are where moving along the path (xyz points, in
+	 * character space, starting at the character) at speed takes us at each timing, stopping at its end. Facings follow
+	 * the path's direction, 0 being straight ahead (+y) like the database trajectories. Past points are extrapolated
+	 * from the current velocity like PredictTrajectory() does.
+	 */
+	void SamplePath(const float* timings, int32_t numTimings, const float* pathPoints, int32_t numPathPoints, float speed, const TrajectoryInput& input, float* outPositions, float* outFacings);
+
+	/**
+	 * Predicts the future with critically damped springs: velocity springs towards the desired velocity, facing towards
+	 * the desired facing. Past points are extrapolated from the current velocity like PredictTrajectory() does.
+	 *
+	 * The spring has a closed form, so every timing is a fixed linear combination of the inputs. The coefficients
+	 * (and their exponentials) are computed once in Init() for a set of timings and half-lives, after which predicting
+	 * is a handful of multiply-adds per point, without branches, for one character or a whole batch.
+	 */
+	class SpringTrajectoryPredictor
+	{
+	public:
+		void Init(const float* timings, int32_t numTimings, float halfLife, float facingHalfLife);
+
+		int32_t GetNumTimings() const { return (int32_t)Timings.size(); }
+		float GetHalfLife() const { return HalfLife; }
+		float GetFacingHalfLife() const { return FacingHalfLife; }
+
+		// Same outputs as PredictTrajectory().
+		void Predict(const TrajectoryInput& input, float* outPositions, float* outFacings) const;
+
+		// Predicts numInputs characters. Outputs are back to back, GetNumTimings() points per character.
+		void PredictBatch(const TrajectoryInput* inputs, int32_t numInputs, float* outPositions, float* outFacings) const;
+
+	private:
+		std::vector<float> Timings;
+		float HalfLife = 0.f;
+		float FacingHalfLife = 0.f;
+
+		// position = Velocity * PositionVelocity + DesiredVelocity * PositionGoal + Acceleration * PositionAcceleration
+		std::vector<float> PositionVelocity;
+		std::vector<float> PositionGoal;
+		std::vector<float> PositionAcceleration;
+
+		// facing = DesiredFacing * FacingGoal + TurnSpeed * FacingVelocity
+		std::vector<float> FacingGoal;
+		std::vector<float> FacingVelocity;
+	};
+}
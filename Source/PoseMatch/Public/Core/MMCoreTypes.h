@@ -0,0 +1,133 @@
+// Copyright Wild Montage, LLC. All Rights Reserved.
+
+#pragma once
+
+//
+// Motion matching core.
+// Everything under Core/ is plain C++ with no engine dependency so the math can be built and profiled outside the editor.
+// The plugin types (FMotionDatabase, FAnimNode_MotionMatcher, ...) wrap it.
+//
+
+#include <cstdint>
+#include <limits>
+
+namespace MMCore
+{
+	/**
+	 * Column offsets of a flattened pose row.
+	 * The first SearchDims columns are the normalized features we match against. The rest is extra data that
+	 * turns interpolating between two samples into a plain per-column lerp.
+	 */
+	struct FeatureLayout
+	{
+		int32_t NumBones = 0;
+		int32_t NumTrajectoryPoints = 0;
+
+		int32_t RootVelocity = 0;
+		int32_t Bones = 0;					// Position xyz then velocity xyz, per bone.
+		int32_t TrajectoryPosition = 0;		// xyz per point.
+		int32_t TrajectoryFacing = 0;		// Normalized facing per point.
+		int32_t SearchDims = 0;
+		int32_t TrajectoryFacingSinCos = 0;	// Raw facing as a unit sin/cos pair per point. Unlike degrees, safe to lerp across +-180.
+		int32_t RootRotationSpeed = 0;
+		int32_t FacingAxis = 0;
+		int32_t Stride = 0;
+
+		void Init(int32_t numBones, int32_t numTrajectoryPoints)
+		{
+			NumBones = numBones;
+			NumTrajectoryPoints = numTrajectoryPoints;
+
+			RootVelocity = 0;
+			Bones = RootVelocity + 3;
+			TrajectoryPosition = Bones + numBones * 6;
+			TrajectoryFacing = TrajectoryPosition + numTrajectoryPoints * 3;
+			SearchDims = TrajectoryFacing + numTrajectoryPoints;
+			TrajectoryFacingSinCos = SearchDims;
+			RootRotationSpeed = TrajectoryFacingSinCos + numTrajectoryPoints * 2;
+			FacingAxis = RootRotationSpeed + 1;
+			Stride = FacingAxis + 3;
+		}
+	};
+
+	/**
+	 * Where a state's poses live inside the row buffer.
+	 */
+	struct StateRange
+	{
+		int32_t FirstRow = 0;
+		int32_t NumPoses = 0;
+		float PlayLength = 0.f;
+		bool bLoop = false;
+	};
+
+	/**
+	 * Mean and scale (inverse standard deviation times weights) of a feature. normalized = (raw - Mean) * Scale
+	 */
+	struct FeatureNormal
+	{
+		float Mean = 0.f;
+		float Scale = 0.f;
+
+		inline float Normalize(float value) const { return (value - Mean) * Scale; }
+		inline float Unnormalize(float value) const { return (Scale != 0.f) ? value / Scale + Mean : Mean; }
+	};
+
+	/**
+	 * What the search needs to know about the caller besides the query itself.
+	 */
+	struct SearchParams
+	{
+		// Currently playing state and nearest pose. Used for the natural bias.
+		int32_t CurrentState = -1;
+		int32_t CurrentPose = -1;
+
+		// 0 - 1. How steady the input is. Scales the loop bias.
+		float SteadyBias = 0.f;
+
+		// Only consider looping states. E.g., when the current transition is about to end.
+		bool bLoopsOnly = false;
+
+		// Approximate search. The pruned and indexed backends may return a pose costing up to (1 + Tolerance) times
+		// the best one in exchange for skipping more poses. 0 is exact.
+		float Tolerance = 0.f;
+	};
+
+	struct SearchBiases
+	{
+		// How much do we want to keep playing the same animation and frame.
+		float NaturalBias = 0.f;
+
+		// How much to prefer loops when input is steady.
+		float LoopBias = 0.f;
+	};
+
+	struct SearchResult
+	{
+		int32_t StateIndex = -1;
+		int32_t PoseIndex = -1;
+		float Cost = std::numeric_limits<float>::max();
+
+		// Cost of the runner-up. Tells how clear-cut the win was.
+		float SecondCost = std::numeric_limits<float>::max();
+
+		bool IsValid() const { return StateIndex != -1; }
+	};
+
+	/**
+	 * Read-only view of a pose database. Rows are laid out by Layout, one per pose, states back to back.
+	 */
+	struct DatabaseView
+	{
+		const FeatureLayout* Layout = nullptr;
+		const float* Rows = nullptr;
+		const StateRange* States = nullptr;
+		int32_t NumStates = 0;
+		SearchBiases Biases;
+
+		inline const float* GetRow(int32_t stateIndex, int32_t poseIndex) const
+		{
+			return Rows + (States[stateIndex].FirstRow + poseIndex) * Layout->Stride;
+		}
+	};
+}
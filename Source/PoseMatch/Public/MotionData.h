@@ -7,12 +7,19 @@
 #include "UObject/Object.h"
 
 #include "Interfaces/Interface_BoneReferenceSkeletonProvider.h"
+#include "MotionDatabase.h"
 
 #include "MotionData.generated.h"
 
 #define MOTION_MATCHING_INTERVAL  0.03f
 #define MOTION_MATCHING_BLEND_TIME 0.4f
 
+// Shortest time between two transitions. See FMotionDatabase::ShouldTransition().
+#define MOTION_MATCHING_MIN_TRANSITION_TIME 0.1f
+
+// Live recording rate for past trajectory.
+#define MOTION_MATCHING_RECORD_RATE 0.03f
+
 typedef TArray<float> FFeatureVector;
 typedef TArray<FTrajectoryPoint> FTrajectory;
 
@@ -125,8 +132,9 @@ struct POSEMATCH_API FMMatcherPoseSample
 	UPROPERTY()
 	uint8 bRFootLock : 1;
 
+	/** Caches built before FMMatcherState::FootContacts stored one per pose. Empty meant both feet planted. */
 	UPROPERTY()
-	TArray<uint8> FootLocks = {1, 1};
+	TArray<uint8> FootLocks_DEPRECATED;
 
 	/** TLOU2-inspired facing axis of the spine. */
 	UPROPERTY()
@@ -174,6 +182,11 @@ struct POSEMATCH_API FMMatcherState
 	UPROPERTY()
 	TArray<FMMatcherPoseSample> CachedPoses;
 
+	/** Planted feet of every cached pose, two bits per pose (left then right), packed 32 to a word. Detected from a
+	* baked foot track when building the motion cache. */
+	UPROPERTY()
+	TArray<uint32> FootContacts;
+
 	/** Blend times for particular state pairs. Enter state id and blend time in seconds. */
 	UPROPERTY(EditAnywhere)
 	TMap<int32, float> CustomBlendTimes;
@@ -193,6 +206,7 @@ public:
 
 	UMotionData(const FObjectInitializer& ObjectInitializer);
 	virtual USkeleton* GetSkeleton(bool& bInvalidSkeletonIsError) override;
+	virtual void PostLoad() override;
 
 #if WITH_EDITOR
 	virtual void PreEditChange(FProperty* PropertyAboutToChange) override;
@@ -245,6 +259,18 @@ public:
 	UPROPERTY(EditAnywhere, Category = "Settings")
 	FBoneReference RightFoot;
 
+	/** A foot plants once it moves slower than this, in cm/s. Used when building the motion cache. */
+	UPROPERTY(EditAnywhere, Category = "Settings", meta = (ClampMin = "0.0"))
+	float FootContactSpeed = 15.f;
+
+	/** A planted foot lifts again once it moves faster than this, in cm/s. Keeps contacts from flickering around FootContactSpeed. */
+	UPROPERTY(EditAnywhere, Category = "Settings", meta = (ClampMin = "0.0"))
+	float FootReleaseSpeed = 30.f;
+
+	/** Feet higher than this above their lowest point in the animation never plant, in cm. 0 disables the test. */
+	UPROPERTY(EditAnywhere, Category = "Settings", meta = (ClampMin = "0.0"))
+	float FootContactMaxHeight = 10.f;
+
 	/** Virtual bone that receives the foot placement vector for foot locking based on the playing animation clip.
 	* Left foot. */
 	UPROPERTY(EditAnywhere, Category = "Settings")
@@ -343,4 +369,16 @@ public:
 	void UnnormalizeTrajectory(TArray<FTrajectoryPoint>& trajectory);
 
 	void UnnormalizeBoneData(TArray<FMMatcherBoneData>& boneData);
+
+public:
+	/* Runtime database shared by every matcher using this asset. Built on first use. Safe to call from any thread. */
+	FMotionDatabasePtr GetDatabase();
+
+	/* Drops the runtime database so the next GetDatabase() rebuilds it. Call after the motion cache changes.
+	* Instances holding the old one keep it alive until they re-initialize. */
+	void InvalidateDatabase();
+
+private:
+	FMotionDatabasePtr Database;
+	FCriticalSection DatabaseLock;
 };
\ No newline at end of file
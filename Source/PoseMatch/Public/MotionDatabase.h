@@ -0,0 +1,161 @@
+// Copyright Wild Montage, LLC. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Core/MMCoreTypes.h"
+#include "Core/MMCoreSearch.h"
+#include "Core/MMCoreContacts.h"
+
+class UMotionData;
+struct FFeatureNormalData;
+
+// The flattened data itself is described by the engine-independent core. See Core/MMCoreTypes.h.
+typedef MMCore::FeatureLayout FMMatcherFeatureLayout;
+typedef MMCore::StateRange FMotionDatabaseState;
+typedef MMCore::FeatureNormal FMotionFeatureNormal;
+typedef MMCore::SearchParams FMotionSearchParams;
+typedef MMCore::SearchResult FMotionSearchResult;
+
+/**
+ * Runtime ("compiled") version of a UMotionData asset.
+ *
+ * Built once from the motion cache and never modified afterwards, so every matcher instance using the same
+ * asset can share it across threads. Instances only keep their own playback cursor.
+ * Get one with UMotionData::GetDatabase().
+ */
+class POSEMATCH_API FMotionDatabase
+{
+public:
+	static TSharedRef<const FMotionDatabase, ESPMode::ThreadSafe> Build(const UMotionData& motionData);
+
+	// Path name of the asset this was built from.
+	FString SourcePath;
+
+	// Column layout shared by every row.
+	FMMatcherFeatureLayout Layout;
+
+	// Every cached pose of every state, one row of Layout.Stride floats each.
+	TArray<float> Rows;
+
+	// Animation time of every row.
+	TArray<float> Times;
+
+	// Parallel to UMotionData::States.
+	TArray<FMotionDatabaseState> States;
+
+	// Copy of UMotionData::TrajectoryTimings, in the same order as the trajectory columns. Expected to be authored sorted.
+	TArray<float> TrajectoryTimings;
+
+	// First trajectory timing that lies in the future (>= 0).
+	int32 FirstFutureTrajectoryTiming = 0;
+
+	// Furthest future timing. Typically 1 second into the future.
+	float LastTrajectoryTime = 0.f;
+
+	// How many past snapshots an instance must record to cover the earliest trajectory timing. 0 if there's no history.
+	int32 HistoryCount = 0;
+
+	// Index of the left/right foot within the pose matching bones. INDEX_NONE if the foot isn't matched.
+	int32 FootBoneIndices[2] = { INDEX_NONE, INDEX_NONE };
+
+	float SamplingRate = 0.f;
+
+	float NaturalBias = 0.f;
+	float LoopBias = 0.f;
+
+	// Planted feet of every row, two bits per row (left then right), see FMMatcherState::FootContacts.
+	TArray<uint32> FootContacts;
+
+	// Bounding boxes for the indexed search backend.
+	MMCore::SearchIndex SearchIndex;
+
+	// Query normalization. Bone features come straight from a pose row so they're already normalized.
+	FMotionFeatureNormal RootVelocityNormal;
+	TArray<FMotionFeatureNormal> TrajectoryPositionNormals;
+	TArray<FMotionFeatureNormal> TrajectoryFacingNormals;
+
+public:
+	// True if there is at least one pose to play.
+	bool HasPoses() const { return Rows.Num() != 0; }
+
+	FORCEINLINE const float* GetRow(int32 stateIndex, int32 poseIndex) const
+	{
+		return Rows.GetData() + (States[stateIndex].FirstRow + poseIndex) * Layout.Stride;
+	}
+
+	// Core view of this database. Valid as long as the database is.
+	MMCore::DatabaseView GetView() const;
+
+	FORCEINLINE float GetTime(int32 stateIndex, int32 poseIndex) const
+	{
+		return Times[States[stateIndex].FirstRow + poseIndex];
+	}
+
+	// time + deltaTime, wrapped around if the state loops and held at the end if it doesn't.
+	float AdvanceTime(int32 stateIndex, float time, float deltaTime) const;
+
+	/**
+	 * Writes a Layout.SearchDims query. Bone features are copied from poseRow (normally the playing pose),
+	 * the rest is normalized from raw character-space values.
+	 */
+	void BuildQuery(const float* poseRow, const FVector& rootVelocity, const FVector* trajectoryPositions, const float* trajectoryFacings, float* outQuery) const;
+
+	// Squared euclidean distance search with natural and loop biases. Uses the backend picked by mm.SearchBackend.
+	FMotionSearchResult Search(const float* query, const FMotionSearchParams& params, MMCore::SearchStats* stats = nullptr) const;
+
+	static MMCore::SearchBackend GetSearchBackend();
+
+	// Sample nearest to time.
+	FORCEINLINE int32 GetPoseIndex(int32 stateIndex, float time) const
+	{
+		return FMath::Clamp(FMath::RoundToInt(time / SamplingRate), 0, FMath::Max(States[stateIndex].NumPoses - 1, 0));
+	}
+
+	/**
+	 * Search parameters for a matcher playing stateIndex at time. A clip that's about to end only looks for loops.
+	 * bLoopsOnly and tolerance are the budget's, see FMotionMatchingBudgetDecision.
+	 */
+	FMotionSearchParams MakeSearchParams(int32 stateIndex, float time, float steadyBias, bool bLoopsOnly, float tolerance) const;
+
+	// A transition within MOTION_MATCHING_BLEND_TIME of its end, which needs a loop to go to.
+	bool IsEnding(int32 stateIndex, float time) const;
+
+	/**
+	 * Mean squared difference between the future trajectory of poseRow and raw character-space future points, normalized.
+	 * For matchers that don't evaluate a pose, see FMotionMatchingSearchSchedule.
+	 */
+	float GetTrajectoryDivergence(const float* poseRow, const FVector* trajectoryPositions, const float* trajectoryFacings) const;
+
+	// Search for matchers that don't evaluate a pose (crowd, headless). The bone features are the row at params.CurrentPose.
+	FMotionSearchResult SearchFromPlayback(const FMotionSearchParams& params, const FVector& rootVelocity, const FVector* trajectoryPositions, const float* trajectoryFacings, MMCore::SearchStats* stats = nullptr) const;
+
+	/**
+	 * The transition rule of every matcher. Don't switch within the loop that's playing, to (almost) where we already are
+	 * or back to the pose we last switched to, nor sooner than MOTION_MATCHING_MIN_TRANSITION_TIME after the last switch.
+	 */
+	bool ShouldTransition(const FMotionSearchResult& best, int32 stateIndex, float time, int32 matchedPoseIndex, float timeSinceTransition) const;
+
+	// 1 for steady input, down to 0 while it changes. Scales the loop bias.
+	static float GetSteadyBias(const FVector& desiredVector, const FVector& steadyInput, float desiredFacing);
+
+	// Bit 0: left foot planted, bit 1: right foot planted. Both bits of a row always share a word.
+	FORCEINLINE uint32 GetFootContacts(int32 stateIndex, int32 poseIndex) const
+	{
+		const int32 bit = (States[stateIndex].FirstRow + poseIndex) * 2;
+		return (FootContacts[bit >> 5] >> (bit & 31)) & 3;
+	}
+
+	/**
+	 * Computes the stats of columns [column, column + width) of numRows raw rows, stride floats each, and normalizes them in place
+	 * with weight applied. See MMCore::ComputeFeatureStats() and MMCore::NormalizeColumns(). Shared with the cache builder.
+	 */
+	static void NormalizeFeature(float* rows, int32 numRows, int32 stride, int32 column, int32 width, float weight, FFeatureNormalData& outNormalData);
+
+	// Planted (1) or not (0) per key of a baked foot track, see MMCore::DetectContacts(). Shared with the cache builder.
+	static void DetectFootContacts(const TArray<FVector>& footTrack, float keyInterval, const MMCore::ContactParams& params, TArray<uint8>& outContacts);
+
+	SIZE_T GetAllocatedSize() const;
+};
+
+typedef TSharedPtr<const FMotionDatabase, ESPMode::ThreadSafe> FMotionDatabasePtr;
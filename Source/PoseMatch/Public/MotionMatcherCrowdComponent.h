@@ -0,0 +1,134 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+
+#include "MotionData.h"
+#include "AnimNode_MotionMatcher.h"
+#include "MotionMatchingBudget.h"
+
+#include "MotionMatcherCrowdComponent.generated.h"
+
+/**
+ * Motion matches many lightweight agents (e.g., background pedestrians) that share one motion data asset,
+ * without an anim graph per agent.
+ *
+ * Agent state is stored as parallel arrays and the whole crowd is stepped in one ParallelFor per tick:
+ * trajectory prediction, pose search and playback cursor. The owner reads back each agent's transform and
+ * playback (animation + time) and applies it however it likes, e.g. a single-node skeletal mesh or an instanced mesh.
+ * There is no inertialization, switching animations is left to the owner to blend.
+ */
+UCLASS(BlueprintType, Category = "Motion Matcher Crowd Component", meta = (BlueprintSpawnableComponent))
+class POSEMATCH_API UMotionMatcherCrowdComponent : public UActorComponent
+{
+	GENERATED_UCLASS_BODY()
+
+public:
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Animation Set")
+	UMotionData* MotionDataAsset;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Settings")
+	float SpeedMultiplier = 1.f;
+
+	/** How quickly agents reach their desired velocity. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Settings", meta = (ClampMin = "0.0"))
+	float Acceleration = 4.f;
+
+	/** Step the crowd in increments of this many seconds, independent of the frame rate, so the same input always
+	* produces the same searches. 0 steps once per tick. Playback shows the last step plus the time not simulated yet and
+	* budget throttling is disabled in fixed step mode. Can be overridden with mm.FixedTimeStep. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Settings", meta = (ClampMin = "0.0"))
+	float FixedTimeStep = 0.f;
+
+	/** Most fixed steps taken in one tick. Time beyond that (e.g., after a hitch) is dropped. */
+	UPROPERTY(EditAnywhere, Category = "Settings", meta = (ClampMin = "1", EditCondition = "FixedTimeStep > 0"))
+	int32 MaxFixedSteps = 4;
+
+	/** Predict trajectories with critically damped springs reaching halfway to the desired velocity and facing in this
+	* many seconds. 0 blends from the current to the desired velocity instead. See FAnimNode_MotionMatcher. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Settings", meta = (ClampMin = "0.0"))
+	float TrajectoryHalfLife = 0.f;
+
+	/** Agents per worker task. Lower values spread small crowds over more threads. */
+	UPROPERTY(EditAnywhere, Category = "Settings", meta = (ClampMin = "1"))
+	int32 MinAgentsPerTask = 32;
+
+public:
+	virtual void BeginPlay() override;
+	virtual void TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+	UFUNCTION(BlueprintCallable, Category = "Motion Matching|Crowd")
+	int32 AddAgent(const FTransform& Transform);
+
+	UFUNCTION(BlueprintCallable, Category = "Motion Matching|Crowd")
+	void RemoveAgent(int32 Agent);
+
+	UFUNCTION(BlueprintCallable, Category = "Motion Matching|Crowd")
+	void SetAgentInput(int32 Agent, const FMMatcherInput& AgentInput);
+
+	UFUNCTION(BlueprintPure, Category = "Motion Matching|Crowd")
+	FTransform GetAgentTransform(int32 Agent) const;
+
+	UFUNCTION(BlueprintPure, Category = "Motion Matching|Crowd")
+	void GetAgentPlayback(int32 Agent, UAnimSequence*& Animation, float& Time) const;
+
+	UFUNCTION(BlueprintPure, Category = "Motion Matching|Crowd")
+	int32 GetNumAgents() const;
+
+	// Simulates the whole crowd for deltaTime, a frame or a fixed step. Called from TickComponent().
+	void StepCrowd(float deltaTime);
+
+	// Advances a single agent's movement and playback. Returns true if it's time for it to search.
+	// Only touches that agent's slots so agents can be stepped in parallel. Same for the functions below.
+	bool StepAgent(int32 agent, float deltaTime, FMotionMatchingBudgetDecision& outBudgetDecision);
+
+	MMCore::TrajectoryInput GetTrajectoryInput(int32 agent) const;
+
+	// Searches with an already predicted trajectory and switches the agent's animation if needed.
+	void MatchAgent(int32 agent, const FMotionMatchingBudgetDecision& budgetDecision, const FVector* trajectoryPositions, const float* trajectoryFacings);
+
+protected:
+	// Compiled MotionDataAsset.
+	FMotionDatabasePtr database;
+
+	// Budget governor of our world. Agents are throttled like anim graph matchers.
+	UPROPERTY(Transient)
+	UMotionMatchingBudgetSubsystem* budget = nullptr;
+
+	// Used when TrajectoryHalfLife is set. Shared by every agent, read only while stepping.
+	MMCore::SpringTrajectoryPredictor trajectoryPredictor;
+
+	// Tick time not stepped yet, in fixed step mode.
+	FMotionMatchingFixedStep fixedStep;
+
+	//
+	// Agent state, one slot per agent.
+	//
+
+	TArray<bool> agentActive;
+	TArray<int32> freeAgents;
+
+	TArray<FVector> positions;
+	TArray<float> yaws;
+
+	// Character space (see FAnimNode_MotionMatcher's desired trajectory).
+	TArray<FVector> velocities;
+	TArray<FVector> desiredVectors;
+	TArray<FVector> steadyInputs;
+	TArray<float> desiredFacings;
+	TArray<float> turnSpeeds;
+
+	// Path to follow (FMMatcherInput::PathPoints), if any, and the same in character space as of the last step.
+	TArray<TArray<FVector>> pathPoints;
+	TArray<float> pathSpeeds;
+	TArray<FMotionMatchingPath> paths;
+
+	// Playback cursor.
+	TArray<int32> stateIndices;
+	TArray<float> playTimes;
+	TArray<float> timeSinceMatch;
+
+	// Pose of the last transition and the time since, for FMotionDatabase::ShouldTransition().
+	TArray<int32> matchedPoses;
+	TArray<float> timeSinceTransition;
+};
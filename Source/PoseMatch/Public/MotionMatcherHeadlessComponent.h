@@ -0,0 +1,158 @@
+// Copyright Wild Montage, LLC. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+
+#include "MotionData.h"
+#include "AnimNode_MotionMatcher.h"
+#include "MotionMatchingBudget.h"
+#include "MotionMatchingSearchSchedule.h"
+#include "RootMotionSource_Custom.h"
+
+#include "MotionMatcherHeadlessComponent.generated.h"
+
+class ACharacter;
+class UCharacterMovementComponent;
+
+/**
+ * Motion matching without an anim graph, for dedicated servers.
+ *
+ * Does what FAnimNode_MotionMatcher does on a client, minus everything pose related: the playback cursor is advanced,
+ * searched and time warped straight from the compiled database and the same root motion is handed to the character
+ * movement component, so the server moves the character like its clients do. Nothing is evaluated, extracted or
+ * blended. The owner has to feed it the same input as the anim node (SetInput), or let it derive the input from the
+ * movement component's acceleration.
+ *
+ * Only runs where the anim graph doesn't (a dedicated server by default). Mesh animation is turned down to montages
+ * only there, as nothing renders it anyway.
+ */
+UCLASS(BlueprintType, Category = "Motion Matcher Headless Component", meta = (BlueprintSpawnableComponent))
+class POSEMATCH_API UMotionMatcherHeadlessComponent : public UActorComponent
+{
+	GENERATED_UCLASS_BODY()
+
+public:
+	/** Must be the motion data of the character's anim graph. */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Animation Set")
+	UMotionData* MotionDataAsset;
+
+	/** Same as the anim node's input. When following PathPoints, the path decides DesiredVector and DesiredFacing. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Input")
+	FMMatcherInput Input;
+
+	/** Derive the desired vector from the movement component's (replicated) acceleration instead of Input.DesiredVector. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Input")
+	bool bInputFromAcceleration = false;
+
+	/** Only run on dedicated servers. Otherwise run wherever the owner is, e.g., for listen server NPCs without meshes. */
+	UPROPERTY(EditAnywhere, Category = "Settings")
+	bool bDedicatedServerOnly = true;
+
+	/** Set the mesh to only tick montages where we run, so the anim graph isn't updated or evaluated. */
+	UPROPERTY(EditAnywhere, Category = "Settings")
+	bool bDisableMeshAnimation = true;
+
+	/** Should match the anim node's setting. */
+	UPROPERTY(EditAnywhere, Category = "Settings")
+	float SpeedMultiplier = 1.f;
+
+	/** Should match the anim node's setting. See FAnimNode_MotionMatcher::TrajectoryHalfLife. */
+	UPROPERTY(EditAnywhere, Category = "Settings", meta = (ClampMin = "0.0"))
+	float TrajectoryHalfLife = 0.f;
+
+	/** Should match the anim node's setting. See FAnimNode_MotionMatcher::TrajectoryChangeThreshold. */
+	UPROPERTY(EditAnywhere, Category = "Settings", meta = (ClampMin = "0.0"))
+	float TrajectoryChangeThreshold = 0.f;
+
+	/** Should match the anim node's setting. */
+	UPROPERTY(EditAnywhere, Category = "Settings", meta = (ClampMin = "0.0", EditCondition = "TrajectoryChangeThreshold > 0"))
+	float MaxSearchInterval = 0.5f;
+
+	/** Should match the anim node's setting. See FAnimNode_MotionMatcher::FixedTimeStep. */
+	UPROPERTY(EditAnywhere, Category = "Settings", meta = (ClampMin = "0.0"))
+	float FixedTimeStep = 0.f;
+
+	/** Most fixed steps taken in one tick. Time beyond that is dropped. */
+	UPROPERTY(EditAnywhere, Category = "Settings", meta = (ClampMin = "1", EditCondition = "FixedTimeStep > 0"))
+	int32 MaxFixedSteps = 4;
+
+public:
+	virtual void BeginPlay() override;
+	virtual void TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+	UFUNCTION(BlueprintCallable, Category = "Motion Matching|Headless")
+	void SetInput(const FMMatcherInput& NewInput);
+
+	/** Whether this component drives the character here (see bDedicatedServerOnly). */
+	UFUNCTION(BlueprintPure, Category = "Motion Matching|Headless")
+	bool IsRunning() const { return bRunning; }
+
+	/** What the server is playing. Can be replicated to correct clients. */
+	UFUNCTION(BlueprintPure, Category = "Motion Matching|Headless")
+	void GetPlayback(int32& StateIndex, float& Time) const;
+
+	// Simulates, plays and matches for deltaTime, a frame or a fixed step. Called from TickComponent().
+	void Step(float deltaTime);
+
+protected:
+	// Compiled MotionDataAsset.
+	FMotionDatabasePtr database;
+
+	UPROPERTY(Transient)
+	ACharacter* character = nullptr;
+
+	UPROPERTY(Transient)
+	UCharacterMovementComponent* moveComp = nullptr;
+
+	// Budget governor of our world.
+	UPROPERTY(Transient)
+	UMotionMatchingBudgetSubsystem* budget = nullptr;
+
+	bool bRunning = false;
+
+	// This tick's, shared by its steps.
+	FMotionMatchingBudgetDecision budgetDecision;
+
+	// The id of the custom root motion source that moves the character.
+	uint16 rootMotionSourceID = 0;
+
+	// Yaw of the mesh relative to the actor. Takes the input to world space, like the anim node's localMeshCompYaw.
+	float meshYaw = 0.f;
+
+	FMotionMatchingFixedStep fixedStep;
+
+	//
+	// Matcher state, a subset of FMMatcherHotState.
+	//
+
+	int32 stateIndex = 0;
+	float playTime = 0.f;
+	float timeSinceLastMatch = 0.f;
+	FMotionMatchingSearchSchedule searchSchedule;
+
+	// Pose of the last transition and the time since, for FMotionDatabase::ShouldTransition().
+	int32 matchedPoseIndex = 0;
+	float timeSinceTransition = 0.f;
+
+	float timeScaleWarp = 1.f;
+	float turnSpeed = 0.f;
+	float lastYaw = 0.f;
+	float lastStepYaw = 0.f;
+
+	// Input.DesiredVector and DesiredFacing, or what the acceleration or path make of them this tick.
+	FVector desiredVector = FVector::ZeroVector;
+	float desiredFacing = 0.f;
+
+	FVector desiredVecA = FVector::ZeroVector;
+	FVector inputSteady = FVector::ZeroVector;
+
+	FMotionMatchingRootMotion rootMotionSpring;
+
+	// Used when TrajectoryHalfLife is set.
+	MMCore::SpringTrajectoryPredictor trajectoryPredictor;
+
+	// Input.PathPoints in character space, as of this tick.
+	FMotionMatchingPath path;
+};
@@ -9,10 +9,65 @@ struct FFootLock;
 class UAnimInstance;
 class UDebugWidget;
 
+/** Search statistics of one motion matcher instance. Updated every anim update. */
+USTRUCT(BlueprintType)
+struct POSEMATCH_API FMotionMatcherTelemetry
+{
+	GENERATED_BODY()
+
+	/** Duration of the last search in microseconds. */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Motion Matching")
+	float LastSearchMicroseconds = 0.f;
+
+	/** Poses fully compared by the last search. */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Motion Matching")
+	int32 CandidatesVisited = 0;
+
+	/** Poses the last search ruled out early. */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Motion Matching")
+	int32 CandidatesPruned = 0;
+
+	/** Cost of the last winner. */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Motion Matching")
+	float BestCost = 0.f;
+
+	/** Cost of the last runner-up. Close to BestCost means the choice was ambiguous. */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Motion Matching")
+	float SecondBestCost = 0.f;
+
+	/** True if no search ran during the last update. */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Motion Matching")
+	bool bSearchSkipped = true;
+
+	/** Inertialization blends in flight. */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Motion Matching")
+	int32 ActiveBlends = 0;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Motion Matching")
+	int32 TotalSearches = 0;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Motion Matching")
+	int32 TotalTransitions = 0;
+
+	/** Rolling averages over roughly the last 16 searches. */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Motion Matching")
+	float AverageSearchMicroseconds = 0.f;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Motion Matching")
+	float AverageCandidatesVisited = 0.f;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Motion Matching")
+	float AverageBestCost = 0.f;
+
+	/** Rolling transition rate. */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Motion Matching")
+	float TransitionsPerSecond = 0.f;
+};
+
 /** Interface to the motion matcher node. Can get foot IK info from here.
 */
 UCLASS(BlueprintType)
-class POSEMATCH_API UMotionMatcherInterface : public UObject, public FTickableGameObject
+class POSEMATCH_API UMotionMatcherInterface : public UObject
 {
 	GENERATED_BODY()
 
@@ -25,8 +80,11 @@ private:
 
 	bool bSetupComplete = false;
 
-	FFootLock CurrentFootLock;
-	FFootLock TargetFootLock;
+	// Written by the paired node on an animation worker, read by GetFootLockData() without locking.
+	TTripleBuffer<FFootLock> FootLockSnapshot;
+
+	// Same for GetTelemetry().
+	TTripleBuffer<FMotionMatcherTelemetry> TelemetrySnapshot;
 
 
 #if WITH_EDITOR
@@ -35,24 +93,32 @@ private:
 #endif
 
 public:
-	// Tick function
-	virtual void Tick(float DeltaTime) override;
-	virtual bool IsTickable() const override { return bSetupComplete; };
-	virtual TStatId GetStatId() const override { return UObject::GetStatID(); };
-	// End overrides
-
 	// Associate an anim node instance with this interface
 	void PairAnimNode(FAnimNode_MotionMatcher* motionMatcher);
 
-	void UpdateFootLock(int foot, bool bLock, FVector newPos);
+	// Called by the paired node after it smoothed the foot locks.
+	void PublishFootLock(const FFootLock& footLock);
 
+	// Called by the paired node at the end of every update.
+	void PublishTelemetry(const FMotionMatcherTelemetry& telemetry);
+
+	/** Foot locks as of the last animation update. Game thread only. */
 	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Motion Matching")
 	const FFootLock& GetFootLockData();
 
 	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Motion Matching")
 	int32 GetStateIndex();
 
-	void DrawDebug();
+	/** Search statistics as of the last animation update. Game thread only. */
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Motion Matching")
+	FMotionMatcherTelemetry GetTelemetry();
+
+	// Memory owned by the paired node instance. 0 until paired.
+	SIZE_T GetNodeMemoryFootprint() const;
+
+	ACharacter* GetCharacter() const { return character; }
+
+	void DrawDebug(const FFootLock& footLock);
 
 
 };
\ No newline at end of file
@@ -3,6 +3,7 @@
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
 #include "Components/ActorComponent.h"
+#include "Containers/TripleBuffer.h"
 
 #include "MotionMatcher_Component.generated.h"
 
@@ -16,10 +17,10 @@ struct POSEMATCH_API FFootLock
 public:
 
 	UPROPERTY(VisibleDefaultsOnly, BlueprintReadWrite)
-	FVector LFootLocation;
+	FVector LFootLocation = FVector::ZeroVector;
 
 	UPROPERTY(VisibleDefaultsOnly, BlueprintReadWrite)
-	FVector RFootLocation;
+	FVector RFootLocation = FVector::ZeroVector;
 
 	UPROPERTY(VisibleDefaultsOnly, BlueprintReadOnly)
 	float LFoot_LockStrength = 0.f;
@@ -27,11 +28,18 @@ public:
 	UPROPERTY(VisibleDefaultsOnly, BlueprintReadOnly)
 	float RFoot_LockStrength = 0.f;
 
+	/** Surface normal under the locked foot. Up unless the matcher probes the ground (bProbeGround). */
 	UPROPERTY(VisibleDefaultsOnly, BlueprintReadOnly)
-	FVector LLegIKLocation;
+	FVector LFootNormal = FVector::UpVector;
 
 	UPROPERTY(VisibleDefaultsOnly, BlueprintReadOnly)
-	FVector RLegIKLocation;
+	FVector RFootNormal = FVector::UpVector;
+
+	UPROPERTY(VisibleDefaultsOnly, BlueprintReadOnly)
+	FVector LLegIKLocation = FVector::ZeroVector;
+
+	UPROPERTY(VisibleDefaultsOnly, BlueprintReadOnly)
+	FVector RLegIKLocation = FVector::ZeroVector;
 };
 
 UCLASS(BlueprintType, Category = "Motion Matcher Component", meta = (BlueprintSpawnableComponent))
@@ -47,20 +55,15 @@ class POSEMATCH_API UMotionMatcherComponent : public UActorComponent
 protected:
 	bool debugMode = false;
 
-	FFootLock CurrentFootLock;
-
-	FFootLock TargetFootLock;
-
-	bool bFootLockChanged = false;
-
-	float blendAlpha = 0.0f;
+	// Written by the motion matcher node on an animation worker, read here without locking.
+	TTripleBuffer<FFootLock> footLockSnapshot;
 
 public:
 
-	virtual void TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
-
-	void UpdateFootLock(int foot, bool bLock, FVector newPos);
+	// Called by the motion matcher node of our owner's mesh after it smoothed the foot locks.
+	void PublishFootLock(const FFootLock& footLock);
 
+	/** Foot locks as of the last animation update. Game thread only. */
 	UFUNCTION(BlueprintCallable, meta = (DisplayName = "Get Foot Lock", Keywords = "motion match"), Category = "Motion Matching")
 	FFootLock GetFootLock();
 
@@ -0,0 +1,88 @@
+// Copyright Wild Montage, LLC. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+
+#include "MotionMatchingBudget.generated.h"
+
+/**
+ * How a matcher should search this frame. Full quality by default.
+ */
+struct FMotionMatchingBudgetDecision
+{
+	// Multiplies MOTION_MATCHING_INTERVAL.
+	float IntervalScale = 1.f;
+
+	// Approximate search tolerance. See MMCore::SearchParams::Tolerance.
+	float SearchTolerance = 0.f;
+
+	// Only consider looping states.
+	bool bLoopsOnly = false;
+};
+
+/**
+ * Keeps the total pose search cost of a world within a per-frame budget (mm.Budget.Ms).
+ *
+ * Matchers report how long their searches took. Once a frame, the governor compares the smoothed cost against the
+ * budget and raises or lowers a throttle level. Each level degrades characters by significance (distance to the
+ * viewer), far ones first:
+ *   1: Longer match intervals.
+ *   2: Approximate search.
+ *   3: Loops only, even longer intervals.
+ * Characters closer than mm.Budget.FullQualityDistance are never throttled.
+ */
+UCLASS()
+class POSEMATCH_API UMotionMatchingBudgetSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	static const int32 MaxLevel = 3;
+
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+
+	// FTickableGameObject
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override { return !IsTemplate(); }
+	virtual TStatId GetStatId() const override { RETURN_QUICK_DECLARE_CYCLE_STAT(UMotionMatchingBudgetSubsystem, STATGROUP_Tickables); }
+
+	// Thread safe. Call once per search.
+	void ReportSearch(float microseconds);
+
+	// Thread safe. Whole matcher update/evaluate time, searches included. Not budgeted, only reported.
+	void ReportUpdate(float microseconds);
+
+	// Thread safe. Call once per matcher update (not per step) so the governor knows how many matchers are active.
+	void ReportActive(int32 numMatchers = 1);
+
+	// Thread safe.
+	FMotionMatchingBudgetDecision GetDecision(const FVector& location) const;
+
+	int32 GetLevel() const { return level; }
+	float GetSmoothedSearchMs() const { return smoothedSearchMs; }
+	float GetLastFrameSearchMs() const { return lastFrameSearchMs; }
+	float GetLastFrameUpdateMs() const { return lastFrameUpdateMs; }
+	int32 GetActiveMatchers() const { return activeMatchers; }
+
+private:
+	// Accumulated since the last tick.
+	TAtomic<int64> pendingSearchNanoseconds{ 0 };
+	TAtomic<int64> pendingUpdateNanoseconds{ 0 };
+	TAtomic<int32> pendingActive{ 0 };
+
+	TAtomic<int32> level{ 0 };
+	float smoothedSearchMs = 0.f;
+	float lastFrameSearchMs = 0.f;
+	float lastFrameUpdateMs = 0.f;
+	float timeSinceLevelChange = 0.f;
+	int32 activeMatchers = 0;
+
+	// Significance reference point. Written on the game thread, read by anim workers.
+	mutable FRWLock viewLock;
+	FVector viewLocation = FVector::ZeroVector;
+	bool bHasView = false;
+};
@@ -0,0 +1,82 @@
+// Copyright Wild Montage, LLC. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MotionDatabase.h"
+
+//
+// Query capture. Records every search the motion matchers run so it can be replayed offline against any search backend.
+// Enter in console:
+//   mm.Capture.Start [FileName]   Starts writing Saved/Profiling/MotionMatching/<FileName>.mmcap
+//   mm.Capture.Stop
+// Replay with the MotionMatchingReplay commandlet (PoseMatchEditor).
+//
+
+/**
+ * One recorded search.
+ */
+struct POSEMATCH_API FMotionCapturedQuery
+{
+	// Index into FMotionCapture::Databases.
+	int32 Database = 0;
+
+	FMotionSearchParams Params;
+
+	// Biases the database had when the search ran.
+	float NaturalBias = 0.f;
+	float LoopBias = 0.f;
+
+	// Winner picked at capture time.
+	FMotionSearchResult Result;
+
+	// Time the search took at capture time, in microseconds.
+	float SearchMicroseconds = 0.f;
+
+	// Normalized current pose and desired trajectory, SearchDims floats.
+	TArray<float> Query;
+};
+
+/**
+ * A database referenced by a capture.
+ */
+struct POSEMATCH_API FMotionCapturedDatabase
+{
+	// UMotionData path name.
+	FString Path;
+
+	int32 SearchDims = 0;
+	int32 NumPoses = 0;
+};
+
+/**
+ * A loaded capture file.
+ */
+struct POSEMATCH_API FMotionCapture
+{
+	TArray<FMotionCapturedDatabase> Databases;
+	TArray<FMotionCapturedQuery> Queries;
+
+	bool Load(const FString& fileName);
+};
+
+/**
+ * Writes the capture file. Thread safe, matchers record from worker threads.
+ */
+class POSEMATCH_API FMotionCaptureWriter
+{
+public:
+	static bool Start(const FString& fileName);
+	static void Stop();
+
+	// Cheap enough to check on every search.
+	static bool IsCapturing() { return bCapturing; }
+
+	static void Record(const FMotionDatabase& database, const float* query, const FMotionSearchParams& params, const FMotionSearchResult& result, float searchMicroseconds);
+
+	// Directory captures are written to and loaded from by default.
+	static FString GetCaptureDir();
+
+private:
+	static TAtomic<bool> bCapturing;
+};
@@ -0,0 +1,24 @@
+// Copyright Wild Montage, LLC. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Splits frame time into simulation steps for the anim node and the headless and crowd components, so they all step
+ * (and honor mm.FixedTimeStep) the same way: one step of the whole frame, or whole fixed steps with the remainder carried
+ * over to the next frame. Everything that decides a search (input smoothing, trajectory prediction, the playback cursor,
+ * matching, movement) runs on the steps. What's shown is the last step plus the carried over time, so the pose never
+ * stalls on a short frame.
+ */
+struct POSEMATCH_API FMotionMatchingFixedStep
+{
+	// Frame time not simulated yet.
+	float Accumulator = 0.f;
+
+	// mm.FixedTimeStep if it's set, fixedTimeStep (the caller's setting) otherwise. 0 or less steps once per frame.
+	static float GetTimeStep(float fixedTimeStep);
+
+	// Adds a frame. Returns how many steps to simulate, each outStepTime long. After a hitch, time beyond maxSteps is dropped.
+	int32 Advance(float frameDeltaTime, float fixedTimeStep, int32 maxSteps, float& outStepTime);
+};
@@ -0,0 +1,33 @@
+// Copyright Wild Montage, LLC. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MotionMatcher_Component.h"
+
+/**
+ * Smooths the foot lock targets of the anim node into the FFootLock read by gameplay and IK blueprints.
+ *
+ * Runs as part of the node's update on an animation worker. The feet come from the node's last evaluated pose
+ * (component space, resolved through the bone container) instead of socket queries on the mesh, so the game thread
+ * never pays for it. The node publishes GetCurrent() to its matcher interface and UMotionMatcherComponent.
+ */
+struct POSEMATCH_API FMotionMatchingFootLock
+{
+	void SetTarget(int32 foot, bool bLock, const FVector& location, const FVector& normal = FVector::UpVector);
+
+	// Component space transform of a foot, as of the last evaluation.
+	void SetFootTransform(int32 foot, const FTransform& componentSpaceT) { feet[foot] = componentSpaceT; }
+
+	void Update(float deltaTime, const FTransform& componentT, const FTransform& actorT);
+
+	const FFootLock& GetCurrent() const { return current; }
+
+	void Reset();
+
+private:
+	FFootLock current;
+	FFootLock target;
+
+	FTransform feet[2];
+};
@@ -0,0 +1,80 @@
+// Copyright Wild Montage, LLC. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/EngineTypes.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "WorldCollision.h"
+
+#include "MotionMatchingGroundProbe.generated.h"
+
+/**
+ * Ground found under a probed location.
+ */
+struct FMotionMatchingGroundHit
+{
+	// Where the probe was requested. Results trail the requests by a frame, so compare against this.
+	FVector ProbeLocation = FVector::ZeroVector;
+
+	FVector Location = FVector::ZeroVector;
+	FVector Normal = FVector::UpVector;
+
+	// False if the trace didn't find anything within range.
+	bool bHit = false;
+};
+
+/**
+ * Traces the ground under locked feet for every matcher of a world, asynchronously and in one batch.
+ *
+ * Matchers request probes from their anim update (any thread), one per foot, the latest request winning. Once a frame
+ * the game thread collects the results of last frame's traces and issues the new batch with AsyncLineTraceByChannel,
+ * so nobody ever waits on a trace: a result shows up the frame after its request. Owners that stop requesting are
+ * forgotten after a few frames. Trace range is set by mm.GroundProbe.Up and mm.GroundProbe.Down.
+ */
+UCLASS()
+class POSEMATCH_API UMotionMatchingGroundProbeSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+
+	// FTickableGameObject
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override { return !IsTemplate(); }
+	virtual TStatId GetStatId() const override { RETURN_QUICK_DECLARE_CYCLE_STAT(UMotionMatchingGroundProbeSubsystem, STATGROUP_Tickables); }
+
+	// Thread safe. Probes straight down through location with the next batch.
+	void Request(const void* owner, int32 foot, const FVector& location, const AActor* ignoredActor, ECollisionChannel channel);
+
+	// Thread safe. Latest result of a foot. False until one arrived.
+	bool GetResult(const void* owner, int32 foot, FMotionMatchingGroundHit& outHit) const;
+
+private:
+	struct FFootProbe
+	{
+		FVector RequestLocation = FVector::ZeroVector;
+		bool bRequested = false;
+
+		// Trace in flight, started at TracedLocation.
+		FTraceHandle Handle;
+		FVector TracedLocation = FVector::ZeroVector;
+
+		FMotionMatchingGroundHit Result;
+		bool bHasResult = false;
+	};
+
+	struct FOwnerProbes
+	{
+		FFootProbe Feet[2];
+		TWeakObjectPtr<const AActor> IgnoredActor;
+		ECollisionChannel Channel = ECC_Visibility;
+		uint64 LastRequestFrame = 0;
+	};
+
+	// Written by anim workers and the game thread.
+	mutable FRWLock lock;
+	TMap<const void*, FOwnerProbes> probes;
+};
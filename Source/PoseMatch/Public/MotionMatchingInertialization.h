@@ -0,0 +1,47 @@
+// Copyright Wild Montage, LLC. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Animation/AnimNodeBase.h"
+
+class UAnimSequence;
+
+/**
+ * Inertialization built into the matcher node (see FAnimNode_MotionMatcher::bBuiltInInertialization).
+ *
+ * On a transition, the difference between the pose we were playing and the new one (and between their velocities) is
+ * stored per bone, and added on top of the new pose while it decays to nothing with a critically damped spring. So a
+ * transition costs a few extra pose extractions once and O(bones) per frame while it fades out. A new transition
+ * simply starts from whatever is showing, blends are never dropped for lack of a slot.
+ */
+struct POSEMATCH_API FMotionMatchingInertialization
+{
+	// Starts a blend from an animation at a time to whatever is evaluated next. If several are requested before the
+	// next evaluation, the first source wins: it's what was last shown.
+	void Request(const UAnimSequence* fromAnimation, float fromTime, float blendTime);
+
+	// Adds the offsets to a pose of the given animation at the given time, starting a pending blend first.
+	void Apply(FPoseContext& output, const UAnimSequence* animation, float time, float deltaTime);
+
+	bool IsBlending() const { return blendTimeLeft > 0.f; }
+
+	void Reset();
+
+	SIZE_T GetAllocatedSize() const;
+
+private:
+	void Start(const FCompactPose& source, const FCompactPose& sourceBefore, const FCompactPose& destination, const FCompactPose& destinationBefore, float deltaTime);
+
+	// Per bone: translation xyz then rotation xyz (scaled axis angle), local space. Index 0 (root) is left alone.
+	TArray<float> offsets;
+	TArray<float> offsetVelocities;
+
+	float halfLife = 0.f;
+	float blendTimeLeft = 0.f;
+
+	// Pending request.
+	const UAnimSequence* pendingAnimation = nullptr;
+	float pendingTime = 0.f;
+	float pendingBlendTime = 0.f;
+};
@@ -0,0 +1,42 @@
+// Copyright Wild Montage, LLC. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Core/MMCoreTrajectory.h"
+
+/**
+ * A path to follow (FMMatcherInput::PathPoints), e.g., an AI's navigation path, taken to character space.
+ *
+ * The desired trajectory is sampled straight from it (MMCore::SamplePath) instead of predicted from a blended input,
+ * so it doesn't wobble from frame to frame and doesn't trigger searches the input alone wouldn't. GetInput() gives
+ * the DesiredVector and DesiredFacing that follow the path, for everything else that's driven by input (root motion,
+ * steadiness, ...).
+ */
+struct POSEMATCH_API FMotionMatchingPath
+{
+	// Character space, flat, from the closest point to the character onwards.
+	TArray<FVector, TInlineAllocator<16>> Points;
+
+	// Of Points, in cm.
+	float Length = 0.f;
+
+	// cm/s along the path.
+	float Speed = 0.f;
+
+	bool IsValid() const { return Points.Num() > 1 && Speed > 0.f; }
+
+	void Reset();
+
+	// Points are in world space. actorYaw takes character space to world space, see FMotionMatchingRootMotion::Update().
+	void Set(const TArray<FVector>& worldPoints, float speed, const FVector& location, float actorYaw);
+
+	// Desired trajectory points at timings. Past points come from trajectoryInput, see MMCore::SamplePath().
+	void Sample(const float* timings, int32 numTimings, const MMCore::TrajectoryInput& trajectoryInput, FVector* outPositions, float* outFacings) const;
+
+	// Input that follows the path: heading towards where we are at nearTime, at the speed that covers what's left of it
+	// by farTime (so it slows down at the end), facing where it goes at farTime. maxSpeed is the speed of a full input.
+	// trajectoryInput is the current movement (velocity and turn speed), as for Sample(). Matchers following a path use
+	// this in place of the DesiredVector and DesiredFacing they were given.
+	void GetInput(float nearTime, float farTime, float maxSpeed, const MMCore::TrajectoryInput& trajectoryInput, FVector& outDesiredVector, float& outDesiredFacing) const;
+};
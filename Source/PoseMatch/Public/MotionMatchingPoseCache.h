@@ -0,0 +1,58 @@
+// Copyright Wild Montage, LLC. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Animation/AnimCurveTypes.h"
+#include "Animation/AnimationPoseData.h"
+
+class UAnimSequence;
+
+/**
+ * Poses extracted this frame, shared by every motion matcher node (see FAnimNode_MotionMatcher::bUseSharedPoseCache).
+ *
+ * A crowd on the same motion data often plays the same clip at nearly the same time. Times are snapped to steps of
+ * mm.PoseCache.TimeStep, so those characters extract the exact same pose: the first one decompresses it, the others
+ * copy it. Entries are keyed by animation, snapped time and required bones (mesh and bone count, i.e., LOD), and are
+ * thrown away when the frame changes. Safe to use from parallel evaluations. Custom attributes aren't cached.
+ */
+class POSEMATCH_API FMotionMatchingPoseCache
+{
+public:
+	static FMotionMatchingPoseCache& Get();
+
+	// Same as animation->GetAnimationPose(output, FAnimExtractContext(time, bExtractRootMotion)), at the snapped time.
+	void GetAnimationPose(const UAnimSequence* animation, float time, bool bExtractRootMotion, FAnimationPoseData& output);
+
+private:
+	struct FKey
+	{
+		const UAnimSequence* Animation = nullptr;
+		const UObject* BoneAsset = nullptr;
+		int32 NumBones = 0;
+		int32 TimeStep = 0;
+		bool bExtractRootMotion = false;
+
+		bool operator==(const FKey& other) const
+		{
+			return Animation == other.Animation && BoneAsset == other.BoneAsset && NumBones == other.NumBones && TimeStep == other.TimeStep && bExtractRootMotion == other.bExtractRootMotion;
+		}
+
+		friend uint32 GetTypeHash(const FKey& key)
+		{
+			return HashCombine(HashCombine(GetTypeHash(key.Animation), GetTypeHash(key.BoneAsset)), HashCombine(GetTypeHash(key.TimeStep), key.NumBones * 2 + key.bExtractRootMotion));
+		}
+	};
+
+	struct FEntry
+	{
+		TArray<FTransform> Bones;
+		FBlendedHeapCurve Curve;
+	};
+
+	FRWLock lock;
+	TMap<FKey, FEntry> entries;
+
+	// The frame entries are from.
+	uint64 frame = 0;
+};
@@ -0,0 +1,27 @@
+// Copyright Wild Montage, LLC. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MotionData.h"
+
+/**
+ * Decides when the anim node and the headless component search, so both follow the same schedule: every
+ * MOTION_MATCHING_INTERVAL, or event driven when a trajectory change threshold is set. See
+ * FAnimNode_MotionMatcher::TrajectoryChangeThreshold.
+ */
+struct POSEMATCH_API FMotionMatchingSearchSchedule
+{
+	// Time between searches while the trajectory doesn't change.
+	float SearchInterval = MOTION_MATCHING_INTERVAL;
+
+	// Whether the trajectory was off at the last check.
+	bool bDiverged = false;
+
+	/**
+	 * Whether it's time to search. divergence is how far the playing animation's future is from the desired one (mean squared
+	 * difference of the normalized points) and only read when changeThreshold is set. bEnding (a transition running out)
+	 * counts as diverged. intervalScale is the budget's, see FMotionMatchingBudgetDecision.
+	 */
+	bool ShouldSearch(float timeSinceLastMatch, float intervalScale, float changeThreshold, float maxSearchInterval, float divergence, bool bEnding);
+};
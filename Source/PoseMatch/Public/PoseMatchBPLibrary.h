@@ -12,6 +12,8 @@
 
 #include "PoseMatchBPLibrary.generated.h"
 
+class USplineComponent;
+
 /* 
 *	Function library class.
 *	Each function in it is expected to be static and represents blueprint node that can be called in any blueprint.
@@ -57,6 +59,10 @@ class UPoseMatchBPLibrary : public UBlueprintFunctionLibrary
 
 	UFUNCTION(BlueprintCallable, meta = (DisplayName = "Create Motion Matcher Interface", Keywords = "motion match interface get"), Category = "Motion Matching")
 	static UMotionMatcherInterface* CreateMotionMatcherInterface();
+
+	/** Points along a spline every Spacing cm, for a motion matcher to follow (see FMMatcherInput::PathPoints). */
+	UFUNCTION(BlueprintPure, meta = (DisplayName = "Get Spline Path Points", Keywords = "motion match path spline follow"), Category = "Motion Matching")
+	static TArray<FVector> GetSplinePathPoints(const USplineComponent* Spline, float Spacing = 50.f);
 	
 	//UFUNCTION(BlueprintCallable, meta = (DisplayName = "Create Pose Matcher", Keywords = "PoseMatch pose match"), Category = "Pose Matching")
 	//static USkeletalMeshComponent* GetSkeletalMeshFrom
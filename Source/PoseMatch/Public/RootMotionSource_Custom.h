@@ -28,4 +28,30 @@ struct POSEMATCH_API FRootMotionSource_Custom : public FRootMotionSource
 	) override;
 
 	virtual UScriptStruct* GetScriptStruct() const override;
-};
\ No newline at end of file
+};
+
+class UCharacterMovementComponent;
+
+/**
+ * What the matcher feeds FRootMotionSource_Custom: a spring towards the desired velocity and a turn step towards
+ * the desired facing. It only depends on input, not on the playing pose, so a headless server
+ * (UMotionMatcherHeadlessComponent) moves a character exactly like a client evaluating the anim graph.
+ */
+struct POSEMATCH_API FMotionMatchingRootMotion
+{
+	// Velocity spring, world space.
+	float X = 0.f, Y = 0.f;
+	float XVelocity = 0.f, YVelocity = 0.f;
+	float XAcceleration = 0.f, YAcceleration = 0.f;
+
+	// Degrees to turn this step.
+	float YawStep = 0.f;
+
+	// desiredVector and desiredFacing are the matcher input (FMMatcherInput). actorYaw takes the input to world space.
+	void Update(const FVector& desiredVector, float desiredFacing, float actorYaw, float deltaTime);
+
+	FTransform GetTransform() const;
+
+	// Adds a FRootMotionSource_Custom to a movement component and returns its id.
+	static uint16 AddSource(UCharacterMovementComponent& moveComp);
+};
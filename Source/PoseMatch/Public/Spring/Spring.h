@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cmath>
+
 /*
 Copyright 2021 Daniel Holden
 
@@ -29,105 +31,113 @@ OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISE
 OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
-//--------------------------------------
+// Header only: everything is inline, so this can be included from any number of translation units.
+//
+// The scalar functions are templated on the value type. They work the same on floats and vectors (FVector, ...), as
+// long as the type can be added, subtracted and multiplied by a float. The *_batch functions update count springs
+// stored as separate arrays (structure of arrays) that share a half-life. The exponential is computed once per call,
+// so the loops are branch free and get vectorized.
 
-float lerp(float x, float y, float a)
+namespace Spring
 {
-    return (1.0f - a) * x + a * y;
-}
+
+constexpr float pi = 3.14159265358979323846f;
+constexpr float ln2 = 0.69314718056f;
 
 //--------------------------------------
 
-float damper(float x, float g, float factor)
+template<typename T>
+constexpr T lerp(const T& x, const T& y, float a)
 {
-    return lerp(x, g, factor);
+    return x * (1.0f - a) + y * a;
 }
 
-float damper_bad(float x, float g, float damping, float dt)
+constexpr float squaref(float x)
 {
-    return lerp(x, g, damping * dt);
+    return x * x;
 }
 
-float damper_exponential(
-    float x,
-    float g,
-    float damping,
-    float dt,
-    float ft = 1.0f / 60.0f)
+// Reference for fast_negexp().
+inline float negexp(float x)
 {
-    return lerp(x, g, 1.0f - powf(1.0 / (1.0 - ft * damping), -dt / ft));
+    return expf(-x);
 }
 
-
-float fast_negexp(float x)
+// Approximates exp(-x) for x >= 0, off by less than 0.02 (largest around x = 3.3). Goes to 0 for large x like exp(-x).
+constexpr float fast_negexp(float x)
 {
     return 1.0f / (1.0f + x + 0.48f * x * x + 0.235f * x * x * x);
 }
 
-float damper_implicit(float x, float g, float halflife, float dt, float eps = 1e-5f)
+inline float fast_atan(float x)
 {
-    return lerp(x, g, 1.0f - fast_negexp((0.69314718056f * dt) / (halflife + eps)));
+    float z = fabsf(x);
+    float w = z > 1.0f ? 1.0f / z : z;
+    float y = (pi / 4.0f) * w - w * (w - 1.0f) * (0.2447f + 0.0663f * w);
+    return copysignf(z > 1.0f ? pi / 2.0f - y : y, x);
 }
 
 //--------------------------------------
 
-void spring_damper_bad(
-    float& x,
-    float& v,
-    float g,
-    float q,
-    float stiffness,
-    float damping,
-    float dt)
+constexpr float halflife_to_damping(float halflife, float eps = 1e-5f)
 {
-    v += dt * stiffness * (g - x) + dt * damping * (q - v);
-    x += dt * v;
+    return (4.0f * ln2) / (halflife + eps);
 }
 
-float fast_atan(float x)
+constexpr float damping_to_halflife(float damping, float eps = 1e-5f)
 {
-    float z = fabs(x);
-    float w = z > 1.0f ? 1.0f / z : z;
-    float y = (PI / 4.0f) * w - w * (w - 1) * (0.2447f + 0.0663f * w);
-    return copysign(z > 1.0f ? PI / 2.0 - y : y, x);
+    return (4.0f * ln2) / (damping + eps);
 }
 
-float squaref(float x)
+constexpr float frequency_to_stiffness(float frequency)
 {
-    return x * x;
+    return squaref(2.0f * pi * frequency);
 }
 
-float halflife_to_damping(float halflife, float eps = 1e-5f)
+inline float stiffness_to_frequency(float stiffness)
 {
-    return (4.0f * 0.69314718056f) / (halflife + eps);
+    return sqrtf(stiffness) / (2.0f * pi);
 }
 
-float damping_to_halflife(float damping, float eps = 1e-5f)
+inline float critical_halflife(float frequency)
 {
-    return (4.0f * 0.69314718056f) / (damping + eps);
+    return damping_to_halflife(sqrtf(frequency_to_stiffness(frequency) * 4.0f));
 }
 
-float frequency_to_stiffness(float frequency)
+inline float critical_frequency(float halflife)
 {
-    return squaref(2.0f * PI * frequency);
+    return stiffness_to_frequency(squaref(halflife_to_damping(halflife)) / 4.0f);
 }
 
-float stiffness_to_frequency(float stiffness)
+//--------------------------------------
+
+template<typename T>
+constexpr T damper(const T& x, const T& g, float factor)
 {
-    return sqrtf(stiffness) / (2.0f * PI);
+    return lerp(x, g, factor);
 }
 
-float critical_halflife(float frequency)
+template<typename T>
+inline T damper_exponential(
+    const T& x,
+    const T& g,
+    float damping,
+    float dt,
+    float ft = 1.0f / 60.0f)
 {
-    return damping_to_halflife(sqrtf(frequency_to_stiffness(frequency) * 4.0f));
+    return lerp(x, g, 1.0f - powf(1.0f / (1.0f - ft * damping), -dt / ft));
 }
 
-float critical_frequency(float halflife)
+// Moves x towards g, halfway in halflife seconds, independently of the frame rate.
+template<typename T>
+constexpr T damper_implicit(const T& x, const T& g, float halflife, float dt, float eps = 1e-5f)
 {
-    return stiffness_to_frequency(squaref(halflife_to_damping(halflife)) / 4.0f);
+    return lerp(x, g, 1.0f - fast_negexp((ln2 * dt) / (halflife + eps)));
 }
 
-void spring_damper_implicit(
+//--------------------------------------
+
+inline void spring_damper_implicit(
     float& x,
     float& v,
     float x_goal,
@@ -144,7 +154,7 @@ void spring_damper_implicit(
     float c = g + (d * q) / (s + eps);
     float y = d / 2.0f;
 
-    if (fabs(s - (d * d) / 4.0f) < eps) // Critically Damped
+    if (fabsf(s - (d * d) / 4.0f) < eps) // Critically Damped
     {
         float j0 = x - c;
         float j1 = v + j0 * y;
@@ -154,7 +164,7 @@ void spring_damper_implicit(
         x = j0 * eydt + dt * j1 * eydt + c;
         v = -y * j0 * eydt - y * dt * j1 * eydt + j1 * eydt;
     }
-    else if (s - (d * d) / 4.0f > 0.0) // Under Damped
+    else if (s - (d * d) / 4.0f > 0.0f) // Under Damped
     {
         float w = sqrtf(s - (d * d) / 4.0f);
         float j = sqrtf(squaref(v + y * (x - c)) / (w * w + eps) + squaref(x - c));
@@ -167,7 +177,7 @@ void spring_damper_implicit(
         x = j * eydt * cosf(w * dt + p) + c;
         v = -y * j * eydt * cosf(w * dt + p) - w * j * eydt * sinf(w * dt + p);
     }
-    else if (s - (d * d) / 4.0f < 0.0) // Over Damped
+    else if (s - (d * d) / 4.0f < 0.0f) // Over Damped
     {
         float y0 = (d + sqrtf(d * d - 4 * s)) / 2.0f;
         float y1 = (d - sqrtf(d * d - 4 * s)) / 2.0f;
@@ -184,87 +194,92 @@ void spring_damper_implicit(
 
 //--------------------------------------
 
-void critical_spring_damper_implicit(
-    float& x,
-    float& v,
-    float x_goal,
-    float v_goal,
+template<typename T>
+inline void critical_spring_damper_implicit(
+    T& x,
+    T& v,
+    const T& x_goal,
+    const T& v_goal,
     float halflife,
     float dt)
 {
-    float g = x_goal;
-    float q = v_goal;
     float d = halflife_to_damping(halflife);
-    float c = g + (d * q) / ((d * d) / 4.0f);
     float y = d / 2.0f;
-    float j0 = x - c;
-    float j1 = v + j0 * y;
+    T c = x_goal + v_goal * (d / ((d * d) / 4.0f));
+    T j0 = x - c;
+    T j1 = v + j0 * y;
     float eydt = fast_negexp(y * dt);
 
-    x = eydt * (j0 + j1 * dt) + c;
-    v = eydt * (v - j1 * y * dt);
+    x = (j0 + j1 * dt) * eydt + c;
+    v = (v - j1 * (y * dt)) * eydt;
 }
 
-void simple_spring_damper_implicit(
-    float& x,
-    float& v,
-    float x_goal,
+template<typename T>
+inline void simple_spring_damper_implicit(
+    T& x,
+    T& v,
+    const T& x_goal,
     float halflife,
     float dt)
 {
     float y = halflife_to_damping(halflife) / 2.0f;
-    float j0 = x - x_goal;
-    float j1 = v + j0 * y;
+    T j0 = x - x_goal;
+    T j1 = v + j0 * y;
     float eydt = fast_negexp(y * dt);
 
-    x = eydt * (j0 + j1 * dt) + x_goal;
-    v = eydt * (v - j1 * y * dt);
+    x = (j0 + j1 * dt) * eydt + x_goal;
+    v = (v - j1 * (y * dt)) * eydt;
 }
 
-void decay_spring_damper_implicit(
-    float& x,
-    float& v,
+template<typename T>
+inline void decay_spring_damper_implicit(
+    T& x,
+    T& v,
     float halflife,
     float dt)
 {
     float y = halflife_to_damping(halflife) / 2.0f;
-    float j1 = v + x * y;
+    T j1 = v + x * y;
     float eydt = fast_negexp(y * dt);
 
-    x = eydt * (x + j1 * dt);
-    v = eydt * (v - j1 * y * dt);
+    x = (x + j1 * dt) * eydt;
+    v = (v - j1 * (y * dt)) * eydt;
 }
 
 //--------------------------------------
 
-
-void spring_character_update(
-    float& x,
-    float& v,
-    float& a,
-    float v_goal,
+// Integrates position x, velocity v and acceleration a of a character whose velocity springs towards v_goal.
+template<typename T>
+inline void spring_character_update(
+    T& x,
+    T& v,
+    T& a,
+    const T& v_goal,
     float halflife,
     float dt)
 {
     float y = halflife_to_damping(halflife) / 2.0f;
-    float j0 = v - v_goal;
-    float j1 = a + j0 * y;
+    T j0 = v - v_goal;
+    T j1 = a + j0 * y;
     float eydt = fast_negexp(y * dt);
+    float iy = 1.0f / y;
 
-    x = eydt * ((j1 * dt) / y) + dt * v_goal + x;
-    v = eydt * (j0 + j1 * dt) + v_goal;
-    a = eydt * (a - j1 * y * dt);
+    // Exact integral of the velocity below over dt: eydt * (-j1 / y^2 + (-j0 - j1 * dt) / y) + j1 / y^2 + j0 / y + v_goal * dt.
+    x = (j1 * (iy * iy) + j0 * iy) - (j1 * (iy * iy) + (j0 + j1 * dt) * iy) * eydt + v_goal * dt + x;
+    v = (j0 + j1 * dt) * eydt + v_goal;
+    a = (a - j1 * (y * dt)) * eydt;
 }
 
-void spring_character_predict(
-    float px[],
-    float pv[],
-    float pa[],
+template<typename T>
+inline void spring_character_predict(
+    T px[],
+    T pv[],
+    T pa[],
     int count,
-    float x,
-    float v,
-    float a,
-    float v_goal,
+    const T& x,
+    const T& v,
+    const T& a,
+    const T& v_goal,
     float halflife,
     float dt)
 {
@@ -279,4 +294,84 @@ void spring_character_predict(
     {
         spring_character_update(px[i], pv[i], pa[i], v_goal, halflife, i * dt);
     }
-}
\ No newline at end of file
+}
+
+//--------------------------------------
+// Batches. Element i of every array is one spring.
+//--------------------------------------
+
+inline void damper_implicit_batch(float x[], const float g[], int count, float halflife, float dt, float eps = 1e-5f)
+{
+    const float factor = 1.0f - fast_negexp((ln2 * dt) / (halflife + eps));
+
+    for (int i = 0; i < count; i++)
+    {
+        x[i] = lerp(x[i], g[i], factor);
+    }
+}
+
+inline void simple_spring_damper_implicit_batch(
+    float x[],
+    float v[],
+    const float x_goal[],
+    int count,
+    float halflife,
+    float dt)
+{
+    const float y = halflife_to_damping(halflife) / 2.0f;
+    const float eydt = fast_negexp(y * dt);
+
+    for (int i = 0; i < count; i++)
+    {
+        float j0 = x[i] - x_goal[i];
+        float j1 = v[i] + j0 * y;
+
+        x[i] = (j0 + j1 * dt) * eydt + x_goal[i];
+        v[i] = (v[i] - j1 * (y * dt)) * eydt;
+    }
+}
+
+inline void decay_spring_damper_implicit_batch(
+    float x[],
+    float v[],
+    int count,
+    float halflife,
+    float dt)
+{
+    const float y = halflife_to_damping(halflife) / 2.0f;
+    const float eydt = fast_negexp(y * dt);
+
+    for (int i = 0; i < count; i++)
+    {
+        float j1 = v[i] + x[i] * y;
+
+        x[i] = (x[i] + j1 * dt) * eydt;
+        v[i] = (v[i] - j1 * (y * dt)) * eydt;
+    }
+}
+
+inline void spring_character_update_batch(
+    float x[],
+    float v[],
+    float a[],
+    const float v_goal[],
+    int count,
+    float halflife,
+    float dt)
+{
+    const float y = halflife_to_damping(halflife) / 2.0f;
+    const float eydt = fast_negexp(y * dt);
+    const float iy = 1.0f / y;
+
+    for (int i = 0; i < count; i++)
+    {
+        float j0 = v[i] - v_goal[i];
+        float j1 = a[i] + j0 * y;
+
+        x[i] = (j1 * (iy * iy) + j0 * iy) - (j1 * (iy * iy) + (j0 + j1 * dt) * iy) * eydt + v_goal[i] * dt + x[i];
+        v[i] = (j0 + j1 * dt) * eydt + v_goal[i];
+        a[i] = (a[i] - j1 * (y * dt)) * eydt;
+    }
+}
+
+} // namespace Spring
@@ -52,6 +52,19 @@ FTransform GetBoneT(UAnimSequence* anim, const float time, const FName boneName)
     return boneT;
 }
 
+// Lerps the two keys of a root track (xyz translation, w unwrapped yaw) around time. Keys are interval seconds apart.
+FTransform SampleRootTrack(const TArray<FVector4>& keys, float interval, float time)
+{
+    if (keys.Num() == 0 || interval <= 0.f) return FTransform::Identity;
+
+    const float position = FMath::Clamp(time / interval, 0.f, (float)(keys.Num() - 1));
+    const int32 index = FMath::Min(FMath::FloorToInt(position), keys.Num() - 1);
+    const FVector4 key = FMath::Lerp(keys[index], keys[FMath::Min(index + 1, keys.Num() - 1)], position - index);
+
+    // Yaw is unwrapped when baked, so it lerps across +-180 just fine.
+    return FTransform(FRotator(0.f, key.W, 0.f), FVector(key.X, key.Y, key.Z));
+}
+
 float GetTimeAtFrame(const int32 frame, int32 totalFrames, float sequenceLength)
 {
     const float FrameTime = totalFrames > 1 ? sequenceLength / (float)(totalFrames - 1) : 0.0f;
@@ -65,244 +78,107 @@ float GetTimeAtFrame(const int32 frame, int32 totalFrames, float sequenceLength)
 
 void NormalizeCache()
 {
-    auto getVectorSum = [&](FVector& v) {
-        return v.X + v.Y + v.Z;
-    };
-
-    auto getVectorSqrDeviations = [&](FVector& v, FFeatureNormalData& normalData) {
-        return FMath::Square(v.X - normalData.Mean) + FMath::Square(v.Y - normalData.Mean) + FMath::Square(v.Z - normalData.Mean);
-    };
-
-    auto normalizeFloat = [&](float& f, FFeatureNormalData& normalData) {
-        f = (f - normalData.Mean) / normalData.StandardDeviation;
-    };
-
-    // normalizes a 3D feature using Z-score standardization 
-    auto normalizeVector = [&](FVector& v, FFeatureNormalData& normalData) {
-        v.X = (v.X - normalData.Mean) / normalData.StandardDeviation;
-        v.Y = (v.Y - normalData.Mean) / normalData.StandardDeviation;
-        v.Z = (v.Z - normalData.Mean) / normalData.StandardDeviation;
-    };
-
-    //
-    // Calculate the normalization data
-    //
-
-    // set everything to zero to not mess up our arithmetic
-    MotionData->NormalData_RootVelocity.SetDefaultValues();
-    MotionData->NormalData_RootRotationSpeed.SetDefaultValues();
-
-    // DEPRECATED
-    MotionData->NormalData_Trajectory.Empty();
-    MotionData->NormalData_Trajectory.AddDefaulted(2);
-    //
-
-    MotionData->NormalData_TrajectoryPosition.Empty();
-    MotionData->NormalData_TrajectoryPosition.AddDefaulted(MotionData->TrajectoryTimings.Num());
-
-    MotionData->NormalData_TrajectoryFacing.Empty();
-    MotionData->NormalData_TrajectoryFacing.AddDefaulted(MotionData->TrajectoryTimings.Num());
-
-    MotionData->NormalData_BonePosition.Empty();
-    MotionData->NormalData_BonePosition.AddDefaulted(MotionData->PoseMatchingBones.Num());
+    const int32 numBones = MotionData->PoseMatchingBones.Num();
+    const int32 numPoints = MotionData->TrajectoryTimings.Num();
 
-    MotionData->NormalData_BoneVelocity.Empty();
-    MotionData->NormalData_BoneVelocity.AddDefaulted(MotionData->PoseMatchingBones.Num());
+    // Lay the raw features out in rows like the runtime database does, so the core computes the stats and normalizes.
+    MMCore::FeatureLayout L;
+    L.Init(numBones, numPoints);
 
-    for (int32 i = 0; i != MotionData->PoseMatchingBones.Num(); ++i)
-    {
-        MotionData->NormalData_BonePosition[i].SetDefaultValues();
-        MotionData->NormalData_BoneVelocity[i].SetDefaultValues();
-    }
-
-    // sum and means
+    TArray<FMMatcherPoseSample*> poses;
 
     for (auto& State : MotionData->States)
     {
         for (auto& PoseSample : State.CachedPoses)
-        {
-            MotionData->NormalData_RootVelocity.Count += 3; // 3 because vector 3D
-            MotionData->NormalData_RootVelocity.Sum += getVectorSum(PoseSample.RootVelocity);
-
-            MotionData->NormalData_RootRotationSpeed.Count++;
-            MotionData->NormalData_RootRotationSpeed.Sum += PoseSample.RootRotationSpeed;
-
-            // trajectory
-
-            for (int32 i = 0; i != MotionData->TrajectoryTimings.Num(); ++i)
-            {
-                FTrajectoryPoint& TrajPoint = PoseSample.Trajectory[i];
-
-                // Position
-                MotionData->NormalData_TrajectoryPosition[i].Count += 3; // 3d vector
-                MotionData->NormalData_TrajectoryPosition[i].Sum += getVectorSum(TrajPoint.Position);
-
-                MotionData->NormalData_TrajectoryFacing[i].Count++;
-                MotionData->NormalData_TrajectoryFacing[i].Sum += TrajPoint.Facing;
-            }
-
-            /*for (auto& TrajPoint : PoseSample.Trajectory)
-            {
-                // Position
-                MotionData->NormalData_Trajectory[0].Count++;
-                MotionData->NormalData_Trajectory[0].Sum += getVectorSum(TrajPoint.Position);
-
-                // Facing
-                MotionData->NormalData_Trajectory[1].Count++;
-                MotionData->NormalData_Trajectory[1].Sum += TrajPoint.Facing;
-            }*/
-
-            // Bones
-
-            for (int32 i = 0; i != MotionData->PoseMatchingBones.Num(); ++i)
-            {
-                MotionData->NormalData_BonePosition[i].Count += 3; // 3d vector
-                MotionData->NormalData_BonePosition[i].Sum += getVectorSum(PoseSample.BoneData[i].Position);
-
-                MotionData->NormalData_BoneVelocity[i].Count += 3; // 3d vector
-                MotionData->NormalData_BoneVelocity[i].Sum += getVectorSum(PoseSample.BoneData[i].Velocity);
-            }
-        }
+            poses.Add(&PoseSample);
     }
 
-    MotionData->NormalData_RootVelocity.Mean = MotionData->NormalData_RootVelocity.Sum / MotionData->NormalData_RootVelocity.Count; 
-    MotionData->NormalData_RootRotationSpeed.Mean = MotionData->NormalData_RootRotationSpeed.Sum / MotionData->NormalData_RootRotationSpeed.Count;
-    //MotionData->NormalData_Trajectory[0].Mean = MotionData->NormalData_Trajectory[0].Sum / MotionData->NormalData_Trajectory[0].Count;
-    //MotionData->NormalData_Trajectory[1].Mean = MotionData->NormalData_Trajectory[1].Sum / MotionData->NormalData_Trajectory[1].Count;
-    //MotionData->NormalData_TrajectoryPosition
+    TArray<float> rows;
+    rows.AddZeroed(poses.Num() * L.Stride);
 
-    for (int32 i = 0; i != MotionData->TrajectoryTimings.Num(); ++i)
-    {
-        auto& fNormalPos = MotionData->NormalData_TrajectoryPosition[i];
-        auto& fNormalFacing = MotionData->NormalData_TrajectoryFacing[i];
+    auto readVec = [](const float* src) { return FVector(src[0], src[1], src[2]); };
+    auto writeVec = [](float* dst, const FVector& v) { dst[0] = v.X; dst[1] = v.Y; dst[2] = v.Z; };
 
-        fNormalPos.Mean = fNormalPos.Sum / fNormalPos.Count;
-        fNormalFacing.Mean = fNormalFacing.Sum / fNormalFacing.Count;
-    }
-
-    for (int32 i = 0; i != MotionData->PoseMatchingBones.Num(); ++i)
+    for (int32 poseIndex = 0; poseIndex != poses.Num(); ++poseIndex)
     {
-        MotionData->NormalData_BonePosition[i].Mean = MotionData->NormalData_BonePosition[i].Sum / MotionData->NormalData_BonePosition[i].Count;
-        MotionData->NormalData_BoneVelocity[i].Mean = MotionData->NormalData_BoneVelocity[i].Sum / MotionData->NormalData_BoneVelocity[i].Count;
-    }
+        const FMMatcherPoseSample& pose = *poses[poseIndex];
+        float* row = rows.GetData() + poseIndex * L.Stride;
 
-    // variances
+        writeVec(row + L.RootVelocity, pose.RootVelocity);
+        row[L.RootRotationSpeed] = pose.RootRotationSpeed;
 
-    for (auto& State : MotionData->States)
-    {
-        for (auto& PoseSample : State.CachedPoses)
+        for (int32 i = 0; i != numBones; ++i)
         {
-            MotionData->NormalData_RootVelocity.Variance += getVectorSqrDeviations(PoseSample.RootVelocity, MotionData->NormalData_RootVelocity);
-            MotionData->NormalData_RootRotationSpeed.Variance += FMath::Square(PoseSample.RootRotationSpeed - MotionData->NormalData_RootRotationSpeed.Mean);
-
-
-            /*for (auto& TrajPoint : PoseSample.Trajectory)
-            {
-                // Position
-                MotionData->NormalData_Trajectory[0].Variance += getVectorSqrDeviations(TrajPoint.Position, MotionData->NormalData_Trajectory[0]);
-
-                // Facing
-                MotionData->NormalData_Trajectory[1].Variance += FMath::Square(TrajPoint.Facing - MotionData->NormalData_Trajectory[1].Mean);
-            }*/
-
-            for (int32 i = 0; i != PoseSample.Trajectory.Num(); ++i)
-            {
-                auto& trajPoint = PoseSample.Trajectory[i];
-
-                auto& fNormalPos = MotionData->NormalData_TrajectoryPosition[i];
-                auto& fNormalFacing = MotionData->NormalData_TrajectoryFacing[i];
-
-                fNormalPos.Variance += getVectorSqrDeviations(trajPoint.Position, fNormalPos);
-                fNormalFacing.Variance += FMath::Square(trajPoint.Facing - fNormalFacing.Mean);
-            }
+            writeVec(row + L.Bones + i * 6, pose.BoneData[i].Position);
+            writeVec(row + L.Bones + i * 6 + 3, pose.BoneData[i].Velocity);
+        }
 
-            for (int32 i = 0; i != MotionData->PoseMatchingBones.Num(); ++i)
-            {
-                MotionData->NormalData_BonePosition[i].Variance += getVectorSqrDeviations(PoseSample.BoneData[i].Position, MotionData->NormalData_BonePosition[i]);
-                MotionData->NormalData_BoneVelocity[i].Variance += getVectorSqrDeviations(PoseSample.BoneData[i].Velocity, MotionData->NormalData_BoneVelocity[i]);
-            }            
+        for (int32 i = 0; i != numPoints; ++i)
+        {
+            writeVec(row + L.TrajectoryPosition + i * 3, pose.Trajectory[i].Position);
+            row[L.TrajectoryFacing + i] = pose.Trajectory[i].Facing;
         }
     }
 
-    MotionData->NormalData_RootVelocity.Variance = MotionData->NormalData_RootVelocity.Variance / MotionData->NormalData_RootVelocity.Count;
-    MotionData->NormalData_RootRotationSpeed.Variance = MotionData->NormalData_RootRotationSpeed.Variance / MotionData->NormalData_RootRotationSpeed.Count;
-
-    for (int32 i = 0; i != MotionData->TrajectoryTimings.Num(); ++i)
-    {
-        auto& fNormalPos = MotionData->NormalData_TrajectoryPosition[i];
-        auto& fNormalFacing = MotionData->NormalData_TrajectoryFacing[i];
+    //
+    // Calculate the normalization data and normalize the features independently
+    //
 
-        fNormalPos.Variance = fNormalPos.Variance / fNormalPos.Count;
-        fNormalFacing.Variance = fNormalFacing.Variance / fNormalFacing.Count;
-    }
+    // DEPRECATED
+    MotionData->NormalData_Trajectory.Empty();
+    MotionData->NormalData_Trajectory.AddDefaulted(2);
+    //
 
-    for (int32 i = 0; i != MotionData->PoseMatchingBones.Num(); ++i)
-    {
-        MotionData->NormalData_BonePosition[i].Variance = MotionData->NormalData_BonePosition[i].Variance / MotionData->NormalData_BonePosition[i].Count;
-        MotionData->NormalData_BoneVelocity[i].Variance = MotionData->NormalData_BoneVelocity[i].Variance / MotionData->NormalData_BoneVelocity[i].Count;
-    }
+    MotionData->NormalData_TrajectoryPosition.Empty();
+    MotionData->NormalData_TrajectoryPosition.AddDefaulted(numPoints);
 
-    //
-    // standard deviations
-    //
+    MotionData->NormalData_TrajectoryFacing.Empty();
+    MotionData->NormalData_TrajectoryFacing.AddDefaulted(numPoints);
 
-    // SD may be NaN if variance=0 so here we fall back to zero if so.
-    MotionData->NormalData_RootVelocity.StandardDeviation = (MotionData->NormalData_RootVelocity.Variance) ? FMath::Sqrt(MotionData->NormalData_RootVelocity.Variance) : 1.0f;
-    MotionData->NormalData_RootVelocity.StdInverse = 1.0f / MotionData->NormalData_RootVelocity.StandardDeviation;
-    MotionData->NormalData_RootVelocity.UserWeight = MotionData->RootVelocityWeight;
+    MotionData->NormalData_BonePosition.Empty();
+    MotionData->NormalData_BonePosition.AddDefaulted(numBones);
 
-    MotionData->NormalData_RootRotationSpeed.StandardDeviation = (MotionData->NormalData_RootRotationSpeed.Variance) ? FMath::Sqrt(MotionData->NormalData_RootRotationSpeed.Variance) : 1.0f;
-    MotionData->NormalData_RootRotationSpeed.StdInverse = 1.0f / MotionData->NormalData_RootRotationSpeed.StandardDeviation;
-    MotionData->NormalData_RootRotationSpeed.UserWeight = 1.0f; // TODO: no custom weight?
+    MotionData->NormalData_BoneVelocity.Empty();
+    MotionData->NormalData_BoneVelocity.AddDefaulted(numBones);
 
-    for (int32 i = 0; i != MotionData->TrajectoryTimings.Num(); ++i)
-    {
-        auto& fNormalPos = MotionData->NormalData_TrajectoryPosition[i];
-        auto& fNormalFacing = MotionData->NormalData_TrajectoryFacing[i];
+    auto normalize = [&rows, &poses, &L](int32 column, int32 width, float weight, FFeatureNormalData& normalData) {
+        FMotionDatabase::NormalizeFeature(rows.GetData(), poses.Num(), L.Stride, column, width, weight, normalData);
+    };
 
-        fNormalPos.StandardDeviation = (fNormalPos.Variance) ? FMath::Sqrt(fNormalPos.Variance) : 1.0f;
-        fNormalPos.StdInverse = 1.0f / fNormalPos.StandardDeviation;
-        fNormalPos.UserWeight = MotionData->TrajectoryWeight * MotionData->TrajectoryWeights[i];
+    normalize(L.RootVelocity, 3, MotionData->RootVelocityWeight, MotionData->NormalData_RootVelocity);
+    normalize(L.RootRotationSpeed, 1, 1.0f, MotionData->NormalData_RootRotationSpeed); // TODO: no custom weight?
 
-        fNormalFacing.StandardDeviation = (fNormalFacing.Variance) ? FMath::Sqrt(fNormalFacing.Variance) : 1.0f;
-        fNormalFacing.StdInverse = 1.0f / fNormalFacing.StandardDeviation;
-        fNormalFacing.UserWeight = MotionData->TrajectoryFacingWeights[i] * MotionData->TrajectoryFacingWeight;
+    for (int32 i = 0; i != numPoints; ++i)
+    {
+        normalize(L.TrajectoryPosition + i * 3, 3, MotionData->TrajectoryWeight * MotionData->TrajectoryWeights[i], MotionData->NormalData_TrajectoryPosition[i]);
+        normalize(L.TrajectoryFacing + i, 1, MotionData->TrajectoryFacingWeights[i] * MotionData->TrajectoryFacingWeight, MotionData->NormalData_TrajectoryFacing[i]);
     }
 
-    for (int32 i = 0; i != MotionData->PoseMatchingBones.Num(); ++i)
+    for (int32 i = 0; i != numBones; ++i)
     {
-        MotionData->NormalData_BonePosition[i].StandardDeviation = (MotionData->NormalData_BonePosition[i].Variance) ? FMath::Sqrt(MotionData->NormalData_BonePosition[i].Variance) : 1.0f;
-        MotionData->NormalData_BonePosition[i].StdInverse = 1.0f / MotionData->NormalData_BonePosition[i].StandardDeviation;
-        MotionData->NormalData_BonePosition[i].UserWeight = MotionData->BonePositionWeight;
-
-        MotionData->NormalData_BoneVelocity[i].StandardDeviation = (MotionData->NormalData_BoneVelocity[i].Variance) ? FMath::Sqrt(MotionData->NormalData_BoneVelocity[i].Variance) : 1.0f;
-        MotionData->NormalData_BoneVelocity[i].StdInverse = 1.0f / MotionData->NormalData_BoneVelocity[i].StandardDeviation;
-        MotionData->NormalData_BoneVelocity[i].UserWeight = MotionData->BoneVelocityWeight;
+        normalize(L.Bones + i * 6, 3, MotionData->BonePositionWeight, MotionData->NormalData_BonePosition[i]);
+        normalize(L.Bones + i * 6 + 3, 3, MotionData->BoneVelocityWeight, MotionData->NormalData_BoneVelocity[i]);
     }
 
-    //
-    // custom weights
-    //
+    // Back into the cache.
+    for (int32 poseIndex = 0; poseIndex != poses.Num(); ++poseIndex)
+    {
+        FMMatcherPoseSample& pose = *poses[poseIndex];
+        const float* row = rows.GetData() + poseIndex * L.Stride;
 
+        pose.RootVelocity = readVec(row + L.RootVelocity);
+        pose.RootRotationSpeed = row[L.RootRotationSpeed];
 
-    //
-    // Normalize the features independently
-    //
-
-    for (auto& State : MotionData->States)
-    {
-        for (auto& PoseSample : State.CachedPoses)
+        for (int32 i = 0; i != numBones; ++i)
         {
-            MotionData->NormalizeFeature(PoseSample.RootVelocity, MotionData->NormalData_RootVelocity);
-            MotionData->NormalizeFeature(PoseSample.RootRotationSpeed, MotionData->NormalData_RootRotationSpeed);
-
-            MotionData->NormalizeTrajectory(PoseSample.Trajectory);
+            pose.BoneData[i].Position = readVec(row + L.Bones + i * 6);
+            pose.BoneData[i].Velocity = readVec(row + L.Bones + i * 6 + 3);
+        }
 
-            for (int32 i = 0; i != MotionData->PoseMatchingBones.Num(); ++i)
-            {
-                MotionData->NormalizeFeature(PoseSample.BoneData[i].Position, MotionData->NormalData_BonePosition[i]);
-                MotionData->NormalizeFeature(PoseSample.BoneData[i].Velocity, MotionData->NormalData_BoneVelocity[i]);
-            }
+        for (int32 i = 0; i != numPoints; ++i)
+        {
+            pose.Trajectory[i].Position = readVec(row + L.TrajectoryPosition + i * 3);
+            pose.Trajectory[i].Facing = row[L.TrajectoryFacing + i];
         }
     }
 }
@@ -352,6 +228,10 @@ void BuildMotionCache(const TWeakObjectPtr<UMotionData> motionDataAsset)
 
     NormalizeCache();
 
+    // The runtime database is rebuilt from the new cache the next time a matcher asks for it.
+
+    MotionData->InvalidateDatabase();
+
     // Apply user weights (makes features matter more/less)
 
     //ApplyWeights();
@@ -384,6 +264,56 @@ void BuildMotionCache_PerState(FMMatcherState& state)
 
     // Delete the old data.
     state.CachedPoses.Empty();
+
+    // Bake the root track, one key per animation frame. Everything below samples root motion from it instead of
+    // decompressing the animation twice per pose.
+    TArray<FVector4> rootTrack;
+    rootTrack.Reserve(frames);
+
+    const float frameInterval = (frames > 1) ? anim->GetPlayLength() / (frames - 1) : 0.f;
+
+    float unwrappedYaw = 0.f;
+
+    for (int32 frame = 0; frame != frames; ++frame)
+    {
+        FTransform rootT = anim->ExtractRootMotion(0.f, FMath::Min(frame * frameInterval, anim->GetPlayLength()), false);
+        float yaw = rootT.GetRotation().Rotator().Yaw;
+
+        // Keep yaw continuous so lerping two keys never takes the long way around.
+        if (frame != 0)
+            yaw = unwrappedYaw + FRotator::NormalizeAxis(yaw - unwrappedYaw);
+
+        unwrappedYaw = yaw;
+        rootTrack.Add(FVector4(rootT.GetLocation(), yaw));
+    }
+
+    // Bake both feet the same way and find their contacts, one per animation frame. Feet that aren't set stay planted.
+    TArray<uint8> frameContacts[2];
+    const FBoneReference* feet[2] = { &MotionData->LeftFoot, &MotionData->RightFoot };
+
+    MMCore::ContactParams contactParams;
+    contactParams.EnterSpeed = MotionData->FootContactSpeed;
+    contactParams.ExitSpeed = MotionData->FootReleaseSpeed;
+    contactParams.MaxHeight = MotionData->FootContactMaxHeight;
+
+    for (int32 foot = 0; foot != 2; ++foot)
+    {
+        frameContacts[foot].Init(1, frames);
+
+        if (feet[foot]->BoneIndex == 0) continue;
+
+        TArray<FVector> footTrack;
+        footTrack.Reserve(frames);
+
+        for (int32 frame = 0; frame != frames; ++frame)
+            footTrack.Add(GetRootSpaceTransform(anim, FMath::Min(frame * frameInterval, anim->GetPlayLength()), feet[foot]->BoneName).GetLocation());
+
+        FMotionDatabase::DetectFootContacts(footTrack, frameInterval, contactParams, frameContacts[foot]);
+    }
+
+    auto sampleRoot = [&rootTrack, frameInterval](float time) {
+        return SampleRootTrack(rootTrack, frameInterval, time);
+    };
     //state.CachedPoses.Reserve(totalPoses);
 
     float endTime = anim->GetPlayLength() - MOTION_MATCHING_INTERVAL - 0.250f;  // TRIM THE LAST QUARTER SECOND? WHO NEEDS THIS!!?
@@ -408,46 +338,17 @@ void BuildMotionCache_PerState(FMMatcherState& state)
        
         // The trajectory transforms are relative to this current root transform.
         //FTransform currentRootT = GetRootSpaceTransform(anim, time, rootBoneName);
-        FTransform currentRootT = anim->ExtractRootMotion(0.f, time, false); // alternate method?
+        FTransform currentRootT = sampleRoot(time);
 
         // Future sample for root velocity.
         //FTransform futureRootT = GetRootSpaceTransform(anim, time + MOTION_MATCHING_INTERVAL, rootBoneName);
-        FTransform futureRootT = anim->ExtractRootMotion(0.f, time + MOTION_MATCHING_INTERVAL, false); // alternate method?
+        FTransform futureRootT = sampleRoot(time + MOTION_MATCHING_INTERVAL);
 
         pose.RootVelocity = (futureRootT.GetLocation() - currentRootT.GetLocation()) / MOTION_MATCHING_INTERVAL;
         pose.RootVelocity = pose.RootVelocity.RotateAngleAxis(-1 * currentRootT.GetRotation().Rotator().Yaw, FVector::UpVector);
         pose.RootRotationSpeed = (futureRootT.GetRotation().Rotator().Yaw - currentRootT.GetRotation().Rotator().Yaw) / MOTION_MATCHING_INTERVAL;
 
 
-        // Foot locking
-
-        auto shouldFootLock = [&] (FName& bN) { 
-            FTransform rBallT = GetRootSpaceTransform(anim, time, bN);
-            FTransform rBallT2 = GetRootSpaceTransform(anim, time + MOTION_MATCHING_INTERVAL, bN);
-
-            float toeSpeed = FMath::Abs(rBallT2.GetLocation().Size() - rBallT.GetLocation().Size());
-            //UE_LOG(LogTemp, Warning, TEXT("\nSPEED: %f."), toeSpeed);
-            if (toeSpeed < 0.5f) {
-               
-                return true;
-            }
-            else {
-                return false;
-            }
-        };
-        
-        if (MotionData->LeftFoot.BoneIndex != 0) {
-            //pose.bLFootLock = shouldFootLock(MotionData->LeftFoot.BoneName);
-            pose.FootLocks[0] = shouldFootLock(MotionData->LeftFoot.BoneName);
-
-            //UE_LOG(LogTemp, Warning, TEXT("Left lock: %d"), pose.FootLocks[0]);
-        }
-
-        if (MotionData->RightFoot.BoneIndex != 0) {
-            //pose.bRFootLock = shouldFootLock(MotionData->RightFoot.BoneName);
-            pose.FootLocks[1] = shouldFootLock(MotionData->RightFoot.BoneName);
-        }
-
         FTransform spine = GetRootSpaceTransform(anim, time, "spined");
         FVector spineFacing = spine.GetUnitAxis(EAxis::Y);
 
@@ -576,6 +477,18 @@ void BuildMotionCache_PerState(FMMatcherState& state)
         SampleCount++;
     }  
 
+    // Two bits per pose, the contact of the frame the pose lands on.
+    state.FootContacts.Reset();
+    state.FootContacts.AddZeroed((state.CachedPoses.Num() + 15) / 16);
+
+    for (int32 poseIndex = 0; poseIndex != state.CachedPoses.Num(); ++poseIndex)
+    {
+        const int32 frame = (frameInterval > 0.f) ? FMath::Clamp(FMath::RoundToInt(state.CachedPoses[poseIndex].Time / frameInterval), 0, frames - 1) : 0;
+        const uint32 contacts = frameContacts[0][frame] | (frameContacts[1][frame] << 1);
+
+        state.FootContacts[poseIndex >> 4] |= contacts << ((poseIndex & 15) * 2);
+    }
+
     for (auto& boneRef : MotionData->PoseMatchingBones)
     {
         FTransform boneTransform = GetRootSpaceTransform(anim, 0.f, boneRef.BoneName);
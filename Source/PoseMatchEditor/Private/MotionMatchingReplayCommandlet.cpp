@@ -0,0 +1,186 @@
+#include "MotionMatchingReplayCommandlet.h"
+#include "MotionData.h"
+#include "MotionMatchingCapture.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/Paths.h"
+
+namespace
+{
+	struct FReplayResult
+	{
+		TArray<double> Latencies;	// Microseconds, one per query.
+		double TotalSeconds = 0.0;
+		int32 CapturedAgreements = 0;
+		int32 BaselineAgreements = 0;
+		MMCore::SearchStats Stats;
+	};
+
+	double GetPercentile(const TArray<double>& sorted, double percentile)
+	{
+		if (sorted.Num() == 0) return 0.0;
+
+		const int32 index = FMath::Clamp(FMath::CeilToInt(percentile * sorted.Num()) - 1, 0, sorted.Num() - 1);
+		return sorted[index];
+	}
+
+	bool IsSameWinner(const FMotionSearchResult& a, const FMotionSearchResult& b)
+	{
+		return a.StateIndex == b.StateIndex && a.PoseIndex == b.PoseIndex;
+	}
+}
+
+UMotionMatchingReplayCommandlet::UMotionMatchingReplayCommandlet()
+{
+	IsClient = false;
+	IsEditor = true;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+int32 UMotionMatchingReplayCommandlet::Main(const FString& Params)
+{
+	FString capturePath;
+	int32 repeat = 1;
+
+	if (!FParse::Value(*Params, TEXT("Capture="), capturePath))
+	{
+		UE_LOG(LogTemp, Error, TEXT("Usage: -run=MotionMatchingReplay -Capture=<File.mmcap> [-Repeat=1]"));
+		return 1;
+	}
+
+	FParse::Value(*Params, TEXT("Repeat="), repeat);
+	repeat = FMath::Max(repeat, 1);
+
+	if (FPaths::IsRelative(capturePath) && !FPaths::FileExists(capturePath))
+		capturePath = FMotionCaptureWriter::GetCaptureDir() / capturePath;
+
+	FMotionCapture capture;
+
+	if (!capture.Load(capturePath))
+		return 1;
+
+	//
+	// Load the databases the capture refers to. Queries against missing or changed ones are skipped.
+	//
+
+	TArray<FMotionDatabasePtr> databases;
+
+	for (const FMotionCapturedDatabase& capturedDatabase : capture.Databases)
+	{
+		FMotionDatabasePtr database;
+
+		if (UMotionData* motionData = LoadObject<UMotionData>(nullptr, *capturedDatabase.Path))
+			database = motionData->GetDatabase();
+
+		if (!database.IsValid() || database->Layout.SearchDims != capturedDatabase.SearchDims)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Skipping queries against %s: asset missing or its features changed since the capture."), *capturedDatabase.Path);
+			database.Reset();
+		}
+		else if (database->Times.Num() != capturedDatabase.NumPoses)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("%s has %d poses, the capture had %d. Captured winners may not match."),
+				*capturedDatabase.Path, database->Times.Num(), capturedDatabase.NumPoses);
+		}
+
+		databases.Add(database);
+	}
+
+	TArray<int32> replayable;
+	TArray<double> capturedLatencies;
+
+	for (int32 i = 0; i != capture.Queries.Num(); ++i)
+	{
+		if (!databases[capture.Queries[i].Database].IsValid()) continue;
+
+		replayable.Add(i);
+		capturedLatencies.Add(capture.Queries[i].SearchMicroseconds);
+	}
+
+	UE_LOG(LogTemp, Display, TEXT("Replaying %d of %d captured queries from %s, %d time(s)."), replayable.Num(), capture.Queries.Num(), *capturePath, repeat);
+
+	if (replayable.Num() == 0)
+		return 1;
+
+	capturedLatencies.Sort();
+	UE_LOG(LogTemp, Display, TEXT("Captured: p50 %.2f us, p90 %.2f us, p99 %.2f us"),
+		GetPercentile(capturedLatencies, 0.5), GetPercentile(capturedLatencies, 0.9), GetPercentile(capturedLatencies, 0.99));
+
+	//
+	// Replay
+	//
+
+	const int32 numBackends = (int32)MMCore::SearchBackend::Count;
+	TArray<FReplayResult> results;
+	TArray<FMotionSearchResult> baseline;
+	results.SetNum(numBackends);
+	baseline.SetNum(capture.Queries.Num());
+
+	for (int32 backendIndex = 0; backendIndex != numBackends; ++backendIndex)
+	{
+		const MMCore::SearchBackend backend = (MMCore::SearchBackend)backendIndex;
+		FReplayResult& result = results[backendIndex];
+		result.Latencies.Reserve(replayable.Num() * repeat);
+
+		for (int32 pass = 0; pass != repeat; ++pass)
+		{
+			for (int32 queryIndex : replayable)
+			{
+				const FMotionCapturedQuery& q = capture.Queries[queryIndex];
+				const FMotionDatabase& db = *databases[q.Database];
+
+				// Biases may have been tweaked since the capture, search with the captured ones.
+				MMCore::DatabaseView view = db.GetView();
+				view.Biases.NaturalBias = q.NaturalBias;
+				view.Biases.LoopBias = q.LoopBias;
+
+				// Always search exactly so every backend can be checked against brute force.
+				FMotionSearchParams params = q.Params;
+				params.Tolerance = 0.f;
+
+				const uint64 start = FPlatformTime::Cycles64();
+				const FMotionSearchResult best = MMCore::Search(backend, view, &db.SearchIndex, q.Query.GetData(), params, pass == 0 ? &result.Stats : nullptr);
+				const double us = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - start) * 1000.0;
+
+				result.Latencies.Add(us);
+				result.TotalSeconds += us / 1000000.0;
+
+				if (pass != 0) continue;
+
+				if (backend == MMCore::SearchBackend::BruteForce)
+					baseline[queryIndex] = best;
+
+				result.CapturedAgreements += IsSameWinner(best, q.Result) ? 1 : 0;
+				result.BaselineAgreements += IsSameWinner(best, baseline[queryIndex]) ? 1 : 0;
+			}
+		}
+	}
+
+	//
+	// Report
+	//
+
+	bool bAllAgree = true;
+
+	for (int32 backendIndex = 0; backendIndex != numBackends; ++backendIndex)
+	{
+		FReplayResult& result = results[backendIndex];
+		result.Latencies.Sort();
+
+		const double count = replayable.Num();
+
+		UE_LOG(LogTemp, Display, TEXT("%-10s %10.0f queries/s | p50 %7.2f us, p90 %7.2f us, p99 %7.2f us, max %7.2f us | scanned %8.0f, pruned %8.0f | captured winner %6.2f%%, brute force winner %6.2f%%"),
+			ANSI_TO_TCHAR(MMCore::GetSearchBackendName((MMCore::SearchBackend)backendIndex)),
+			(result.TotalSeconds > 0.0) ? result.Latencies.Num() / result.TotalSeconds : 0.0,
+			GetPercentile(result.Latencies, 0.5), GetPercentile(result.Latencies, 0.9), GetPercentile(result.Latencies, 0.99), result.Latencies.Last(),
+			result.Stats.PosesScanned / count, result.Stats.PosesPruned / count,
+			100.0 * result.CapturedAgreements / count, 100.0 * result.BaselineAgreements / count);
+
+		bAllAgree &= result.BaselineAgreements == replayable.Num();
+	}
+
+	if (!bAllAgree)
+		UE_LOG(LogTemp, Error, TEXT("At least one search backend disagrees with brute force."));
+
+	return bAllAgree ? 0 : 1;
+}
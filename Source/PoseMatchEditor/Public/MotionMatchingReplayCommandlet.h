@@ -0,0 +1,25 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+
+#include "MotionMatchingReplayCommandlet.generated.h"
+
+/**
+ * Replays a motion matching query capture (see MotionMatchingCapture.h) against every search backend and reports
+ * throughput, latency percentiles and how often each backend agrees with the captured and brute-force winners.
+ *
+ * UE4Editor-Cmd.exe <Project> -run=MotionMatchingReplay -Capture=<File.mmcap> [-Repeat=1]
+ *
+ * Returns 1 if any backend picked a different pose than brute force.
+ */
+UCLASS()
+class POSEMATCHEDITOR_API UMotionMatchingReplayCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UMotionMatchingReplayCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
@@ -0,0 +1,88 @@
+// Copyright Wild Montage, LLC. All Rights Reserved.
+
+#include "Core/MMCoreContacts.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+using namespace MMCore;
+
+namespace
+{
+	// A foot moving along x at the given speeds (cm/s, towards the next key) at the given heights.
+	std::vector<float> MakeTrack(const std::vector<float>& speeds, const std::vector<float>& heights, float interval)
+	{
+		std::vector<float> positions;
+		float x = 0.f;
+
+		for (size_t i = 0; i != speeds.size(); ++i)
+		{
+			positions.push_back(x);
+			positions.push_back(0.f);
+			positions.push_back(heights[i]);
+			x += speeds[i] * interval;
+		}
+
+		return positions;
+	}
+
+	std::vector<uint8_t> Detect(const std::vector<float>& positions, float interval, const ContactParams& params)
+	{
+		std::vector<uint8_t> contacts(positions.size() / 3);
+		DetectContacts(positions.data(), (int32_t)contacts.size(), interval, params, contacts.data());
+		return contacts;
+	}
+}
+
+TEST(MMCoreContacts, Hysteresis)
+{
+	const float interval = 1.f / 30.f;
+	ContactParams params;
+	params.EnterSpeed = 15.f;
+	params.ExitSpeed = 30.f;
+	params.MaxHeight = 0.f;
+
+	// Speeds between the two thresholds keep whatever state the foot is in.
+	const std::vector<float> speeds = { 0.f, 20.f, 20.f, 40.f, 20.f, 20.f, 10.f, 20.f, 20.f };
+	const std::vector<float> heights(speeds.size(), 0.f);
+	const std::vector<uint8_t> expected = { 1, 1, 1, 0, 0, 0, 1, 1, 1 };
+
+	EXPECT_EQ(Detect(MakeTrack(speeds, heights, interval), interval, params), expected);
+}
+
+TEST(MMCoreContacts, StartsLiftedAboveEnterSpeed)
+{
+	const float interval = 0.1f;
+	ContactParams params;
+	params.MaxHeight = 0.f;
+
+	const std::vector<float> speeds = { 20.f, 20.f, 5.f, 5.f };
+	const std::vector<uint8_t> expected = { 0, 0, 1, 1 };
+
+	EXPECT_EQ(Detect(MakeTrack(speeds, std::vector<float>(4, 0.f), interval), interval, params), expected);
+}
+
+TEST(MMCoreContacts, HeightAboveLowestPoint)
+{
+	// Slow keys so raising the foot stays under the enter speed.
+	const float interval = 1.f;
+	ContactParams params;
+	params.MaxHeight = 10.f;
+
+	// Standing still the whole time but raised mid-way. Heights are relative to the lowest key (8 cm).
+	const std::vector<float> speeds(6, 0.f);
+	const std::vector<float> heights = { 8.f, 12.f, 25.f, 25.f, 17.f, 8.f };
+	const std::vector<uint8_t> expected = { 1, 1, 0, 0, 1, 1 };
+
+	EXPECT_EQ(Detect(MakeTrack(speeds, heights, interval), interval, params), expected);
+}
+
+TEST(MMCoreContacts, DegenerateTracksArePlanted)
+{
+	const float position[3] = { 1.f, 2.f, 3.f };
+	uint8_t contact = 0;
+
+	DetectContacts(position, 1, 0.1f, ContactParams(), &contact);
+	EXPECT_EQ(contact, 1);
+}
@@ -0,0 +1,112 @@
+// Copyright Wild Montage, LLC. All Rights Reserved.
+
+#include "Core/MMCoreNormalization.h"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <vector>
+
+using namespace MMCore;
+
+TEST(MMCoreNormalization, FeatureStatsPoolComponents)
+{
+	// Two rows of stride 4, stats over columns 1-2: values 1, 2, 3, 6.
+	const float rows[] = { 100.f, 1.f, 2.f, -100.f, 100.f, 3.f, 6.f, -100.f };
+	const FeatureStats stats = ComputeFeatureStats(rows, 2, 4, 1, 2);
+
+	EXPECT_DOUBLE_EQ(stats.Count, 4.0);
+	EXPECT_DOUBLE_EQ(stats.Mean, 3.0);
+	EXPECT_DOUBLE_EQ(stats.Variance, (4.0 + 1.0 + 0.0 + 9.0) / 4.0);
+	EXPECT_DOUBLE_EQ(stats.StandardDeviation, std::sqrt(3.5));
+}
+
+TEST(MMCoreNormalization, ConstantFeatureStaysFinite)
+{
+	const float rows[] = { 5.f, 5.f, 5.f };
+	const FeatureStats stats = ComputeFeatureStats(rows, 3, 1, 0, 1);
+
+	EXPECT_DOUBLE_EQ(stats.Variance, 0.0);
+	EXPECT_DOUBLE_EQ(stats.StandardDeviation, 1.0);
+}
+
+TEST(MMCoreNormalization, NormalizeColumnsGivesWeightedUnitDeviation)
+{
+	const int32_t numRows = 64, stride = 5, column = 1, width = 3;
+	std::vector<float> rows(numRows * stride);
+
+	for (int32_t i = 0; i != (int32_t)rows.size(); ++i)
+		rows[i] = std::sin(i * 0.37f) * 40.f + 12.f;
+
+	const std::vector<float> original = rows;
+	const float weight = 2.f;
+
+	const FeatureStats stats = ComputeFeatureStats(rows.data(), numRows, stride, column, width);
+	const FeatureNormal normal = MakeFeatureNormal(stats.Mean, stats.StandardDeviation, weight);
+	NormalizeColumns(rows.data(), numRows, stride, column, width, normal);
+
+	const FeatureStats normalized = ComputeFeatureStats(rows.data(), numRows, stride, column, width);
+	EXPECT_NEAR(normalized.Mean, 0.0, 1e-5);
+	EXPECT_NEAR(normalized.StandardDeviation, weight, 1e-4);
+
+	// Only the given columns change, and unnormalizing gets the raw values back.
+	for (int32_t row = 0; row != numRows; ++row)
+	{
+		for (int32_t c = 0; c != stride; ++c)
+		{
+			const int32_t i = row * stride + c;
+
+			if (c < column || c >= column + width)
+				EXPECT_EQ(rows[i], original[i]);
+			else
+				EXPECT_NEAR(normal.Unnormalize(rows[i]), original[i], 1e-3f);
+		}
+	}
+}
+
+TEST(MMCoreNormalization, BuildQueryNormalizesRawFeaturesAndCopiesBones)
+{
+	FeatureLayout layout;
+	layout.Init(2, 3);
+
+	std::vector<float> poseRow(layout.Stride);
+
+	for (int32_t i = 0; i != layout.Stride; ++i)
+		poseRow[i] = 1000.f + i;
+
+	FeatureNormal rootVelocityNormal;
+	rootVelocityNormal.Mean = 10.f;
+	rootVelocityNormal.Scale = 0.5f;
+
+	FeatureNormal positionNormals[3], facingNormals[3];
+
+	for (int32_t i = 0; i != 3; ++i)
+	{
+		positionNormals[i].Mean = float(i);
+		positionNormals[i].Scale = 0.1f * (i + 1);
+		facingNormals[i].Mean = -float(i);
+		facingNormals[i].Scale = 2.f;
+	}
+
+	const float rootVelocity[3] = { 12.f, 10.f, 8.f };
+	const float positions[9] = { 1.f, 2.f, 3.f, 4.f, 5.f, 6.f, 7.f, 8.f, 9.f };
+	const float facings[3] = { 10.f, 20.f, 30.f };
+
+	std::vector<float> query(layout.SearchDims, -1.f);
+	BuildQuery(layout, rootVelocityNormal, positionNormals, facingNormals, poseRow.data(), rootVelocity, positions, facings, query.data());
+
+	EXPECT_FLOAT_EQ(query[layout.RootVelocity + 0], 1.f);
+	EXPECT_FLOAT_EQ(query[layout.RootVelocity + 1], 0.f);
+	EXPECT_FLOAT_EQ(query[layout.RootVelocity + 2], -1.f);
+
+	for (int32_t i = 0; i != layout.NumBones * 6; ++i)
+		EXPECT_EQ(query[layout.Bones + i], poseRow[layout.Bones + i]);
+
+	for (int32_t p = 0; p != 3; ++p)
+	{
+		for (int32_t axis = 0; axis != 3; ++axis)
+			EXPECT_FLOAT_EQ(query[layout.TrajectoryPosition + p * 3 + axis], positionNormals[p].Normalize(positions[p * 3 + axis]));
+
+		EXPECT_FLOAT_EQ(query[layout.TrajectoryFacing + p], (facings[p] + p) * 2.f);
+	}
+}
@@ -0,0 +1,168 @@
+// Copyright Wild Montage, LLC. All Rights Reserved.
+
+#include "Core/MMCoreSearch.h"
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <vector>
+
+using namespace MMCore;
+
+namespace
+{
+	// Random database of a few states of varying length. Rows are random walks so neighbouring poses are similar,
+	// like real animation, which is what the pruned and indexed backends exploit.
+	struct TestDatabase
+	{
+		FeatureLayout Layout;
+		std::vector<float> Rows;
+		std::vector<StateRange> States;
+		SearchIndex Index;
+
+		TestDatabase(int32_t numStates, int32_t posesPerState, uint32_t seed)
+		{
+			Layout.Init(3, 5);
+
+			std::mt19937 rng(seed);
+			std::normal_distribution<float> step(0.f, 0.2f);
+			std::normal_distribution<float> start(0.f, 1.f);
+
+			int32_t numRows = 0;
+
+			for (int32_t s = 0; s != numStates; ++s)
+			{
+				StateRange state;
+				state.FirstRow = numRows;
+				state.NumPoses = posesPerState + s * 7;
+				state.PlayLength = state.NumPoses * 0.1f;
+				state.bLoop = (s % 3) == 0;
+				States.push_back(state);
+				numRows += state.NumPoses;
+			}
+
+			Rows.resize(size_t(numRows) * Layout.Stride);
+
+			for (const StateRange& state : States)
+			{
+				std::vector<float> current(Layout.Stride);
+
+				for (float& value : current)
+					value = start(rng);
+
+				for (int32_t p = 0; p != state.NumPoses; ++p)
+				{
+					for (float& value : current)
+						value += step(rng);
+
+					std::copy(current.begin(), current.end(), Rows.begin() + size_t(state.FirstRow + p) * Layout.Stride);
+				}
+			}
+
+			Index.Build(GetView());
+		}
+
+		DatabaseView GetView() const
+		{
+			DatabaseView view;
+			view.Layout = &Layout;
+			view.Rows = Rows.data();
+			view.States = States.data();
+			view.NumStates = (int32_t)States.size();
+			view.Biases.NaturalBias = 0.2f;
+			view.Biases.LoopBias = 0.3f;
+			return view;
+		}
+	};
+}
+
+TEST(MMCoreSearch, BackendsAgreeWithBruteForce)
+{
+	const TestDatabase db(8, 60, 1234);
+	const DatabaseView view = db.GetView();
+
+	std::mt19937 rng(42);
+	std::normal_distribution<float> noise(0.f, 0.5f);
+	std::uniform_int_distribution<int32_t> pickState(0, view.NumStates - 1);
+
+	for (int32_t q = 0; q != 200; ++q)
+	{
+		// Queries near a random pose, with the search parameters varied too.
+		const int32_t state = pickState(rng);
+		const int32_t pose = std::uniform_int_distribution<int32_t>(0, db.States[state].NumPoses - 1)(rng);
+
+		std::vector<float> query(view.GetRow(state, pose), view.GetRow(state, pose) + db.Layout.SearchDims);
+
+		for (float& value : query)
+			value += noise(rng);
+
+		SearchParams params;
+		params.CurrentState = (q % 2) ? state : -1;
+		params.CurrentPose = (q % 2) ? pose : -1;
+		params.SteadyBias = (q % 5) * 0.25f;
+		params.bLoopsOnly = (q % 7) == 0;
+
+		const SearchResult expected = BruteForceSearch(view, query.data(), params);
+		ASSERT_TRUE(expected.IsValid());
+
+		for (int32_t b = 0; b != (int32_t)SearchBackend::Count; ++b)
+		{
+			const SearchBackend backend = (SearchBackend)b;
+			const SearchResult result = Search(backend, view, &db.Index, query.data(), params);
+
+			EXPECT_EQ(result.StateIndex, expected.StateIndex) << GetSearchBackendName(backend) << ", query " << q;
+			EXPECT_EQ(result.PoseIndex, expected.PoseIndex) << GetSearchBackendName(backend) << ", query " << q;
+			EXPECT_NEAR(result.Cost, expected.Cost, 1e-4f * expected.Cost + 1e-6f) << GetSearchBackendName(backend);
+			EXPECT_NEAR(result.SecondCost, expected.SecondCost, 1e-4f * expected.SecondCost + 1e-6f) << GetSearchBackendName(backend);
+		}
+	}
+}
+
+TEST(MMCoreSearch, LoopsOnlySkipsOtherStates)
+{
+	const TestDatabase db(6, 40, 7);
+	const DatabaseView view = db.GetView();
+
+	SearchParams params;
+	params.bLoopsOnly = true;
+
+	// Exactly a pose of a non-looping state, which would otherwise win at zero cost.
+	const float* query = view.GetRow(1, 10);
+	ASSERT_FALSE(db.States[1].bLoop);
+
+	for (int32_t b = 0; b != (int32_t)SearchBackend::Count; ++b)
+	{
+		const SearchResult result = Search((SearchBackend)b, view, &db.Index, query, params);
+
+		ASSERT_TRUE(result.IsValid());
+		EXPECT_TRUE(db.States[result.StateIndex].bLoop) << GetSearchBackendName((SearchBackend)b);
+	}
+}
+
+TEST(MMCoreSearch, ToleranceStaysWithinBound)
+{
+	const TestDatabase db(8, 60, 99);
+	const DatabaseView view = db.GetView();
+
+	std::mt19937 rng(5);
+	std::normal_distribution<float> noise(0.f, 1.f);
+
+	for (int32_t q = 0; q != 50; ++q)
+	{
+		std::vector<float> query(db.Layout.SearchDims);
+
+		for (float& value : query)
+			value = noise(rng);
+
+		SearchParams params;
+		const SearchResult exact = BruteForceSearch(view, query.data(), params);
+
+		params.Tolerance = 0.25f;
+
+		for (SearchBackend backend : { SearchBackend::Pruned, SearchBackend::Indexed })
+		{
+			const SearchResult approximate = Search(backend, view, &db.Index, query.data(), params);
+			EXPECT_LE(approximate.Cost, exact.Cost * (1.f + params.Tolerance) * 1.0001f) << GetSearchBackendName(backend);
+		}
+	}
+}
@@ -0,0 +1,155 @@
+// Copyright Wild Montage, LLC. All Rights Reserved.
+
+#include "Spring/Spring.h"
+#include "Core/MMCoreTrajectory.h"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+
+namespace
+{
+	const float HalfLife = 0.3f;
+	const float FrameTime = 1.f / 60.f;
+
+	// One axis of a character, and where its velocity is heading.
+	struct SpringAxis
+	{
+		float Velocity;
+		float Acceleration;
+		float Goal;
+	};
+
+	const SpringAxis Axes[] = { { 120.f, 400.f, -250.f }, { 300.f, -900.f, 150.f }, { 0.f, 0.f, 10.f } };
+}
+
+TEST(Spring, FastNegexpStaysCloseToReference)
+{
+	float maxError = 0.f, maxErrorAt = 0.f;
+
+	for (int32_t i = 0; i <= 20000; ++i)
+	{
+		const float x = i * 1e-3f;
+		const float error = std::abs(Spring::fast_negexp(x) - Spring::negexp(x));
+
+		if (error > maxError)
+		{
+			maxError = error;
+			maxErrorAt = x;
+		}
+	}
+
+	EXPECT_LT(maxError, 0.02f);
+	EXPECT_NEAR(maxErrorAt, 3.33f, 0.1f);
+	EXPECT_EQ(Spring::fast_negexp(0.f), 1.f);
+	EXPECT_LT(Spring::fast_negexp(100.f), 1e-5f);
+}
+
+TEST(Spring, CharacterUpdateMatchesPredictor)
+{
+	// Stepping the character a frame at a time has to land where the closed form predicts.
+	const float timings[] = { 0.25f, 0.5f, 1.f, 2.f };
+	const int32_t numTimings = 4;
+
+	MMCore::SpringTrajectoryPredictor predictor;
+	predictor.Init(timings, numTimings, HalfLife, HalfLife);
+
+	MMCore::TrajectoryInput input;
+
+	for (int32_t axis = 0; axis != 3; ++axis)
+	{
+		input.Velocity[axis] = Axes[axis].Velocity;
+		input.Acceleration[axis] = Axes[axis].Acceleration;
+		input.DesiredVelocity[axis] = Axes[axis].Goal;
+	}
+
+	float predicted[numTimings * 3], facings[numTimings];
+	predictor.Predict(input, predicted, facings);
+
+	for (int32_t axis = 0; axis != 3; ++axis)
+	{
+		float x = 0.f, v = Axes[axis].Velocity, a = Axes[axis].Acceleration;
+		int32_t frame = 0;
+
+		for (int32_t i = 0; i != numTimings; ++i)
+		{
+			for (; frame != (int32_t)std::lround(timings[i] / FrameTime); ++frame)
+				Spring::spring_character_update(x, v, a, Axes[axis].Goal, HalfLife, FrameTime);
+
+			const float expected = predicted[i * 3 + axis];
+			EXPECT_NEAR(x, expected, 0.005f * std::abs(expected) + 0.05f) << "axis " << axis << ", t " << timings[i];
+		}
+	}
+}
+
+TEST(Spring, CharacterPredictMatchesPredictor)
+{
+	// spring_character_predict() jumps straight to each point, so it's only as exact as fast_negexp() is.
+	const int32_t count = 8;
+	const float dt = 0.2f;
+	const float y = Spring::halflife_to_damping(HalfLife) / 2.f;
+
+	float timings[count];
+
+	for (int32_t i = 0; i != count; ++i)
+		timings[i] = i * dt;
+
+	MMCore::SpringTrajectoryPredictor predictor;
+	predictor.Init(timings, count, HalfLife, HalfLife);
+
+	for (const SpringAxis& axis : Axes)
+	{
+		float px[count], pv[count], pa[count];
+		Spring::spring_character_predict(px, pv, pa, count, 0.f, axis.Velocity, axis.Acceleration, axis.Goal, HalfLife, dt);
+
+		MMCore::TrajectoryInput input;
+		input.Velocity[0] = axis.Velocity;
+		input.Acceleration[0] = axis.Acceleration;
+		input.DesiredVelocity[0] = axis.Goal;
+
+		float predicted[count * 3], facings[count];
+		predictor.Predict(input, predicted, facings);
+
+		const float j0 = axis.Velocity - axis.Goal;
+		const float j1 = axis.Acceleration + j0 * y;
+
+		for (int32_t i = 0; i != count; ++i)
+		{
+			// What the exponential multiplies, times the largest error of fast_negexp().
+			const float tolerance = 0.02f * (std::abs(j1) / (y * y) + std::abs(j0 + j1 * timings[i]) / y) + 1e-3f;
+			EXPECT_NEAR(px[i], predicted[i * 3], tolerance) << "t " << timings[i];
+		}
+	}
+}
+
+TEST(Spring, CharacterUpdateBatchMatchesScalar)
+{
+	const int32_t count = 3;
+	float x[count] = { 1.f, -2.f, 3.f }, v[count], a[count], goal[count];
+
+	for (int32_t i = 0; i != count; ++i)
+	{
+		v[i] = Axes[i].Velocity;
+		a[i] = Axes[i].Acceleration;
+		goal[i] = Axes[i].Goal;
+	}
+
+	float sx[count], sv[count], sa[count];
+
+	for (int32_t i = 0; i != count; ++i)
+	{
+		sx[i] = x[i];
+		sv[i] = v[i];
+		sa[i] = a[i];
+		Spring::spring_character_update(sx[i], sv[i], sa[i], goal[i], HalfLife, FrameTime);
+	}
+
+	Spring::spring_character_update_batch(x, v, a, goal, count, HalfLife, FrameTime);
+
+	for (int32_t i = 0; i != count; ++i)
+	{
+		EXPECT_FLOAT_EQ(x[i], sx[i]);
+		EXPECT_FLOAT_EQ(v[i], sv[i]);
+		EXPECT_FLOAT_EQ(a[i], sa[i]);
+	}
+}
@@ -0,0 +1,221 @@
+// Copyright Wild Montage, LLC. All Rights Reserved.
+
+#include "Core/MMCoreTrajectory.h"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <vector>
+
+using namespace MMCore;
+
+namespace
+{
+	const float Timings[] = { -0.6f, -0.3f, 0.2f, 0.4f, 0.6f, 0.8f, 1.0f, 1.5f };
+	const int32_t NumTimings = sizeof(Timings) / sizeof(Timings[0]);
+
+	float GetDecay(float halfLife)
+	{
+		return (4.f * 0.69314718f) / (halfLife + 1e-5f) / 2.f;
+	}
+
+	// Integrates a critically damped spring numerically (semi-implicit Euler): value'' = y^2 (goal - value) - 2 y value'.
+	// Returns the integral of value (the position) when bIntegrate is set, value (the facing) otherwise.
+	std::vector<double> IntegrateSpring(double value, double rate, double goal, double y, bool bIntegrate)
+	{
+		const double dt = 1e-5;
+		std::vector<double> out;
+		double t = 0.0, integral = 0.0;
+
+		for (int32_t i = 0; i != NumTimings; ++i)
+		{
+			if (Timings[i] < 0.f)
+			{
+				out.push_back(0.0);
+				continue;
+			}
+
+			for (; t < Timings[i] - dt * 0.5; t += dt)
+			{
+				rate += (y * y * (goal - value) - 2.0 * y * rate) * dt;
+				value += rate * dt;
+				integral += value * dt;
+			}
+
+			out.push_back(bIntegrate ? integral : value);
+		}
+
+		return out;
+	}
+
+	TrajectoryInput MakeInput()
+	{
+		TrajectoryInput input;
+		input.Velocity[0] = 120.f;
+		input.Velocity[1] = 300.f;
+		input.Velocity[2] = 0.f;
+		input.DesiredVelocity[0] = -250.f;
+		input.DesiredVelocity[1] = 150.f;
+		input.DesiredVelocity[2] = 10.f;
+		input.Acceleration[0] = 400.f;
+		input.Acceleration[1] = -900.f;
+		input.Acceleration[2] = 0.f;
+		input.TurnSpeed = 90.f;
+		input.DesiredFacing = -60.f;
+		return input;
+	}
+}
+
+TEST(MMCoreTrajectory, SpringPredictorMatchesNumericIntegration)
+{
+	const float halfLife = 0.3f, facingHalfLife = 0.2f;
+
+	SpringTrajectoryPredictor predictor;
+	predictor.Init(Timings, NumTimings, halfLife, facingHalfLife);
+	ASSERT_EQ(predictor.GetNumTimings(), NumTimings);
+
+	const TrajectoryInput input = MakeInput();
+	float positions[NumTimings * 3], facings[NumTimings];
+	predictor.Predict(input, positions, facings);
+
+	for (int32_t axis = 0; axis != 3; ++axis)
+	{
+		const std::vector<double> expected = IntegrateSpring(input.Velocity[axis], input.Acceleration[axis], input.DesiredVelocity[axis], GetDecay(halfLife), true);
+
+		for (int32_t i = 0; i != NumTimings; ++i)
+		{
+			if (Timings[i] >= 0.f)
+			{
+				EXPECT_NEAR(positions[i * 3 + axis], expected[i], 0.05) << "axis " << axis << ", t " << Timings[i];
+			}
+		}
+	}
+
+	const std::vector<double> expectedFacings = IntegrateSpring(0.0, input.TurnSpeed, input.DesiredFacing, GetDecay(facingHalfLife), false);
+
+	for (int32_t i = 0; i != NumTimings; ++i)
+	{
+		if (Timings[i] >= 0.f)
+		{
+			EXPECT_NEAR(facings[i], expectedFacings[i], 0.01) << "t " << Timings[i];
+		}
+	}
+}
+
+TEST(MMCoreTrajectory, SpringPredictorExtrapolatesThePast)
+{
+	SpringTrajectoryPredictor predictor;
+	predictor.Init(Timings, NumTimings, 0.3f, 0.2f);
+
+	const TrajectoryInput input = MakeInput();
+	float positions[NumTimings * 3], facings[NumTimings];
+	predictor.Predict(input, positions, facings);
+
+	for (int32_t i = 0; Timings[i] < 0.f; ++i)
+	{
+		for (int32_t axis = 0; axis != 3; ++axis)
+			EXPECT_FLOAT_EQ(positions[i * 3 + axis], input.Velocity[axis] * Timings[i]);
+
+		EXPECT_FLOAT_EQ(facings[i], input.TurnSpeed * Timings[i]);
+	}
+}
+
+TEST(MMCoreTrajectory, SpringPredictorBatchMatchesSingle)
+{
+	SpringTrajectoryPredictor predictor;
+	predictor.Init(Timings, NumTimings, 0.25f, 0.15f);
+
+	std::vector<TrajectoryInput> inputs(5, MakeInput());
+
+	for (int32_t c = 0; c != (int32_t)inputs.size(); ++c)
+	{
+		inputs[c].Velocity[0] *= c;
+		inputs[c].DesiredVelocity[1] -= 40.f * c;
+		inputs[c].TurnSpeed = -30.f * c;
+	}
+
+	std::vector<float> batchPositions(inputs.size() * NumTimings * 3), batchFacings(inputs.size() * NumTimings);
+	predictor.PredictBatch(inputs.data(), (int32_t)inputs.size(), batchPositions.data(), batchFacings.data());
+
+	for (int32_t c = 0; c != (int32_t)inputs.size(); ++c)
+	{
+		float positions[NumTimings * 3], facings[NumTimings];
+		predictor.Predict(inputs[c], positions, facings);
+
+		for (int32_t i = 0; i != NumTimings * 3; ++i)
+			EXPECT_EQ(positions[i], batchPositions[c * NumTimings * 3 + i]);
+
+		for (int32_t i = 0; i != NumTimings; ++i)
+			EXPECT_EQ(facings[i], batchFacings[c * NumTimings + i]);
+	}
+}
+
+TEST(MMCoreTrajectory, SamplePathFollowsSegments)
+{
+	// Straight ahead for 100 cm, then 200 cm to the right.
+	const float path[] = { 0.f, 0.f, 0.f, 0.f, 100.f, 0.f, 200.f, 100.f, 0.f };
+	const float timings[] = { -0.5f, 0.5f, 1.f, 1.5f, 3.f, 5.f };
+	const int32_t numTimings = 6;
+
+	TrajectoryInput input;
+	input.Velocity[1] = 80.f;
+	input.TurnSpeed = 20.f;
+
+	float positions[numTimings * 3], facings[numTimings];
+	SamplePath(timings, numTimings, path, 3, 100.f, input, positions, facings);
+
+	// Past points come from the current velocity, not the path.
+	EXPECT_FLOAT_EQ(positions[0], 0.f);
+	EXPECT_FLOAT_EQ(positions[1], -40.f);
+	EXPECT_FLOAT_EQ(facings[0], -10.f);
+
+	const float expected[][4] = {
+		{ 0.f, 50.f, 0.f, 0.f },		// Along the first segment, facing +y.
+		{ 0.f, 100.f, 0.f, 0.f },		// At the corner.
+		{ 50.f, 100.f, 0.f, -90.f },	// Along the second segment, facing +x.
+		{ 200.f, 100.f, 0.f, -90.f },	// At the end.
+		{ 200.f, 100.f, 0.f, -90.f },	// Stopped at the end.
+	};
+
+	for (int32_t i = 1; i != numTimings; ++i)
+	{
+		EXPECT_NEAR(positions[i * 3 + 0], expected[i - 1][0], 1e-3f) << "t " << timings[i];
+		EXPECT_NEAR(positions[i * 3 + 1], expected[i - 1][1], 1e-3f) << "t " << timings[i];
+		EXPECT_NEAR(positions[i * 3 + 2], expected[i - 1][2], 1e-3f) << "t " << timings[i];
+		EXPECT_NEAR(facings[i], expected[i - 1][3], 1e-3f) << "t " << timings[i];
+	}
+}
+
+TEST(MMCoreTrajectory, SamplePathFacingIsRelativeToForward)
+{
+	const float timings[] = { 1.f };
+	const TrajectoryInput input;
+	float position[3], facing;
+
+	const float left[] = { 0.f, 0.f, 0.f, -100.f, 0.f, 0.f };
+	SamplePath(timings, 1, left, 2, 10.f, input, position, &facing);
+	EXPECT_NEAR(facing, 90.f, 1e-3f);
+
+	const float back[] = { 0.f, 0.f, 0.f, 0.f, -100.f, 0.f };
+	SamplePath(timings, 1, back, 2, 10.f, input, position, &facing);
+	EXPECT_NEAR(std::abs(facing), 180.f, 1e-3f);
+}
+
+TEST(MMCoreTrajectory, SamplePathWithoutSegments)
+{
+	const float timings[] = { 0.5f, 1.f };
+	const float path[] = { 5.f, 6.f, 7.f };
+	const TrajectoryInput input;
+	float positions[6], facings[2];
+
+	// A single point: we're already there.
+	SamplePath(timings, 2, path, 1, 100.f, input, positions, facings);
+
+	for (int32_t i = 0; i != 2; ++i)
+	{
+		EXPECT_FLOAT_EQ(positions[i * 3 + 0], 5.f);
+		EXPECT_FLOAT_EQ(positions[i * 3 + 1], 6.f);
+		EXPECT_FLOAT_EQ(positions[i * 3 + 2], 7.f);
+		EXPECT_FLOAT_EQ(facings[i], 0.f);
+	}
+}